@@ -11,6 +11,7 @@
 #include "../msu1.h"
 #include "../snapshot.h"
 #include "../display.h"
+#include "../profile.h"
 #include "resampler.h"
 
 #include "bapu/snes/snes.hpp"
@@ -28,6 +29,9 @@ static const int APU_DENOMINATOR_PAL    = 709379;
 // for use with SoundSync, multiplied by 2, for left and right samples.
 static const int MINIMUM_BUFFER_SIZE = 550 * 2;
 
+// Most scanlines the SMP and DSP may fall behind by, more than any frame has.
+static const int APU_MAX_PENDING_LINES = 512;
+
 namespace SNES {
 #include "bapu/dsp/blargg_endian.h"
 CPU cpu;
@@ -53,11 +57,23 @@ static uint32 ratio_numerator = APU_NUMERATOR_NTSC;
 static uint32 ratio_denominator = APU_DENOMINATOR_NTSC;
 
 static double dynamic_rate_multiplier = 1.0;
+
+// Takes the samples while output is suppressed, and is emptied every scanline.
+static Resampler sink;
+static bool8 output_suppressed = false;
+
+// SMP clocks of each scanline that ended since the SMP last ran. Running them
+// later, with the DSP seeing RAM as it was at the end of each line, gives the
+// same results, so the SMP and DSP only catch up when something needs them.
+static int32 pending_lines[APU_MAX_PENDING_LINES];
+static int pending_count = 0;
+static int32 pending_clocks = 0;
 } // namespace spc
 
 namespace msu {
 // Always 16-bit, Stereo; 1.5x dsp buffer to never overflow
 static Resampler resampler;
+static Resampler sink;
 static std::vector<int16_t> resampler_buffer;
 } // namespace msu
 
@@ -145,6 +161,21 @@ bool8 S9xSyncSound(void)
     return (spc::sound_in_sync);
 }
 
+// For frames that are emulated but never presented, like run-ahead's: the
+// DSP and MSU-1 keep running, but their samples never reach the frontend.
+void S9xAPUSuppressOutput(bool8 suppress)
+{
+    if (suppress == spc::output_suppressed)
+        return;
+
+    spc::output_suppressed = suppress;
+    spc::sink.clear();
+    msu::sink.clear();
+
+    SNES::dsp.spc_dsp.set_output(suppress ? &spc::sink : &spc::resampler);
+    S9xMSU1SetOutput(suppress ? &msu::sink : &msu::resampler);
+}
+
 void S9xSetSamplesAvailableCallback(apu_callback callback, void *data)
 {
     spc::callback = callback;
@@ -172,11 +203,13 @@ static void UpdatePlaybackRate(void)
     }
 
     spc::resampler.time_ratio(time_ratio);
+    spc::resampler.set_quality(Settings.ResamplerQuality);
 
     if (Settings.MSU1)
     {
         time_ratio = time_ratio * 44100 / 32040;
         msu::resampler.time_ratio(time_ratio);
+        msu::resampler.set_quality(Settings.ResamplerQuality);
     }
 }
 
@@ -229,6 +262,8 @@ bool8 S9xInitAPU(void)
 {
     spc::resampler.clear();
     msu::resampler.clear();
+    spc::sink.resize(MINIMUM_BUFFER_SIZE);
+    msu::sink.resize(MINIMUM_BUFFER_SIZE * 3 / 2);
 
     return true;
 }
@@ -270,6 +305,10 @@ void S9xAPUSetReferenceTime(int32 cpucycles)
 
 void S9xAPUExecute(void)
 {
+    S9xAPUCatchUp();
+
+    S9xProfileScope profile(PROFILE_APU);
+
     int cycles = S9xAPUGetClock(CPU.Cycles);
     spc::remainder = S9xAPUGetClockRemainder(CPU.Cycles);
     SNES::smp.clock -= cycles;
@@ -280,10 +319,48 @@ void S9xAPUExecute(void)
 
 void S9xAPUEndScanline(void)
 {
-    S9xAPUExecute();
+    int cycles = S9xAPUGetClock(CPU.Cycles);
+    spc::remainder = S9xAPUGetClockRemainder(CPU.Cycles);
+    S9xAPUSetReferenceTime(CPU.Cycles);
+
+    spc::pending_lines[spc::pending_count++] = cycles;
+    spc::pending_clocks += cycles;
+
+    // The DSP makes two samples per 32 clocks. Catch up once they would
+    // complete a block for the port, so sound isn't held back any longer
+    // than when the APU ran every line, and before they could fill what's
+    // left of the buffer.
+    int samples = spc::pending_clocks >> 4;
+    Resampler &output = spc::output_suppressed ? spc::sink : spc::resampler;
+    if (spc::pending_count == APU_MAX_PENDING_LINES ||
+        (!spc::output_suppressed && spc::resampler.space_filled() + samples >= APU_SAMPLE_BLOCK) ||
+        samples + APU_SAMPLE_BLOCK >= output.space_empty())
+        S9xAPUCatchUp();
+}
+
+void S9xAPUCatchUp(void)
+{
+    if (!spc::pending_count)
+        return;
+
+    S9xProfileScope profile(PROFILE_APU);
+
+    // One run for the whole queue. The DSP still sees RAM as it was at the
+    // end of each line: it catches up to the last line end before the SMP
+    // writes RAM or reads the echo buffer.
+    SNES::smp.clock -= spc::pending_clocks;
+    SNES::smp.enter(spc::pending_lines, spc::pending_count);
     SNES::dsp.synchronize();
 
-    if (spc::resampler.space_filled() >= APU_SAMPLE_BLOCK)
+    spc::pending_count = 0;
+    spc::pending_clocks = 0;
+
+    if (spc::output_suppressed)
+    {
+        spc::sink.clear();
+        msu::sink.clear();
+    }
+    else if (spc::resampler.space_filled() >= APU_SAMPLE_BLOCK)
         S9xLandSamples();
 }
 
@@ -305,6 +382,8 @@ void S9xResetAPU(void)
 {
     spc::reference_time = 0;
     spc::remainder = 0;
+    spc::pending_count = 0;
+    spc::pending_clocks = 0;
 
     SNES::cpu.reset();
     SNES::smp.power();
@@ -318,6 +397,8 @@ void S9xSoftResetAPU(void)
 {
     spc::reference_time = 0;
     spc::remainder = 0;
+    spc::pending_count = 0;
+    spc::pending_clocks = 0;
     SNES::cpu.reset();
     SNES::smp.reset();
     SNES::dsp.reset();
@@ -325,10 +406,35 @@ void S9xSoftResetAPU(void)
     S9xClearSamples();
 }
 
+// Loads an SPC file to play on its own, without a game driving the ports.
+bool8 S9xAPULoadSPC(const uint8 *data, size_t size)
+{
+    if (size < SPC_FILE_SIZE || memcmp(data, "SNES-SPC700 Sound File Data", 27))
+        return false;
+
+    S9xResetAPU();
+    SNES::smp.load_spc(data);
+
+    return true;
+}
+
+// Runs the SMP and DSP for the given number of SMP clocks, for playing an SPC
+// file. The samples are left to S9xMixSamples().
+void S9xAPURunSPC(int clocks)
+{
+    S9xAPUCatchUp();
+
+    SNES::smp.clock -= clocks;
+    SNES::smp.enter();
+    SNES::dsp.synchronize();
+}
+
 void S9xAPUSaveState(uint8 *block)
 {
     uint8 *ptr = block;
 
+    S9xAPUCatchUp();
+
     SNES::smp.save_state(&ptr);
     SNES::dsp.save_state(&ptr);
 
@@ -348,6 +454,9 @@ void S9xAPULoadState(uint8 *block)
 {
     uint8 *ptr = block;
 
+    spc::pending_count = 0;
+    spc::pending_clocks = 0;
+
     SNES::smp.load_state(&ptr);
     SNES::dsp.load_state(&ptr);
     spc::reference_time = SNES::get_le32(ptr);
@@ -371,6 +480,9 @@ void S9xAPULoadBlarggState(uint8 *oldblock)
 {
     uint8 *ptr = oldblock;
 
+    spc::pending_count = 0;
+    spc::pending_clocks = 0;
+
     SNES::SPC_State_Copier copier(&ptr, to_var_from_buf);
 
     copier.copy(SNES::smp.apuram, 0x10000); // RAM
@@ -482,6 +594,7 @@ bool8 S9xSPCDump(const char *filename)
 
     S9xSetSoundMute(true);
 
+    S9xAPUCatchUp();
     SNES::smp.save_spc(buf);
 
     ignore = fwrite(buf, SPC_FILE_SIZE, 1, fs);
@@ -22,11 +22,14 @@ uint8 S9xAPUReadPort (int);
 void S9xAPUWritePort (int, uint8);
 void S9xAPUExecute (void);
 void S9xAPUEndScanline (void);
+void S9xAPUCatchUp (void);
 void S9xAPUSetReferenceTime (int32);
 void S9xAPUTimingSetSpeedup (int);
 void S9xAPULoadState (uint8 *);
 void S9xAPULoadBlarggState(uint8 *oldblock);
 void S9xAPUSaveState (uint8 *);
+bool8 S9xAPULoadSPC (const uint8 *, size_t);
+void S9xAPURunSPC (int);
 void S9xDumpSPCSnapshot (void);
 bool8 S9xSPCDump (const char *);
 
@@ -39,6 +42,7 @@ void S9xSetSoundControl (uint8);
 void S9xSetSoundMute (bool8);
 void S9xLandSamples (void);
 void S9xClearSamples (void);
+void S9xAPUSuppressOutput (bool8);
 bool8 S9xMixSamples (uint8 *, int);
 void S9xSetSamplesAvailableCallback (apu_callback, void *);
 void S9xUpdateDynamicRate (int empty = 1, int buffer_size = 2);
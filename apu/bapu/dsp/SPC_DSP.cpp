@@ -7,6 +7,14 @@
 #include "blargg_endian.h"
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define SPC_DSP_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define SPC_DSP_NEON 1
+#endif
+
 /* Copyright (C) 2007 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
 General Public License as published by the Free Software Foundation; either
@@ -651,62 +659,123 @@ inline void SPC_DSP::run_envelope( voice_t* const v )
 
 //// BRR Decoding
 
-inline void SPC_DSP::decode_brr( voice_t* v )
+// Decodes one sample from its sign-extended nybble and the two samples before it
+static inline int decode_brr_sample( int s, int header, int p1, int p2 )
 {
-	// Arrange the four input nybbles in 0xABCD order for easy decoding
-	int nybbles = m.t_brr_byte * 0x100 + m.ram [(v->brr_addr + v->brr_offset + 1) & 0xFFFF];
+	// Shift sample based on header
+	int const shift = header >> 4;
+	if (shift <= 12)
+		s = (s << shift) >> 1;
+	else
+		s &= ~0x7ff;
 
-	int const header = m.t_brr_header;
+	// Apply IIR filter (8 is the most commonly used)
+	int const filter = header & 0x0C;
+	p2 >>= 1;
+	if ( filter >= 8 )
+	{
+		s += p1;
+		s -= p2;
+		if ( filter == 8 ) // s += p1 * 0.953125 - p2 * 0.46875
+		{
+			s += p2 >> 4;
+			s += (p1 * -3) >> 6;
+		}
+		else // s += p1 * 0.8984375 - p2 * 0.40625
+		{
+			s += (p1 * -13) >> 7;
+			s += (p2 * 3) >> 4;
+		}
+	}
+	else if ( filter ) // s += p1 * 0.46875
+	{
+		s += p1 >> 1;
+		s += (-p1) >> 5;
+	}
 
+	// Adjust sample
+	CLAMP16( s );
+	return (int16_t) (s * 2);
+}
+
+// Decodes a whole block at addr, following p1 and p2, into a cache entry
+void SPC_DSP::cache_brr( brr_cache_t* c, int addr, int p1, int p2 )
+{
+	c->addr = addr;
+	c->writes [0] = ram_writes [addr >> 8];
+	c->writes [1] = ram_writes [((addr + brr_block_size - 1) & 0xFFFF) >> 8];
+
+	short* out = c->pcm;
+	*out++ = (short) p2;
+	*out++ = (short) p1;
+
+	int const header = m.ram [addr];
+	for ( int i = 2; i < brr_block_size * 2; i++ )
+	{
+		int const byte = m.ram [(addr + (i >> 1)) & 0xFFFF];
+		int const s = decode_brr_sample( (int8_t) (byte << (i & 1) * 4) >> 4, header, p1, p2 );
+		*out++ = (short) s;
+		p2 = p1;
+		p1 = s;
+	}
+}
+
+inline bool SPC_DSP::brr_cache_valid( brr_cache_t const* c, int addr ) const
+{
+	return c->addr == addr &&
+			c->writes [0] == ram_writes [addr >> 8] &&
+			c->writes [1] == ram_writes [((addr + brr_block_size - 1) & 0xFFFF) >> 8];
+}
+
+void SPC_DSP::ram_replaced()
+{
+	for ( int i = 0; i < 0x100; i++ )
+		ram_writes [i]++;
+}
+
+inline void SPC_DSP::decode_brr( voice_t* v )
+{
 	// Write to next four samples in circular buffer
 	int* pos = &v->buf [v->buf_pos];
-	int* end;
 	if ( (v->buf_pos += 4) >= brr_buf_size )
 		v->buf_pos = 0;
 
-	// Decode four samples
-	for ( end = pos + 4; pos < end; pos++, nybbles <<= 4 )
+	int const p1 = pos [brr_buf_size - 1];
+	int const p2 = pos [brr_buf_size - 2];
+
+	// Copy from the cache when this block and the samples before these four
+	// haven't changed since it was decoded
+	int const first = v->brr_offset >> 1 << 2;
+	brr_cache_t* const c = &brr_cache [v->brr_addr & (brr_cache_size - 1)];
+	short const* in = &c->pcm [first];
+	if ( in [0] != p2 || in [1] != p1 || !brr_cache_valid( c, v->brr_addr ) )
 	{
-		// Extract nybble and sign-extend
-		int s = (int16_t) nybbles >> 12;
-
-		// Shift sample based on header
-		int const shift = header >> 4;
-		if (shift <= 12)
-			s = (s << shift) >> 1;
-		else
-			s &= ~0x7ff;
-
-		// Apply IIR filter (8 is the most commonly used)
-		int const filter = header & 0x0C;
-		int const p1 = pos [brr_buf_size - 1];
-		int const p2 = pos [brr_buf_size - 2] >> 1;
-		if ( filter >= 8 )
+		// Fill the entry when starting a block, unless the header or first
+		// byte were read before a write that changed them
+		if ( first || m.t_brr_header != m.ram [v->brr_addr] ||
+				m.t_brr_byte != m.ram [(v->brr_addr + 1) & 0xFFFF] )
 		{
-			s += p1;
-			s -= p2;
-			if ( filter == 8 ) // s += p1 * 0.953125 - p2 * 0.46875
-			{
-				s += p2 >> 4;
-				s += (p1 * -3) >> 6;
-			}
-			else // s += p1 * 0.8984375 - p2 * 0.40625
+			// Arrange the four input nybbles in 0xABCD order for easy decoding
+			int nybbles = m.t_brr_byte * 0x100 + m.ram [(v->brr_addr + v->brr_offset + 1) & 0xFFFF];
+
+			// Decode four samples
+			int* end;
+			for ( end = pos + 4; pos < end; pos++, nybbles <<= 4 )
 			{
-				s += (p1 * -13) >> 7;
-				s += (p2 * 3) >> 4;
+				int const s = decode_brr_sample( (int16_t) nybbles >> 12, m.t_brr_header,
+						pos [brr_buf_size - 1], pos [brr_buf_size - 2] );
+				pos [brr_buf_size] = pos [0] = s; // second copy simplifies wrap-around
 			}
-		}
-		else if ( filter ) // s += p1 * 0.46875
-		{
-			s += p1 >> 1;
-			s += (-p1) >> 5;
+			return;
 		}
 
-		// Adjust and write sample
-		CLAMP16( s );
-		s = (int16_t) (s * 2);
-		pos [brr_buf_size] = pos [0] = s; // second copy simplifies wrap-around
+		cache_brr( c, v->brr_addr, p1, p2 );
+		in = c->pcm;
 	}
+
+	in += 2;
+	for ( int i = 0; i < 4; i++ )
+		pos [brr_buf_size + i] = pos [i] = in [i];
 }
 
 
@@ -781,57 +850,38 @@ inline VOICE_CLOCK( V3b )
 	m.t_brr_header = m.ram [v->brr_addr]; // brr_addr doesn't need masking
 }
 
-inline VOICE_CLOCK( V3c )
+// Key-on setup during the five samples after KON
+inline VOICE_CLOCK( kon_delay )
 {
-	// Pitch modulation using previous voice's output
-	if ( m.t_pmon & v->vbit )
-		m.t_pitch += ((m.t_output >> 5) * m.t_pitch) >> 10;
-
-	if ( v->kon_delay )
+	if ( v->kon_delay == 5 )
 	{
-		// Get ready to start BRR decoding on next sample
-		if ( v->kon_delay == 5 )
-		{
-			v->brr_addr    = m.t_brr_next_addr;
-			v->brr_offset  = 1;
-			v->buf_pos     = 0;
-			m.t_brr_header = 0; // header is ignored on this sample
-			m.kon_check    = true;
+		v->brr_addr    = m.t_brr_next_addr;
+		v->brr_offset  = 1;
+		v->buf_pos     = 0;
+		m.t_brr_header = 0; // header is ignored on this sample
+		m.kon_check    = true;
 
-			if (take_spc_snapshot)
-			{
-				take_spc_snapshot = 0;
-				if (spc_snapshot_callback)
-					spc_snapshot_callback();
-			}
+		if (take_spc_snapshot)
+		{
+			take_spc_snapshot = 0;
+			if (spc_snapshot_callback)
+				spc_snapshot_callback();
 		}
-
-		// Envelope is never run during KON
-		v->env        = 0;
-		v->hidden_env = 0;
-
-		// Disable BRR decoding until last three samples
-		v->interp_pos = 0;
-		if ( --v->kon_delay & 3 )
-			v->interp_pos = 0x4000;
-
-		// Pitch is never added during KON
-		m.t_pitch = 0;
 	}
 
-	// Gaussian interpolation
-	{
-		int output = interpolate( v );
-
-		// Noise
-		if ( m.t_non & v->vbit )
-			output = (int16_t) (m.noise * 2);
+	// Envelope is never run during KON
+	v->env        = 0;
+	v->hidden_env = 0;
 
-		// Apply envelope
-		m.t_output = (output * v->env) >> 11 & ~1;
-		v->t_envx_out = (uint8_t) (v->env >> 4);
-	}
+	// Disable BRR decoding until last three samples
+	v->interp_pos = 0;
+	if ( --v->kon_delay & 3 )
+		v->interp_pos = 0x4000;
+}
 
+// End of sample, KOFF/KON and the envelope, after the output was taken
+inline VOICE_CLOCK( envelope )
+{
 	// Immediate silence due to end of sample or soft reset
 	if ( REG(flg) & 0x80 || (m.t_brr_header & 3) == 1 )
 	{
@@ -858,6 +908,37 @@ inline VOICE_CLOCK( V3c )
 		run_envelope( v );
 }
 
+inline VOICE_CLOCK( V3c )
+{
+	// Pitch modulation using previous voice's output
+	if ( m.t_pmon & v->vbit )
+		m.t_pitch += ((m.t_output >> 5) * m.t_pitch) >> 10;
+
+	if ( v->kon_delay )
+	{
+		// Get ready to start BRR decoding on next sample
+		voice_kon_delay( v );
+
+		// Pitch is never added during KON
+		m.t_pitch = 0;
+	}
+
+	// Gaussian interpolation
+	{
+		int output = interpolate( v );
+
+		// Noise
+		if ( m.t_non & v->vbit )
+			output = (int16_t) (m.noise * 2);
+
+		// Apply envelope
+		m.t_output = (output * v->env) >> 11 & ~1;
+		v->t_envx_out = (uint8_t) (v->env >> 4);
+	}
+
+	voice_envelope( v );
+}
+
 inline void SPC_DSP::voice_output( voice_t const* v, int ch )
 {
 	// Apply left/right volume
@@ -876,7 +957,8 @@ inline void SPC_DSP::voice_output( voice_t const* v, int ch )
 	}
 }
 
-inline VOICE_CLOCK( V4 )
+// BRR decoding and pitch, the part of V4 before output
+inline VOICE_CLOCK( decode )
 {
 	// Decode BRR
 	m.t_looped = 0;
@@ -904,6 +986,10 @@ inline VOICE_CLOCK( V4 )
 	// Keep from getting too far ahead (when using pitch modulation)
 	if ( v->interp_pos > 0x7FFF )
 		v->interp_pos = 0x7FFF;
+}
+inline VOICE_CLOCK( V4 )
+{
+	voice_decode( v );
 
 	// Output left
 	voice_output( v, 0 );
@@ -1088,7 +1174,11 @@ ECHO_CLOCK( 28 )
 inline void SPC_DSP::echo_write( int ch )
 {
 	if ( !(m.t_echo_enabled & 0x20) )
+	{
 		SET_LE16A( ECHO_PTR( ch ), m.t_echo_out [ch] );
+		S9xMarkDirty( Dirty.APURAM, (m.t_echo_ptr + ch * 2) & 0xFFFF );
+		ram_written( (m.t_echo_ptr + ch * 2) & 0xFFFF );
+	}
 
 	m.t_echo_out [ch] = 0;
 }
@@ -1114,6 +1204,666 @@ ECHO_CLOCK( 30 )
 	echo_write( 1 );
 }
 
+void SPC_DSP::echo_extent( int* start, int* size ) const
+{
+	*start = m.t_esa * 0x100;
+	*size  = 0;
+	if ( Settings.SeparateEchoBuffer || (m.t_echo_enabled & REG(flg) & 0x20) )
+		return;
+
+	// Only latched from ESA and EDL, which can't change without a write
+	if ( m.t_esa != REG(esa) )
+	{
+		*size = 0x10000;
+		return;
+	}
+
+	int length = (REG(edl) & 0x0F) * 0x800;
+	if ( length < m.echo_length )
+		length = m.echo_length;
+	*size = length ? length : 4;
+}
+
+
+//// Voice-parallel mode
+
+/* Runs one sample's 32 clocks with the eight voices in lockstep instead of
+interleaved. The window starts at clock 30, where voice 0 reaches V3c, so all
+eight V3c steps of the window see the same KON/KOFF, noise and counter state.
+Registers cannot change inside run(), and the only RAM writes are the echo
+writes at clocks 29 and 30, which stay at the window's ends; everything else
+keeps its order per voice, and the clamped output/echo sums keep voice order.
+The result is identical to run_clocks(). */
+
+// Clock at which a window begins
+int const window_phase = 30;
+
+// Gaussian weights for each fractional position, in interpolate()'s tap order
+static short gauss_taps [256] [4];
+
+static void init_gauss_taps()
+{
+	for ( int offset = 0; offset < 256; offset++ )
+	{
+		short const* fwd = gauss + 255 - offset;
+		short const* rev = gauss       + offset;
+		gauss_taps [offset] [0] = fwd [  0];
+		gauss_taps [offset] [1] = fwd [256];
+		gauss_taps [offset] [2] = rev [256];
+		gauss_taps [offset] [3] = rev [  0];
+	}
+}
+
+// V3c's interpolation, noise and envelope for all voices into out, the pitch
+// modulation of the voices in pmon, and the left/right volumes into amp
+void SPC_DSP::voice_lanes( int* out, int* pitch, int pmon, int (*amp) [voice_count] )
+{
+	int const method = Settings.InterpolationMethod;
+	voice_t const* const voices = m.voices;
+
+#if SPC_DSP_SSE2
+	if ( method == 2 || (unsigned) method > 4 ) // gaussian, as in interpolate()
+	{
+		__m128i const bits = _mm_setr_epi16( 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 );
+		__m128i const even = _mm_set1_epi16( ~1 );
+
+		// Four weighted taps per voice, two voices at a time
+		__m128i taps [voice_count];
+		for ( int i = 0; i < voice_count; i += 2 )
+		{
+			voice_t const* a = &voices [i];
+			voice_t const* b = &voices [i + 1];
+			__m128i in = _mm_packs_epi32(
+					_mm_loadu_si128( (__m128i const*) &a->buf [(a->interp_pos >> 12) + a->buf_pos] ),
+					_mm_loadu_si128( (__m128i const*) &b->buf [(b->interp_pos >> 12) + b->buf_pos] ) );
+			__m128i w = _mm_unpacklo_epi64(
+					_mm_loadl_epi64( (__m128i const*) gauss_taps [a->interp_pos >> 4 & 0xFF] ),
+					_mm_loadl_epi64( (__m128i const*) gauss_taps [b->interp_pos >> 4 & 0xFF] ) );
+			__m128i lo = _mm_mullo_epi16( in, w );
+			__m128i hi = _mm_mulhi_epi16( in, w );
+			taps [i    ] = _mm_srai_epi32( _mm_unpacklo_epi16( lo, hi ), 11 );
+			taps [i + 1] = _mm_srai_epi32( _mm_unpackhi_epi16( lo, hi ), 11 );
+		}
+
+		// Transpose to one tap of four voices per vector and add up
+		__m128i sum [2];
+		for ( int h = 0; h < 2; h++ )
+		{
+			__m128i const* t = &taps [h * 4];
+			__m128i t01 = _mm_unpacklo_epi32( t [0], t [1] );
+			__m128i t23 = _mm_unpacklo_epi32( t [2], t [3] );
+			__m128i u01 = _mm_unpackhi_epi32( t [0], t [1] );
+			__m128i u23 = _mm_unpackhi_epi32( t [2], t [3] );
+			__m128i s = _mm_add_epi32( _mm_add_epi32( _mm_unpacklo_epi64( t01, t23 ),
+					_mm_unpackhi_epi64( t01, t23 ) ), _mm_unpacklo_epi64( u01, u23 ) );
+			s = _mm_srai_epi32( _mm_slli_epi32( s, 16 ), 16 ); // out = (int16_t) out
+			sum [h] = _mm_add_epi32( s, _mm_unpackhi_epi64( u01, u23 ) );
+		}
+
+		// CLAMP16 and clear the low bit, then substitute noise
+		__m128i output = _mm_and_si128( _mm_packs_epi32( sum [0], sum [1] ), even );
+		__m128i non = _mm_cmpeq_epi16( _mm_and_si128( _mm_set1_epi16( (short) m.t_non ), bits ), bits );
+		output = _mm_or_si128( _mm_andnot_si128( non, output ),
+				_mm_and_si128( non, _mm_set1_epi16( (int16_t) (m.noise * 2) ) ) );
+
+		// Apply envelope
+		__m128i env = _mm_setr_epi16( voices [0].env, voices [1].env, voices [2].env, voices [3].env,
+				voices [4].env, voices [5].env, voices [6].env, voices [7].env );
+		__m128i lo = _mm_mullo_epi16( output, env );
+		__m128i hi = _mm_mulhi_epi16( output, env );
+		__m128i out0 = _mm_srai_epi32( _mm_unpacklo_epi16( lo, hi ), 11 );
+		__m128i out1 = _mm_srai_epi32( _mm_unpackhi_epi16( lo, hi ), 11 );
+		__m128i out16 = _mm_and_si128( _mm_packs_epi32( out0, out1 ), even );
+		_mm_storeu_si128( (__m128i*) out,       _mm_srai_epi32( _mm_unpacklo_epi16( out16, out16 ), 16 ) );
+		_mm_storeu_si128( (__m128i*) (out + 4), _mm_srai_epi32( _mm_unpackhi_epi16( out16, out16 ), 16 ) );
+
+		// Pitch modulation using previous voice's output
+		if ( pmon )
+		{
+			__m128i prev = _mm_slli_si128( _mm_srai_epi16( out16, 5 ), 2 );
+			__m128i p0 = _mm_loadu_si128( (__m128i const*) pitch );
+			__m128i p1 = _mm_loadu_si128( (__m128i const*) (pitch + 4) );
+			__m128i p  = _mm_packs_epi32( p0, p1 );
+			lo = _mm_mullo_epi16( prev, p );
+			hi = _mm_mulhi_epi16( prev, p );
+			__m128i on = _mm_cmpeq_epi16( _mm_and_si128( _mm_set1_epi16( (short) pmon ), bits ), bits );
+			p0 = _mm_add_epi32( p0, _mm_and_si128( _mm_unpacklo_epi16( on, on ),
+					_mm_srai_epi32( _mm_unpacklo_epi16( lo, hi ), 10 ) ) );
+			p1 = _mm_add_epi32( p1, _mm_and_si128( _mm_unpackhi_epi16( on, on ),
+					_mm_srai_epi32( _mm_unpackhi_epi16( lo, hi ), 10 ) ) );
+			_mm_storeu_si128( (__m128i*) pitch,       p0 );
+			_mm_storeu_si128( (__m128i*) (pitch + 4), p1 );
+		}
+
+		// Left/right volume, zeroed for voices switched off
+		__m128i vol = _mm_setr_epi16(
+				GET_LE16A( &m.regs [0x00] ), GET_LE16A( &m.regs [0x10] ),
+				GET_LE16A( &m.regs [0x20] ), GET_LE16A( &m.regs [0x30] ),
+				GET_LE16A( &m.regs [0x40] ), GET_LE16A( &m.regs [0x50] ),
+				GET_LE16A( &m.regs [0x60] ), GET_LE16A( &m.regs [0x70] ) );
+		for ( int ch = 0; ch < 2; ch++ )
+		{
+			__m128i on = _mm_cmpeq_epi16( _mm_and_si128( _mm_set1_epi16( (short) (stereo_switch >> (ch * 8)) ), bits ), bits );
+			__m128i v  = _mm_and_si128( on, _mm_srai_epi16( ch ? vol : _mm_slli_epi16( vol, 8 ), 8 ) );
+			lo = _mm_mullo_epi16( out16, v );
+			hi = _mm_mulhi_epi16( out16, v );
+			_mm_storeu_si128( (__m128i*) amp [ch],       _mm_srai_epi32( _mm_unpacklo_epi16( lo, hi ), 7 ) );
+			_mm_storeu_si128( (__m128i*) (amp [ch] + 4), _mm_srai_epi32( _mm_unpackhi_epi16( lo, hi ), 7 ) );
+		}
+		return;
+	}
+#elif SPC_DSP_NEON
+	if ( method == 2 || (unsigned) method > 4 ) // gaussian, as in interpolate()
+	{
+		static short const bit_lanes [8] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+		int16x8_t const bits = vld1q_s16( bit_lanes );
+
+		// Four weighted taps per voice
+		int32x4_t taps [voice_count];
+		for ( int i = 0; i < voice_count; i++ )
+		{
+			voice_t const* v = &voices [i];
+			int16x4_t in = vmovn_s32( vld1q_s32( &v->buf [(v->interp_pos >> 12) + v->buf_pos] ) );
+			taps [i] = vshrq_n_s32( vmull_s16( in, vld1_s16( gauss_taps [v->interp_pos >> 4 & 0xFF] ) ), 11 );
+		}
+
+		// Transpose to one tap of four voices per vector and add up
+		int32x4_t sum [2];
+		for ( int h = 0; h < 2; h++ )
+		{
+			int32x4_t const* t = &taps [h * 4];
+			int32x4x2_t t01 = vtrnq_s32( t [0], t [1] );
+			int32x4x2_t t23 = vtrnq_s32( t [2], t [3] );
+			int32x4_t s = vaddq_s32( vaddq_s32(
+					vcombine_s32( vget_low_s32 ( t01.val [0] ), vget_low_s32 ( t23.val [0] ) ),
+					vcombine_s32( vget_low_s32 ( t01.val [1] ), vget_low_s32 ( t23.val [1] ) ) ),
+					vcombine_s32( vget_high_s32( t01.val [0] ), vget_high_s32( t23.val [0] ) ) );
+			s = vmovl_s16( vmovn_s32( s ) ); // out = (int16_t) out
+			sum [h] = vaddq_s32( s, vcombine_s32( vget_high_s32( t01.val [1] ), vget_high_s32( t23.val [1] ) ) );
+		}
+
+		// CLAMP16 and clear the low bit, then substitute noise
+		int16x8_t output = vandq_s16( vcombine_s16( vqmovn_s32( sum [0] ), vqmovn_s32( sum [1] ) ), vdupq_n_s16( ~1 ) );
+		output = vbslq_s16( vtstq_s16( vdupq_n_s16( (short) m.t_non ), bits ),
+				vdupq_n_s16( (int16_t) (m.noise * 2) ), output );
+
+		// Apply envelope
+		short env [voice_count];
+		for ( int i = 0; i < voice_count; i++ )
+			env [i] = (short) voices [i].env;
+		int16x8_t e = vld1q_s16( env );
+		int32x4_t out0 = vandq_s32( vshrq_n_s32( vmull_s16( vget_low_s16 ( output ), vget_low_s16 ( e ) ), 11 ), vdupq_n_s32( ~1 ) );
+		int32x4_t out1 = vandq_s32( vshrq_n_s32( vmull_s16( vget_high_s16( output ), vget_high_s16( e ) ), 11 ), vdupq_n_s32( ~1 ) );
+		vst1q_s32( out,     out0 );
+		vst1q_s32( out + 4, out1 );
+		int16x8_t out16 = vcombine_s16( vmovn_s32( out0 ), vmovn_s32( out1 ) );
+
+		// Pitch modulation using previous voice's output
+		if ( pmon )
+		{
+			int16x8_t prev = vextq_s16( vdupq_n_s16( 0 ), vshrq_n_s16( out16, 5 ), 7 );
+			int32x4_t p0 = vld1q_s32( pitch );
+			int32x4_t p1 = vld1q_s32( pitch + 4 );
+			int16x8_t on = vreinterpretq_s16_u16( vtstq_s16( vdupq_n_s16( (short) pmon ), bits ) );
+			p0 = vaddq_s32( p0, vandq_s32( vmovl_s16( vget_low_s16 ( on ) ),
+					vshrq_n_s32( vmull_s16( vget_low_s16 ( prev ), vmovn_s32( p0 ) ), 10 ) ) );
+			p1 = vaddq_s32( p1, vandq_s32( vmovl_s16( vget_high_s16( on ) ),
+					vshrq_n_s32( vmull_s16( vget_high_s16( prev ), vmovn_s32( p1 ) ), 10 ) ) );
+			vst1q_s32( pitch,     p0 );
+			vst1q_s32( pitch + 4, p1 );
+		}
+
+		// Left/right volume, zeroed for voices switched off
+		for ( int ch = 0; ch < 2; ch++ )
+		{
+			short vol [voice_count];
+			for ( int i = 0; i < voice_count; i++ )
+				vol [i] = (int8_t) VREG(voices [i].regs,voll + ch);
+			int16x8_t on = vreinterpretq_s16_u16( vtstq_s16( vdupq_n_s16( (short) (stereo_switch >> (ch * 8)) ), bits ) );
+			int16x8_t v  = vandq_s16( vld1q_s16( vol ), on );
+			vst1q_s32( amp [ch],     vshrq_n_s32( vmull_s16( vget_low_s16 ( out16 ), vget_low_s16 ( v ) ), 7 ) );
+			vst1q_s32( amp [ch] + 4, vshrq_n_s32( vmull_s16( vget_high_s16( out16 ), vget_high_s16( v ) ), 7 ) );
+		}
+		return;
+	}
+#endif
+
+	(void) method;
+	for ( int i = 0; i < voice_count; i++ )
+	{
+		voice_t const* v = &voices [i];
+		int output = interpolate( v );
+		if ( m.t_non & v->vbit )
+			output = (int16_t) (m.noise * 2);
+		out [i] = (output * v->env) >> 11 & ~1;
+	}
+
+	for ( int i = 1; i < voice_count; i++ )
+		if ( pmon & voices [i].vbit )
+			pitch [i] += ((out [i - 1] >> 5) * pitch [i]) >> 10;
+
+	for ( int ch = 0; ch < 2; ch++ )
+	{
+		for ( int i = 0; i < voice_count; i++ )
+		{
+			int on = stereo_switch & (1 << (i + ch * voice_count));
+			amp [ch] [i] = on ? (out [i] * (int8_t) VREG(voices [i].regs,voll + ch)) >> 7 : 0;
+		}
+	}
+}
+
+// V3c's envelope step for all voices, given their ADSR0 and BRR header as
+// latched in V2 and V3b
+void SPC_DSP::envelope_lanes( int const* adsr0, int const* header )
+{
+	voice_t* const voices = m.voices;
+
+	// End of sample, KOFF and KON, as in voice_envelope()
+	int run = 0;
+	for ( int i = 0; i < voice_count; i++ )
+	{
+		voice_t* const v = &voices [i];
+		if ( REG(flg) & 0x80 || (header [i] & 3) == 1 )
+		{
+			v->env_mode = env_release;
+			v->env      = 0;
+		}
+
+		if ( m.every_other_sample )
+		{
+			if ( m.t_koff & v->vbit )
+				v->env_mode = env_release;
+
+			if ( m.kon & v->vbit )
+			{
+				v->kon_delay = 5;
+				v->env_mode  = env_attack;
+			}
+		}
+
+		if ( !v->kon_delay )
+			run |= v->vbit;
+	}
+
+#if SPC_DSP_SSE2 || SPC_DSP_NEON
+	// run_envelope() in 16-bit lanes, which hold every value it computes
+	short env [voice_count], hidden [voice_count], mode [voice_count];
+	short a0 [voice_count], a1 [voice_count], gain [voice_count];
+	for ( int i = 0; i < voice_count; i++ )
+	{
+		voice_t const* v = &voices [i];
+		env    [i] = (short) v->env;
+		hidden [i] = (short) v->hidden_env;
+		mode   [i] = (short) v->env_mode;
+		a0     [i] = (short) adsr0 [i];
+		a1     [i] = VREG(v->regs,adsr1);
+		gain   [i] = VREG(v->regs,gain);
+	}
+
+	short rate [voice_count];
+	short next [voice_count];
+
+	#if SPC_DSP_SSE2
+	{
+		__m128i const E  = _mm_loadu_si128( (__m128i const*) env );
+		__m128i const H  = _mm_loadu_si128( (__m128i const*) hidden );
+		__m128i const A0 = _mm_loadu_si128( (__m128i const*) a0 );
+		__m128i const A1 = _mm_loadu_si128( (__m128i const*) a1 );
+		__m128i const G  = _mm_loadu_si128( (__m128i const*) gain );
+		__m128i M = _mm_loadu_si128( (__m128i const*) mode );
+
+		#define K( n ) _mm_set1_epi16( n )
+		#define SEL( mask, a, b ) _mm_or_si128( _mm_and_si128( mask, a ), _mm_andnot_si128( mask, b ) )
+
+		__m128i const attack = _mm_cmpeq_epi16( M, K( env_attack ) );
+		__m128i const decay  = _mm_cmpeq_epi16( M, K( env_decay ) );
+
+		// Exponential decrease, shared by ADSR decay/sustain and GAIN mode 5
+		__m128i e = _mm_sub_epi16( E, K( 1 ) );
+		__m128i const expo = _mm_sub_epi16( e, _mm_srai_epi16( e, 8 ) );
+
+		// ADSR
+		__m128i const ar = _mm_add_epi16( _mm_slli_epi16( _mm_and_si128( A0, K( 0x0F ) ), 1 ), K( 1 ) );
+		__m128i const ar_env = _mm_add_epi16( E, SEL( _mm_cmpeq_epi16( ar, K( 31 ) ), K( 0x400 ), K( 0x20 ) ) );
+		__m128i const dr = _mm_add_epi16( _mm_and_si128( _mm_srli_epi16( A0, 3 ), K( 0x0E ) ), K( 0x10 ) );
+		__m128i adsr_rate = SEL( decay, dr, _mm_and_si128( A1, K( 0x1F ) ) );
+		adsr_rate = SEL( attack, ar, adsr_rate );
+		__m128i const adsr_env = SEL( attack, ar_env, expo );
+
+		// GAIN: direct, linear decrease, exponential decrease, linear and
+		// two-slope linear increase
+		__m128i const gmode = _mm_srli_epi16( G, 5 );
+		__m128i const direct = _mm_cmplt_epi16( gmode, K( 4 ) );
+		__m128i const bent = _mm_and_si128( _mm_cmpeq_epi16( gmode, K( 7 ) ),
+				_mm_or_si128( _mm_cmplt_epi16( H, K( 0 ) ), _mm_cmpgt_epi16( H, K( 0x5FF ) ) ) );
+		__m128i gain_env = _mm_add_epi16( E, SEL( bent, K( 0x08 ), K( 0x20 ) ) );
+		gain_env = SEL( _mm_cmplt_epi16( gmode, K( 6 ) ), expo, gain_env );
+		gain_env = SEL( _mm_cmpeq_epi16( gmode, K( 4 ) ), _mm_sub_epi16( E, K( 0x20 ) ), gain_env );
+		gain_env = SEL( direct, _mm_slli_epi16( G, 4 ), gain_env );
+		__m128i const gain_rate = SEL( direct, K( 31 ), _mm_and_si128( G, K( 0x1F ) ) );
+
+		__m128i const adsr = _mm_cmpeq_epi16( _mm_and_si128( A0, K( 0x80 ) ), K( 0x80 ) );
+		e = SEL( adsr, adsr_env, gain_env );
+		__m128i const data = SEL( adsr, A1, G );
+		_mm_storeu_si128( (__m128i*) rate, SEL( adsr, adsr_rate, gain_rate ) );
+
+		// Sustain level
+		__m128i const level = _mm_cmpeq_epi16( _mm_srai_epi16( e, 8 ), _mm_srli_epi16( data, 5 ) );
+		M = SEL( _mm_and_si128( level, decay ), K( env_sustain ), M );
+		_mm_storeu_si128( (__m128i*) hidden, e );
+
+		// Clamp, which ends the attack
+		__m128i const clamped = _mm_max_epi16( _mm_min_epi16( e, K( 0x7FF ) ), K( 0 ) );
+		__m128i const over = _mm_xor_si128( _mm_cmpeq_epi16( clamped, e ), K( -1 ) );
+		M = SEL( _mm_and_si128( over, attack ), K( env_decay ), M );
+		_mm_storeu_si128( (__m128i*) next, clamped );
+		_mm_storeu_si128( (__m128i*) mode, M );
+
+		// Release only counts down
+		_mm_storeu_si128( (__m128i*) env, _mm_max_epi16( _mm_sub_epi16( E, K( 0x8 ) ), K( 0 ) ) );
+
+		#undef SEL
+		#undef K
+	}
+	#else
+	{
+		int16x8_t const E  = vld1q_s16( env );
+		int16x8_t const H  = vld1q_s16( hidden );
+		int16x8_t const A0 = vld1q_s16( a0 );
+		int16x8_t const A1 = vld1q_s16( a1 );
+		int16x8_t const G  = vld1q_s16( gain );
+		int16x8_t M = vld1q_s16( mode );
+
+		#define K( n ) vdupq_n_s16( n )
+
+		uint16x8_t const attack = vceqq_s16( M, K( env_attack ) );
+		uint16x8_t const decay  = vceqq_s16( M, K( env_decay ) );
+
+		// Exponential decrease, shared by ADSR decay/sustain and GAIN mode 5
+		int16x8_t e = vsubq_s16( E, K( 1 ) );
+		int16x8_t const expo = vsubq_s16( e, vshrq_n_s16( e, 8 ) );
+
+		// ADSR
+		int16x8_t const ar = vaddq_s16( vshlq_n_s16( vandq_s16( A0, K( 0x0F ) ), 1 ), K( 1 ) );
+		int16x8_t const ar_env = vaddq_s16( E, vbslq_s16( vceqq_s16( ar, K( 31 ) ), K( 0x400 ), K( 0x20 ) ) );
+		int16x8_t const dr = vaddq_s16( vandq_s16( vshrq_n_s16( A0, 3 ), K( 0x0E ) ), K( 0x10 ) );
+		int16x8_t adsr_rate = vbslq_s16( decay, dr, vandq_s16( A1, K( 0x1F ) ) );
+		adsr_rate = vbslq_s16( attack, ar, adsr_rate );
+		int16x8_t const adsr_env = vbslq_s16( attack, ar_env, expo );
+
+		// GAIN: direct, linear decrease, exponential decrease, linear and
+		// two-slope linear increase
+		int16x8_t const gmode = vshrq_n_s16( G, 5 );
+		uint16x8_t const direct = vcltq_s16( gmode, K( 4 ) );
+		uint16x8_t const bent = vandq_u16( vceqq_s16( gmode, K( 7 ) ),
+				vorrq_u16( vcltq_s16( H, K( 0 ) ), vcgtq_s16( H, K( 0x5FF ) ) ) );
+		int16x8_t gain_env = vaddq_s16( E, vbslq_s16( bent, K( 0x08 ), K( 0x20 ) ) );
+		gain_env = vbslq_s16( vcltq_s16( gmode, K( 6 ) ), expo, gain_env );
+		gain_env = vbslq_s16( vceqq_s16( gmode, K( 4 ) ), vsubq_s16( E, K( 0x20 ) ), gain_env );
+		gain_env = vbslq_s16( direct, vshlq_n_s16( G, 4 ), gain_env );
+		int16x8_t const gain_rate = vbslq_s16( direct, K( 31 ), vandq_s16( G, K( 0x1F ) ) );
+
+		uint16x8_t const adsr = vtstq_s16( A0, K( 0x80 ) );
+		e = vbslq_s16( adsr, adsr_env, gain_env );
+		int16x8_t const data = vbslq_s16( adsr, A1, G );
+		vst1q_s16( rate, vbslq_s16( adsr, adsr_rate, gain_rate ) );
+
+		// Sustain level
+		uint16x8_t const level = vceqq_s16( vshrq_n_s16( e, 8 ), vshrq_n_s16( data, 5 ) );
+		M = vbslq_s16( vandq_u16( level, decay ), K( env_sustain ), M );
+		vst1q_s16( hidden, e );
+
+		// Clamp, which ends the attack
+		int16x8_t const clamped = vmaxq_s16( vminq_s16( e, K( 0x7FF ) ), K( 0 ) );
+		uint16x8_t const over = vmvnq_u16( vceqq_s16( clamped, e ) );
+		M = vbslq_s16( vandq_u16( over, attack ), K( env_decay ), M );
+		vst1q_s16( next, clamped );
+		vst1q_s16( mode, M );
+
+		// Release only counts down
+		vst1q_s16( env, vmaxq_s16( vsubq_s16( E, K( 0x8 ) ), K( 0 ) ) );
+
+		#undef K
+	}
+	#endif
+
+	for ( int i = 0; i < voice_count; i++ )
+	{
+		voice_t* const v = &voices [i];
+		if ( !(run & v->vbit) )
+			continue;
+
+		if ( v->env_mode == env_release )
+		{
+			v->env = env [i];
+			continue;
+		}
+
+		v->env_mode   = (env_mode_t) mode [i];
+		v->hidden_env = hidden [i];
+		if ( !read_counter( rate [i] ) )
+			v->env = next [i]; // nothing else is controlled by the counter
+	}
+#else
+	for ( int i = 0; i < voice_count; i++ )
+	{
+		if ( run & voices [i].vbit )
+		{
+			m.t_adsr0 = adsr0 [i];
+			run_envelope( &voices [i] );
+		}
+	}
+#endif
+}
+
+// Clocks 22-25: echo reads and the 8-tap FIR
+void SPC_DSP::echo_fir()
+{
+#if SPC_DSP_SSE2 || SPC_DSP_NEON
+	if ( ++m.echo_hist_pos >= &m.echo_hist [echo_hist_size] )
+		m.echo_hist_pos = m.echo_hist;
+
+	m.t_echo_ptr = (m.t_esa * 0x100 + m.echo_offset) & 0xFFFF;
+	echo_read( 0 );
+	echo_read( 1 );
+
+	// Taps 0-7 use history 1-8, stored as consecutive left/right pairs
+	int const* hist = ECHO_FIR( 1 );
+	int tap [16];
+
+	#if SPC_DSP_SSE2
+	{
+		__m128i c0 = _mm_setr_epi16(
+				(int8_t) REG(fir + 0x00), (int8_t) REG(fir + 0x00), (int8_t) REG(fir + 0x10), (int8_t) REG(fir + 0x10),
+				(int8_t) REG(fir + 0x20), (int8_t) REG(fir + 0x20), (int8_t) REG(fir + 0x30), (int8_t) REG(fir + 0x30) );
+		__m128i c1 = _mm_setr_epi16(
+				(int8_t) REG(fir + 0x40), (int8_t) REG(fir + 0x40), (int8_t) REG(fir + 0x50), (int8_t) REG(fir + 0x50),
+				(int8_t) REG(fir + 0x60), (int8_t) REG(fir + 0x60), (int8_t) REG(fir + 0x70), (int8_t) REG(fir + 0x70) );
+
+		// History is 15-bit, so packing is exact
+		__m128i h0 = _mm_packs_epi32( _mm_loadu_si128( (__m128i const*) hist ),
+				_mm_loadu_si128( (__m128i const*) (hist + 4) ) );
+		__m128i h1 = _mm_packs_epi32( _mm_loadu_si128( (__m128i const*) (hist + 8) ),
+				_mm_loadu_si128( (__m128i const*) (hist + 12) ) );
+
+		__m128i l0 = _mm_mullo_epi16( h0, c0 ), u0 = _mm_mulhi_epi16( h0, c0 );
+		__m128i l1 = _mm_mullo_epi16( h1, c1 ), u1 = _mm_mulhi_epi16( h1, c1 );
+		_mm_storeu_si128( (__m128i*) tap,        _mm_srai_epi32( _mm_unpacklo_epi16( l0, u0 ), 6 ) );
+		_mm_storeu_si128( (__m128i*) (tap + 4),  _mm_srai_epi32( _mm_unpackhi_epi16( l0, u0 ), 6 ) );
+		_mm_storeu_si128( (__m128i*) (tap + 8),  _mm_srai_epi32( _mm_unpacklo_epi16( l1, u1 ), 6 ) );
+		_mm_storeu_si128( (__m128i*) (tap + 12), _mm_srai_epi32( _mm_unpackhi_epi16( l1, u1 ), 6 ) );
+	}
+	#else
+	{
+		int c [16];
+		for ( int i = 0; i < 16; i++ )
+			c [i] = (int8_t) REG(fir + (i >> 1) * 0x10);
+
+		for ( int i = 0; i < 16; i += 4 )
+			vst1q_s32( tap + i, vshrq_n_s32( vmulq_s32( vld1q_s32( hist + i ), vld1q_s32( c + i ) ), 6 ) );
+	}
+	#endif
+
+	// Taps 0-6 add up without wrapping; only the last one is truncated separately
+	int l = 0;
+	int r = 0;
+	for ( int i = 0; i < 14; i += 2 )
+	{
+		l += tap [i];
+		r += tap [i + 1];
+	}
+
+	l = (int16_t) l;
+	r = (int16_t) r;
+
+	l += (int16_t) tap [14];
+	r += (int16_t) tap [15];
+
+	CLAMP16( l );
+	CLAMP16( r );
+
+	m.t_echo_in [0] = l & ~1;
+	m.t_echo_in [1] = r & ~1;
+#else
+	echo_22();
+	echo_23();
+	echo_24();
+	echo_25();
+#endif
+}
+
+void SPC_DSP::run_window()
+{
+	voice_t* const voices = m.voices;
+
+	// Clock 30. The right echo write moves ahead of voice 0's V3c, which
+	// doesn't touch echo state, so that it precedes all of the RAM reads below.
+	misc_30();
+	echo_30();
+
+	// What the serial path keeps in m.t_* while a voice goes from V2 to V4.
+	// Voice 0 did V2 and V3a/b at the end of the previous window.
+	int pitch     [voice_count];
+	int adsr0     [voice_count];
+	int header    [voice_count];
+	int brr_byte  [voice_count];
+	int next_addr [voice_count];
+
+	pitch     [0] = m.t_pitch;
+	adsr0     [0] = m.t_adsr0;
+	header    [0] = m.t_brr_header;
+	brr_byte  [0] = m.t_brr_byte;
+	next_addr [0] = m.t_brr_next_addr;
+
+	// V1 (for the previous voice's directory entry), V2 and V3a/b of voices 1-7
+	for ( int i = 1; i < voice_count; i++ )
+	{
+		voice_t* const v = &voices [i];
+		voice_V1( &voices [(i + 1) & 7] );
+		voice_V2( v );
+		voice_V3a( v );
+		voice_V3b( v );
+
+		pitch     [i] = m.t_pitch;
+		adsr0     [i] = m.t_adsr0;
+		header    [i] = m.t_brr_header;
+		brr_byte  [i] = m.t_brr_byte;
+		next_addr [i] = m.t_brr_next_addr;
+	}
+
+	// V3c: key-on setup
+	int kon = 0;
+	for ( int i = 0; i < voice_count; i++ )
+	{
+		voice_t* const v = &voices [i];
+		if ( v->kon_delay )
+		{
+			m.t_brr_next_addr = next_addr [i];
+			m.t_brr_header    = header [i];
+			voice_kon_delay( v );
+			header [i] = m.t_brr_header;
+			kon |= v->vbit;
+		}
+	}
+
+	// V3c: output, pitch modulation and volume in lockstep
+	int out [voice_count];
+	int amp [2] [voice_count];
+	voice_lanes( out, pitch, m.t_pmon & ~kon, amp );
+
+	// V3c: envelope in lockstep, after the output it scaled
+	for ( int i = 0; i < voice_count; i++ )
+		voices [i].t_envx_out = (uint8_t) (voices [i].env >> 4);
+	envelope_lanes( adsr0, header );
+
+	// V4-V9 per voice: BRR decoding and pitch, registers, and the output and
+	// echo totals, which are clamped after each voice
+	int endx   = REG(endx);
+	int main_l = m.t_main_out [0];
+	int main_r = m.t_main_out [1];
+	int echo_l = m.t_echo_out [0];
+	int echo_r = m.t_echo_out [1];
+	for ( int i = 0; i < voice_count; i++ )
+	{
+		voice_t* const v = &voices [i];
+
+		// Pitch is never added during KON
+		if ( kon & v->vbit )
+			pitch [i] = 0;
+
+		m.t_brr_header    = header [i];
+		m.t_brr_byte      = brr_byte [i];
+		m.t_brr_next_addr = next_addr [i];
+		m.t_pitch         = pitch [i];
+		voice_decode( v );
+
+		endx |= m.t_looped;
+		if ( v->kon_delay == 5 )
+			endx &= ~v->vbit;
+
+		VREG(v->regs,outx) = XVREG(v->regs,outx) = (uint8_t) (out [i] >> 8);
+		VREG(v->regs,envx) = XVREG(v->regs,envx) = v->t_envx_out;
+
+		main_l += amp [0] [i];
+		main_r += amp [1] [i];
+		CLAMP16( main_l );
+		CLAMP16( main_r );
+
+		if ( m.t_eon & v->vbit )
+		{
+			echo_l += amp [0] [i];
+			echo_r += amp [1] [i];
+			CLAMP16( echo_l );
+			CLAMP16( echo_r );
+		}
+	}
+	m.t_main_out [0] = main_l;
+	m.t_main_out [1] = main_r;
+	m.t_echo_out [0] = echo_l;
+	m.t_echo_out [1] = echo_r;
+
+	REG(endx) = XREG(endx) = m.endx_buf = (uint8_t) endx;
+	m.outx_buf = (uint8_t) (out [voice_count - 1] >> 8);
+	m.envx_buf = voices [voice_count - 1].t_envx_out;
+	m.t_output = out [voice_count - 1];
+
+	// Clocks 20-25: V1 computes voice 0's directory entry, then its V2 and V3a/b
+	voice_V1( &voices [1] );
+	voice_V2( &voices [0] );
+	voice_V3a( &voices [0] );
+	voice_V3b( &voices [0] );
+
+	// Clocks 22-29
+	echo_fir();
+	echo_26();
+	misc_27();
+	echo_27();
+	misc_28();
+	echo_28();
+	misc_29();
+	echo_29();
+}
+
 
 //// Timing
 
@@ -1165,10 +1915,8 @@ PHASE(31)  V(V4,0)       V(V1,2)\
 
 #if !SPC_DSP_CUSTOM_RUN
 
-void SPC_DSP::run( int clocks_remain )
+void SPC_DSP::run_clocks( int clocks_remain )
 {
-	require( clocks_remain > 0 );
-
 	int const phase = m.phase;
 	m.phase = (phase + clocks_remain) & 31;
 	switch ( phase )
@@ -1184,9 +1932,39 @@ void SPC_DSP::run( int clocks_remain )
 	}
 }
 
+void SPC_DSP::run( int clocks_remain )
+{
+	require( clocks_remain > 0 );
+
+	if ( Settings.ParallelVoices && !take_spc_snapshot )
+	{
+		// Clock up to the start of a window, then run whole windows
+		int lead = (window_phase - m.phase) & 31;
+		if ( clocks_remain >= lead + 32 )
+		{
+			if ( lead )
+				run_clocks( lead );
+			clocks_remain -= lead;
+
+			do
+			{
+				run_window();
+				clocks_remain -= 32;
+			}
+			while ( clocks_remain >= 32 );
+
+			if ( !clocks_remain )
+				return;
+		}
+	}
+
+	run_clocks( clocks_remain );
+}
+
 #endif
 
 
+
 //// Setup
 
 void SPC_DSP::init( void* ram_64k )
@@ -1199,6 +1977,11 @@ void SPC_DSP::init( void* ram_64k )
 
 	stereo_switch = 0xffff;
 	take_spc_snapshot = 0;
+	init_gauss_taps();
+
+	memset( ram_writes, 0, sizeof ram_writes );
+	for ( int i = 0; i < brr_cache_size; i++ )
+		brr_cache [i].addr = -1;
 	spc_snapshot_callback = 0;
 
 	#ifndef NDEBUG
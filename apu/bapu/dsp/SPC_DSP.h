@@ -46,6 +46,17 @@ public:
 	// a pair of samples is be generated.
 	void run( int clock_count );
 
+	// Tell the DSP about writes to its RAM made behind its back, so decoded
+	// BRR blocks aren't reused after their data changed. Call ram_written()
+	// for each write to RAM, and ram_replaced() after loading all of it.
+	void ram_written( unsigned addr ) { ram_writes [(addr >> 8) & 0xFF]++; }
+	void ram_replaced();
+
+	// RAM the echo buffer can write to before the next register write, as
+	// *start and *size in bytes (wrapping at 0x10000). Size is 0 if echo
+	// writes are off.
+	void echo_extent( int* start, int* size ) const;
+
 // Sound control
 
 	// Mutes voices corresponding to non-zero bits in mask (issues repeated KOFF events).
@@ -209,6 +220,22 @@ private:
 	};
 	state_t m;
 
+	// Decoded BRR blocks, so that looping samples aren't decoded every time
+	// around. An entry is good while neither RAM page the block lies in has
+	// been written since and the voice's previous two samples match.
+	enum { brr_cache_size = 4096 }; // indexed by low bits of block address
+	struct brr_cache_t
+	{
+		int addr;       // block address, or -1 if unused
+		unsigned writes [2]; // ram_writes of the block's first and last page
+		short pcm [2 + 16]; // two samples before the block, then its samples
+	};
+	brr_cache_t brr_cache [brr_cache_size];
+
+	// Writes per 256-byte RAM page. Only compared for equality, so wrapping
+	// around is harmless.
+	unsigned ram_writes [0x100];
+
 	void init_counter();
 	void run_counters();
 	unsigned read_counter( int rate );
@@ -216,6 +243,8 @@ private:
 	int  interpolate( voice_t const* v );
 	void run_envelope( voice_t* const v );
 	void decode_brr( voice_t* v );
+	void cache_brr( brr_cache_t*, int addr, int p1, int p2 );
+	bool brr_cache_valid( brr_cache_t const*, int addr ) const;
 
 	void misc_27();
 	void misc_28();
@@ -223,6 +252,9 @@ private:
 	void misc_30();
 
 	void voice_output( voice_t const* v, int ch );
+	void voice_kon_delay( voice_t* const );
+	void voice_envelope( voice_t* const );
+	void voice_decode( voice_t* const );
 	void voice_V1( voice_t* const );
 	void voice_V2( voice_t* const );
 	void voice_V3( voice_t* const );
@@ -252,6 +284,12 @@ private:
 	void echo_29();
 	void echo_30();
 
+	void run_clocks( int clock_count );
+	void run_window();
+	void voice_lanes( int* out, int* pitch, int pmon, int (*amp) [voice_count] );
+	void envelope_lanes( int const* adsr0, int const* header );
+	void echo_fir();
+
 	void soft_reset_common();
 };
 
@@ -1,4 +1,5 @@
 #include "../snes/snes.hpp"
+#include "../../../dirty.h"
 
 #define DSP_CPP
 namespace SNES {
@@ -12,12 +13,15 @@ void DSP::power()
   spc_dsp.init(smp.apuram);
   spc_dsp.reset();
   clock = 0;
+  owed = 0;
 }
 
 void DSP::reset()
 {
+  spc_dsp.ram_replaced();
   spc_dsp.soft_reset();
   clock = 0;
+  owed = 0;
 }
 
 static void from_dsp_to_state (uint8 **buf, void *var, size_t size)
@@ -39,12 +43,16 @@ void DSP::save_state (uint8 **ptr)
 
 void DSP::load_state (uint8 **ptr)
 {
+	// Every caller has just loaded the RAM as well.
+	spc_dsp.ram_replaced();
 	spc_dsp.copy_state(ptr, to_dsp_from_state);
+	owed = 0;
 }
 
 DSP::DSP()
 {
 	clock = 0;
+	owed = 0;
 }
 
 }
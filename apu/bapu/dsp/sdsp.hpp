@@ -13,6 +13,27 @@ public:
       spc_dsp.run (clock);
       clock = 0;
     }
+    owed = 0;
+  }
+
+  //A scanline ended in SMP::enter(): the DSP would have been synced here.
+  //That is put off until the SMP touches RAM the DSP could have read or
+  //written by then, see settle() and echo_hit().
+  inline void owe (void) {
+    if (!owed) spc_dsp.echo_extent (&echo_start, &echo_size);
+    owed = clock;
+  }
+
+  inline void settle (void) {
+    if (owed) {
+      spc_dsp.run (owed);
+      clock -= owed;
+      owed = 0;
+    }
+  }
+
+  inline bool echo_hit (uint16 addr) const {
+    return owed && ((addr - echo_start) & 0xffff) < echo_size;
   }
 
   inline void write(uint8 addr, uint8 data) {
@@ -29,6 +50,9 @@ public:
   DSP();
 
   SPC_DSP spc_dsp;
+  int32 owed;
+  int echo_start;
+  int echo_size;
 };
 
 extern DSP dsp;
@@ -28,24 +28,32 @@ uint8 SMP::op_read(uint16 addr) {
   tick();
   if((addr & 0xfff0) == 0x00f0) return mmio_read(addr);
   if(addr >= 0xffc0 && status.iplrom_enable) return iplrom[addr & 0x3f];
+  if(dsp.echo_hit(addr)) dsp.settle();
   return apuram[addr];
 }
 
 void SMP::op_write(uint16 addr, uint8 data) {
   tick();
+  dsp.settle();
   if((addr & 0xfff0) == 0x00f0) mmio_write(addr, data);
   apuram[addr] = data;  //all writes go to RAM, even MMIO writes
+  S9xMarkDirty(Dirty.APURAM, addr);
+  dsp.spc_dsp.ram_written(addr);
 }
 
 uint8 SMP::op_readstack()
 {
   tick();
+  if(dsp.echo_hit(0x0100 | (uint8)(regs.sp + 1))) dsp.settle();
   return apuram[0x0100 | ++regs.sp];
 }
 
 void SMP::op_writestack(uint8 data)
 {
   tick();
+  dsp.settle();
+  S9xMarkDirty(Dirty.APURAM, 0x0100);
+  dsp.spc_dsp.ram_written(0x0100);
   apuram[0x0100 | regs.sp--] = data;
 }
 
@@ -4,6 +4,8 @@ unsigned SMP::port_read(unsigned addr) {
 
 void SMP::port_write(unsigned addr, unsigned data) {
   apuram[0xf4 + (addr & 3)] = data;
+  S9xMarkDirty(Dirty.APURAM, 0xf4);
+  dsp.spc_dsp.ram_written(0xf4);
 }
 
 unsigned SMP::mmio_read(unsigned addr) {
@@ -5,6 +5,7 @@ char tmp[1024];
 #endif
 
 #include "../snes/snes.hpp"
+#include "../../../dirty.h"
 
 #define SMP_CPP
 namespace SNES {
@@ -25,6 +26,18 @@ void SMP::enter() {
   while(clock < 0) op_step();
 }
 
+//Runs several scanlines at once, their clocks already taken from clock. The
+//DSP is owed its sync at the end of each line rather than run there.
+void SMP::enter(const int32 *lines, unsigned count) {
+  int32 line_end = 0;
+  for(unsigned n = 0; n < count; n++) line_end -= lines[n];
+  for(unsigned n = 0; n < count; n++) {
+    line_end += lines[n];
+    while(clock < line_end) op_step();
+    dsp.owe();
+  }
+}
+
 void SMP::power() {
   Processor::clock = 0;
 
@@ -10,12 +10,14 @@ public:
   void mmio_write(unsigned addr, unsigned data);
 
   void enter();
+  void enter(const int32 *lines, unsigned count);
   void power();
   void reset();
 
   void load_state(uint8 **);
   void save_state(uint8 **);
   void save_spc (uint8 *);
+  void load_spc (const uint8 *);
   SMP();
   ~SMP();
 
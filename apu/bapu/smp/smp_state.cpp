@@ -70,6 +70,44 @@ void SMP::save_spc (uint8 *block) {
 }
 
 
+void SMP::load_spc (const uint8 *block) {
+  const spc_file *in = (const spc_file *) block;
+
+  memcpy (apuram, in->apuram, 65536);
+
+  regs.pc = in->pc_low | (in->pc_high << 8);
+  regs.B.a = in->a;
+  regs.x = in->x;
+  regs.B.y = in->y;
+  regs.p = in->psw;
+  regs.sp = in->sp;
+
+  // The control, DSP address and timer target registers can't be read
+  // back, so dumps keep the last values written in RAM, like hardware.
+  // Don't let the control write clear the ports.
+  mmio_write (0xf1, apuram[0xf1] & ~0x30);
+  mmio_write (0xf2, apuram[0xf2]);
+  status.ram00f8 = apuram[0xf8];
+  status.ram00f9 = apuram[0xf9];
+  timer0.target = apuram[0xfa];
+  timer1.target = apuram[0xfb];
+  timer2.target = apuram[0xfc];
+  timer0.stage3_ticks = apuram[0xfd] & 15;
+  timer1.stage3_ticks = apuram[0xfe] & 15;
+  timer2.stage3_ticks = apuram[0xff] & 15;
+
+  // What the S-CPU last wrote to the ports
+  for (int i = 0; i < 4; i++)
+  {
+    cpu.port_write (i, apuram[0xf4 + i]);
+  }
+
+  for (int i = 0; i < 128; i++)
+  {
+    dsp.write (i, in->dsp_registers[i]);
+  }
+}
+
 void SMP::save_state(uint8 **block) {
   uint8 *ptr = *block;
   memcpy(ptr, apuram, 64 * 1024);
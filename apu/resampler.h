@@ -11,18 +11,150 @@
 #include <cassert>
 #include <cstdint>
 #include <cmath>
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RESAMPLER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RESAMPLER_NEON
+#include <arm_neon.h>
+#endif
+
+// Four float lanes for the interpolators, which keep a stereo frame in lanes
+// 0-1 and, when summing taps, the frame after it in lanes 2-3.
+#if defined(RESAMPLER_SSE2)
+typedef __m128 resampler_vec;
+
+static inline resampler_vec rv_load(const float *p) { return _mm_loadu_ps(p); }
+static inline resampler_vec rv_load_frame(const float *p) { return _mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)p)); }
+static inline resampler_vec rv_set(float f) { return _mm_set1_ps(f); }
+static inline resampler_vec rv_add(resampler_vec a, resampler_vec b) { return _mm_add_ps(a, b); }
+static inline resampler_vec rv_sub(resampler_vec a, resampler_vec b) { return _mm_sub_ps(a, b); }
+static inline resampler_vec rv_mul(resampler_vec a, resampler_vec b) { return _mm_mul_ps(a, b); }
+static inline resampler_vec rv_fold(resampler_vec v) { return _mm_add_ps(v, _mm_movehl_ps(v, v)); }
+
+// Truncates lanes 0-1 and stores them saturated as one stereo frame.
+static inline void rv_store_frame(int16_t *dst, resampler_vec v)
+{
+    __m128i i = _mm_cvttps_epi32(v);
+    int32_t frame = _mm_cvtsi128_si32(_mm_packs_epi32(i, i));
+    memcpy(dst, &frame, 4);
+}
+
+static inline void rv_widen(const int16_t *src, float *dst, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_ps(dst + i,     _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)));
+        _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)));
+    }
+    for (; i < count; i++)
+        dst[i] = src[i];
+}
+#elif defined(RESAMPLER_NEON)
+typedef float32x4_t resampler_vec;
+
+static inline resampler_vec rv_load(const float *p) { return vld1q_f32(p); }
+static inline resampler_vec rv_load_frame(const float *p) { return vcombine_f32(vld1_f32(p), vdup_n_f32(0.0f)); }
+static inline resampler_vec rv_set(float f) { return vdupq_n_f32(f); }
+static inline resampler_vec rv_add(resampler_vec a, resampler_vec b) { return vaddq_f32(a, b); }
+static inline resampler_vec rv_sub(resampler_vec a, resampler_vec b) { return vsubq_f32(a, b); }
+static inline resampler_vec rv_mul(resampler_vec a, resampler_vec b) { return vmulq_f32(a, b); }
+static inline resampler_vec rv_fold(resampler_vec v) { return vcombine_f32(vadd_f32(vget_low_f32(v), vget_high_f32(v)), vdup_n_f32(0.0f)); }
+
+static inline void rv_store_frame(int16_t *dst, resampler_vec v)
+{
+    int16x4_t n = vqmovn_s32(vcvtq_s32_f32(v));
+    dst[0] = vget_lane_s16(n, 0);
+    dst[1] = vget_lane_s16(n, 1);
+}
+
+static inline void rv_widen(const int16_t *src, float *dst, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        int16x8_t s = vld1q_s16(src + i);
+        vst1q_f32(dst + i,     vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))));
+        vst1q_f32(dst + i + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))));
+    }
+    for (; i < count; i++)
+        dst[i] = src[i];
+}
+#else
+struct resampler_vec
+{
+    float v[4];
+};
 
+static inline resampler_vec rv_load(const float *p) { return { { p[0], p[1], p[2], p[3] } }; }
+static inline resampler_vec rv_load_frame(const float *p) { return { { p[0], p[1], 0.0f, 0.0f } }; }
+static inline resampler_vec rv_set(float f) { return { { f, f, f, f } }; }
+static inline resampler_vec rv_add(resampler_vec a, resampler_vec b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+static inline resampler_vec rv_sub(resampler_vec a, resampler_vec b) { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+static inline resampler_vec rv_mul(resampler_vec a, resampler_vec b) { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+static inline resampler_vec rv_fold(resampler_vec v) { return { { v.v[0] + v.v[2], v.v[1] + v.v[3], 0.0f, 0.0f } }; }
+
+static inline void rv_store_frame(int16_t *dst, resampler_vec v)
+{
+    for (int c = 0; c < 2; c++)
+    {
+        int n = (int)v.v[c];
+        dst[c] = (int16_t)(((int16_t)n != n) ? (n >> 31) ^ 0x7fff : n);
+    }
+}
+
+static inline void rv_widen(const int16_t *src, float *dst, int count)
+{
+    for (int i = 0; i < count; i++)
+        dst[i] = src[i];
+}
+#endif
+
+// Single-producer, single-consumer ring of interleaved stereo samples. start
+// and end count samples without ever wrapping, and a sample's slot is its
+// count masked to the power-of-two storage, so there are no divisions. Only
+// the consumer moves start and only the producer moves end; each publishes
+// its index with a release store and reads the other's with an acquire load.
 class Resampler
 {
   public:
-    volatile int end;
+    std::atomic<uint32_t> end;
     int buffer_size;
-    volatile int start;
+    std::atomic<uint32_t> start;
     int16_t *buffer;
+    uint32_t mask;
+
+    // Interpolation. Input frames are widened to float a block at a time
+    // into history, interleaved, and each output frame is interpolated from
+    // the taps frames ending at history_end, at r_frac between the middle
+    // two. Frames past history_end are widened but not yet passed.
+    enum
+    {
+        CUBIC,
+        SINC_8,
+        SINC_16
+    };
+
+    static const int max_taps = 16;
+    static const int history_frames = 512;
+    static const int sinc_phases = 256;
 
     float r_step;
     float r_frac;
-    int   r_left[4], r_right[4];
+    int   quality;
+    int   history_end;
+    float history[history_frames * 2];
+
+    // A contiguous run of samples inside the ring.
+    struct span
+    {
+        int16_t *data;
+        int size;
+    };
 
     static inline int16_t short_clamp(int n)
     {
@@ -34,36 +166,24 @@ class Resampler
         return ((a) < (b) ? (a) : (b));
     }
 
-    static inline float hermite(float mu1, float a, float b, float c, float d)
-    {
-        float mu2, mu3, m0, m1, a0, a1, a2, a3;
-
-        mu2 = mu1 * mu1;
-        mu3 = mu2 * mu1;
-
-        m0 = (c - a) * 0.5;
-        m1 = (d - b) * 0.5;
-
-        a0 = +2 * mu3 - 3 * mu2 + 1;
-        a1 = mu3 - 2 * mu2 + mu1;
-        a2 = mu3 - mu2;
-        a3 = -2 * mu3 + 3 * mu2;
-
-        return (a0 * b) + (a1 * m0) + (a2 * m1) + (a3 * c);
-    }
-
     Resampler()
     {
         this->buffer_size = 0;
         buffer = NULL;
+        mask = 0;
+        start = 0;
+        end = 0;
         r_step = 1.0;
+        quality = CUBIC;
+        clear_history();
     }
 
     Resampler(int num_samples)
     {
         buffer = NULL;
-        resize(num_samples);
         r_step = 1.0;
+        quality = CUBIC;
+        resize(num_samples);
     }
 
     ~Resampler()
@@ -77,41 +197,169 @@ class Resampler
         r_step = ratio;
     }
 
-    inline void clear(void)
+    // CUBIC, SINC_8 or SINC_16. Higher ones delay the output by a few more
+    // input frames.
+    inline void set_quality(int q)
     {
-        if (!buffer)
-            return;
+        if (q < CUBIC || q > SINC_16)
+            q = CUBIC;
 
-        start = 0;
-        end = 0;
-        memset(buffer, 0, buffer_size * 2);
+        if (q != quality)
+        {
+            quality = q;
+            clear_history();
+        }
+    }
 
+    inline void clear_history(void)
+    {
+        memset(history, 0, max_taps * 2 * sizeof(float));
+        history_end = max_taps;
         r_frac = 0.0;
-        r_left[0] = r_left[1] = r_left[2] = r_left[3] = 0;
-        r_right[0] = r_right[1] = r_right[2] = r_right[3] = 0;
     }
 
-    inline void dump(unsigned int num_samples)
+    // Windowed-sinc (Blackman) coefficients for each of sinc_phases + 1
+    // fractional positions. Each row holds every coefficient twice, to line
+    // up with interleaved frames, then the step to the next row's for
+    // interpolating between phases.
+    static bool build_sinc_table(float *table, int taps)
     {
-        if ((unsigned int)space_filled() >= num_samples)
-            start = (start + num_samples) % buffer_size;
+        const double pi = 3.14159265358979323846;
+        const double cutoff = 0.9;
+        int row_size = taps * 4;
+
+        for (int p = 0; p <= sinc_phases; p++)
+        {
+            double mu = (double)p / sinc_phases;
+            double c[max_taps];
+            double sum = 0.0;
+
+            for (int j = 0; j < taps; j++)
+            {
+                double x = j - (taps / 2 - 1) - mu;
+                double w = 0.42 + 0.5 * cos(pi * x / (taps / 2)) + 0.08 * cos(2.0 * pi * x / (taps / 2));
+                c[j] = (x == 0.0 ? 1.0 : sin(pi * cutoff * x) / (pi * cutoff * x)) * w;
+                sum += c[j];
+            }
+
+            float *row = table + p * row_size;
+            for (int j = 0; j < taps; j++)
+                row[j * 2] = row[j * 2 + 1] = c[j] / sum;
+        }
+
+        for (int p = 0; p <= sinc_phases; p++)
+        {
+            float *row = table + p * row_size;
+            for (int j = 0; j < taps * 2; j++)
+                row[taps * 2 + j] = p < sinc_phases ? row[row_size + j] - row[j] : 0.0f;
+        }
+
+        return true;
     }
 
-    inline void add_silence(unsigned int num_samples)
+    static const float *sinc_table(int taps)
     {
-         if (space_empty() < num_samples)
-            return;
+        static float table_8[(sinc_phases + 1) * 8 * 4];
+        static float table_16[(sinc_phases + 1) * 16 * 4];
+        static bool built = build_sinc_table(table_8, 8) && build_sinc_table(table_16, 16);
 
-        int first_block_size = min(num_samples, buffer_size - end);
+        (void)built;
+        return taps == 8 ? table_8 : table_16;
+    }
 
-        memset(buffer + end, 0, first_block_size * 2);
+    inline void interpolate_cubic(int16_t *dst)
+    {
+        const float *h = history + (history_end - 4) * 2;
+        float mu1 = r_frac;
+        float mu2 = mu1 * mu1;
+        float mu3 = mu2 * mu1;
+
+        float a0 = +2 * mu3 - 3 * mu2 + 1;
+        float a1 = mu3 - 2 * mu2 + mu1;
+        float a2 = mu3 - mu2;
+        float a3 = -2 * mu3 + 3 * mu2;
+
+        resampler_vec a = rv_load_frame(h);
+        resampler_vec b = rv_load_frame(h + 2);
+        resampler_vec c = rv_load_frame(h + 4);
+        resampler_vec d = rv_load_frame(h + 6);
+
+        resampler_vec m0 = rv_mul(rv_sub(c, a), rv_set(0.5f));
+        resampler_vec m1 = rv_mul(rv_sub(d, b), rv_set(0.5f));
+
+        rv_store_frame(dst, rv_add(rv_add(rv_add(rv_mul(rv_set(a0), b), rv_mul(rv_set(a1), m0)),
+                                          rv_mul(rv_set(a2), m1)), rv_mul(rv_set(a3), c)));
+    }
+
+    inline void interpolate_sinc(int16_t *dst, const float *table, int taps)
+    {
+        const float *h = history + (history_end - taps) * 2;
+        float phase = r_frac * sinc_phases;
+        int p = (int)phase;
+        if (p >= sinc_phases)
+            p = sinc_phases - 1;
+
+        const float *row = table + p * taps * 4;
+        resampler_vec fraction = rv_set(phase - p);
+        resampler_vec sum = rv_set(0.0f);
+
+        for (int j = 0; j < taps * 2; j += 4)
+        {
+            resampler_vec c = rv_add(rv_load(row + j), rv_mul(rv_load(row + taps * 2 + j), fraction));
+            sum = rv_add(sum, rv_mul(rv_load(h + j), c));
+        }
+
+        rv_store_frame(dst, rv_fold(sum));
+    }
+
+    // Widens num_frames frames from the ring, starting at sample position s,
+    // into history at frame `at`.
+    inline void widen(uint32_t s, int num_frames, int at)
+    {
+        int num_samples = num_frames * 2;
+        int first_block_size = min(num_samples, mask + 1 - (s & mask));
+
+        rv_widen(buffer + (s & mask), history + at * 2, first_block_size);
 
         if (num_samples > first_block_size)
-            memset(buffer, 0, (num_samples - first_block_size) * 2);
+            rv_widen(buffer, history + at * 2 + first_block_size, num_samples - first_block_size);
+    }
 
-        end = (end + num_samples) % buffer_size;
+    // Neither side may be running. Samples outside [start, end) are never
+    // read, so the storage is left as it is.
+    inline void clear(void)
+    {
+        if (!buffer)
+            return;
+
+        start.store(0, std::memory_order_relaxed);
+        end.store(0, std::memory_order_release);
+
+        clear_history();
+    }
 
-        return;
+    // Consumer side.
+
+    inline void dump(unsigned int num_samples)
+    {
+        if ((unsigned int)space_filled() >= num_samples)
+            consume(num_samples);
+    }
+
+    // The readable samples from start, up to num_samples of them, that sit
+    // before the ring wraps. A second call after consume() gets the rest.
+    inline span read_span(int num_samples)
+    {
+        uint32_t s = start.load(std::memory_order_relaxed);
+        int filled = end.load(std::memory_order_acquire) - s;
+        int first_block_size = mask + 1 - (s & mask);
+
+        return { buffer + (s & mask), min(num_samples, min(filled, first_block_size)) };
+    }
+
+    inline void consume(int num_samples)
+    {
+        start.store(start.load(std::memory_order_relaxed) + num_samples, std::memory_order_release);
     }
 
     inline bool pull(int16_t *dst, int num_samples)
@@ -119,25 +367,60 @@ class Resampler
         if (space_filled() < num_samples)
             return false;
 
-        int first_block_size = buffer_size - start;
+        uint32_t s = start.load(std::memory_order_relaxed);
+        int first_block_size = min(num_samples, mask + 1 - (s & mask));
 
-        memcpy(dst, buffer + start, min(num_samples, first_block_size) * 2);
+        memcpy(dst, buffer + (s & mask), first_block_size * 2);
 
         if (num_samples > first_block_size)
             memcpy(dst + first_block_size, buffer, (num_samples - first_block_size) * 2);
 
-        start = (start + num_samples) % buffer_size;
+        start.store(s + num_samples, std::memory_order_release);
 
         return true;
     }
 
+    // Producer side.
+
+    inline void add_silence(unsigned int num_samples)
+    {
+        if (space_empty() < (int)num_samples)
+            return;
+
+        uint32_t e = end.load(std::memory_order_relaxed);
+        int first_block_size = min(num_samples, mask + 1 - (e & mask));
+
+        memset(buffer + (e & mask), 0, first_block_size * 2);
+
+        if ((int)num_samples > first_block_size)
+            memset(buffer, 0, (num_samples - first_block_size) * 2);
+
+        end.store(e + num_samples, std::memory_order_release);
+    }
+
+    // Free space from end, up to num_samples of it, that sits before the
+    // ring wraps. Fill it in place and publish it with commit().
+    inline span write_span(int num_samples)
+    {
+        uint32_t e = end.load(std::memory_order_relaxed);
+        int first_block_size = mask + 1 - (e & mask);
+
+        return { buffer + (e & mask), min(num_samples, min(space_empty(), first_block_size)) };
+    }
+
+    inline void commit(int num_samples)
+    {
+        end.store(end.load(std::memory_order_relaxed) + num_samples, std::memory_order_release);
+    }
+
     inline void push_sample(int16_t l, int16_t r)
     {
         if (space_empty() >= 2)
         {
-            buffer[end] = l;
-            buffer[end + 1] = r;
-            end = (end + 2) % buffer_size;
+            uint32_t e = end.load(std::memory_order_relaxed);
+            buffer[e & mask] = l;
+            buffer[(e + 1) & mask] = r;
+            end.store(e + 2, std::memory_order_release);
         }
     }
 
@@ -146,14 +429,15 @@ class Resampler
         if (space_empty() < num_samples)
             return false;
 
-        int first_block_size = min(num_samples, buffer_size - end);
+        uint32_t e = end.load(std::memory_order_relaxed);
+        int first_block_size = min(num_samples, mask + 1 - (e & mask));
 
-        memcpy(buffer + end, src, first_block_size * 2);
+        memcpy(buffer + (e & mask), src, first_block_size * 2);
 
         if (num_samples > first_block_size)
             memcpy(buffer, src + first_block_size, (num_samples - first_block_size) * 2);
 
-        end = (end + num_samples) % buffer_size;
+        end.store(e + num_samples, std::memory_order_release);
 
         return true;
     }
@@ -168,45 +452,67 @@ class Resampler
         }
 
         assert((num_samples & 1) == 0); // resampler always processes both stereo samples
+        if (num_samples <= 0)
+            return;
+
+        int taps = quality == SINC_16 ? 16 : quality == SINC_8 ? 8 : 4;
+        const float *table = taps > 4 ? sinc_table(taps) : NULL;
+
+        uint32_t s = start.load(std::memory_order_relaxed);
+        int unread = (end.load(std::memory_order_acquire) - s) >> 1;
+        int passed = 0;
+        int loaded = history_end;
         int o_position = 0;
 
-        while (o_position < num_samples && space_filled() >= 2)
+        for (;;)
         {
-            int s_left = buffer[start];
-            int s_right = buffer[start + 1];
-            int hermite_val[2];
+            bool done = o_position >= num_samples;
+            if (done && r_frac <= 1.0)
+                break;
 
-            while (r_frac <= 1.0 && o_position < num_samples)
+            // Output needs an input frame not yet passed, like passing one
+            // does. Widen the next block of them once history runs out.
+            if (history_end == loaded)
             {
-                hermite_val[0] = (int)hermite(r_frac, (float)r_left[0], (float)r_left[1], (float)r_left[2], (float)r_left[3]);
-                hermite_val[1] = (int)hermite(r_frac, (float)r_right[0], (float)r_right[1], (float)r_right[2], (float)r_right[3]);
-                data[o_position] = short_clamp(hermite_val[0]);
-                data[o_position + 1] = short_clamp(hermite_val[1]);
-
-                o_position += 2;
-
-                r_frac += r_step;
+                if (unread == 0)
+                    break;
+
+                if (loaded == history_frames)
+                {
+                    memmove(history, history + (history_end - max_taps) * 2, max_taps * 2 * sizeof(float));
+                    history_end = loaded = max_taps;
+                }
+
+                int n = min(unread, history_frames - loaded);
+                n = min(n, (int)(((num_samples - o_position) >> 1) * r_step) + 2);
+                widen(s + (passed + loaded - history_end) * 2, n, loaded);
+                loaded += n;
+                unread -= n;
             }
 
             if (r_frac > 1.0)
             {
-                r_left[0] = r_left[1];
-                r_left[1] = r_left[2];
-                r_left[2] = r_left[3];
-                r_left[3] = s_left;
-
-                r_right[0] = r_right[1];
-                r_right[1] = r_right[2];
-                r_right[2] = r_right[3];
-                r_right[3] = s_right;
-
+                history_end++;
+                passed++;
                 r_frac -= 1.0;
 
-                start += 2;
-                if (start >= buffer_size)
-                    start -= buffer_size;
+                // A frame passed while producing the last sample is taken
+                // now, but no further.
+                if (done)
+                    break;
+                continue;
             }
+
+            if (taps == 4)
+                interpolate_cubic(data + o_position);
+            else
+                interpolate_sinc(data + o_position, table, taps);
+
+            o_position += 2;
+            r_frac += r_step;
         }
+
+        start.store(s + passed * 2, std::memory_order_release);
     }
 
     inline int space_empty(void) const
@@ -216,10 +522,7 @@ class Resampler
 
     inline int space_filled(void) const
     {
-        int size = end - start;
-        if (size < 0)
-            size += buffer_size;
-        return size;
+        return (int)(end.load(std::memory_order_acquire) - start.load(std::memory_order_acquire));
     }
 
     inline int avail(void)
@@ -232,6 +535,8 @@ class Resampler
         return (int)trunc(((size >> 1) - r_frac) / r_step) * 2;
     }
 
+    // buffer_size stays what was asked for, so fill levels and latency are
+    // unchanged; only the storage behind it is rounded up to a power of two.
     void resize(int num_samples)
     {
         if (buffer)
@@ -240,7 +545,13 @@ class Resampler
         if (num_samples & 1)
             num_samples++;
         buffer_size = num_samples;
-        buffer = new int16_t[buffer_size];
+
+        uint32_t storage = 2;
+        while (storage < (uint32_t)buffer_size)
+            storage <<= 1;
+        mask = storage - 1;
+
+        buffer = new int16_t[storage]();
         clear();
     }
 };
@@ -103,6 +103,7 @@ static inline void S9xSetByteFree(uint8 Byte, uint32 Address)
     if (SetAddress >= (uint8 *)CMemory::MAP_LAST)
     {
         *(SetAddress + (Address & 0xffff)) = Byte;
+        Memory.BlockDirty[block][(Address & 0xffff) >> DIRTY_PAGE_SHIFT] = Dirty.Generation;
         return;
     }
 
@@ -123,6 +124,7 @@ static inline void S9xSetByteFree(uint8 Byte, uint32 Address)
         if (Memory.SRAMMask)
         {
             *(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask)) = Byte;
+            S9xMarkDirty(Dirty.SRAM, (((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask);
             CPU.SRAMModified = TRUE;
         }
 
@@ -132,6 +134,7 @@ static inline void S9xSetByteFree(uint8 Byte, uint32 Address)
         if (Multi.sramMaskB)
         {
             *(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB)) = Byte;
+            S9xMarkDirty(Dirty.SRAM, 0x10000 + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB));
             CPU.SRAMModified = TRUE;
         }
 
@@ -141,6 +144,7 @@ static inline void S9xSetByteFree(uint8 Byte, uint32 Address)
         if (Memory.SRAMMask)
         {
             *(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0x1f0000) >> 3)) & Memory.SRAMMask)) = Byte;
+            S9xMarkDirty(Dirty.SRAM, ((Address & 0x7fff) - 0x6000 + ((Address & 0x1f0000) >> 3)) & Memory.SRAMMask);
             CPU.SRAMModified = TRUE;
         }
         return;
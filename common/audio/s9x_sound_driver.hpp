@@ -17,6 +17,20 @@ class S9xSoundDriver
     {
     }
     virtual bool write_samples(int16_t *data, int samples) = 0;
+
+    // Drivers that queue samples in a ring of their own can hand out the
+    // next free stretch of it, up to samples long, so the caller mixes
+    // straight into it and then publishes it with end_write. Others have
+    // nothing to hand out and the caller uses write_samples.
+    virtual int16_t *begin_write(int &samples)
+    {
+        samples = 0;
+        return nullptr;
+    }
+    virtual void end_write(int samples)
+    {
+    }
+
     virtual int space_free() = 0;
     virtual std::pair<int, int> buffer_level() = 0;
     virtual void init() = 0;
@@ -7,19 +7,23 @@
 #include "s9x_sound_driver_cubeb.hpp"
 #include <cstdio>
 
+// As with SDL, the emulator thread only adds to the buffer, so a batch that
+// doesn't fit is dropped instead of discarding what hasn't been played.
 bool S9xCubebSoundDriver::write_samples(int16_t *data, int samples)
 {
-    bool retval = true;
-    auto empty = buffer.space_empty();
-    if (samples > empty)
-    {
-        retval = false;
-        buffer.dump(buffer.buffer_size / 2 - empty);
-    }
+    return buffer.push(data, samples);
+}
 
-    buffer.push(data, samples);
+int16_t *S9xCubebSoundDriver::begin_write(int &samples)
+{
+    auto span = buffer.write_span(samples);
+    samples = span.size;
+    return span.size ? span.data : nullptr;
+}
 
-    return retval;
+void S9xCubebSoundDriver::end_write(int samples)
+{
+    buffer.commit(samples);
 }
 
 S9xCubebSoundDriver::S9xCubebSoundDriver()
@@ -79,18 +83,35 @@ long data_callback(cubeb_stream *stream, void *user_ptr,
 
 long S9xCubebSoundDriver::data_callback(cubeb_stream *stream, void const *input_buffer, void *output_buffer, long nframes)
 {
-    auto avail = buffer.avail();
-    if (avail < nframes * 2)
+    int16_t *out = (int16_t *)output_buffer;
+    int samples = nframes * 2;
+
+    // After running dry, play silence until half the buffer is queued again.
+    if (refilling && buffer.space_filled() < buffer.buffer_size / 2)
+    {
+        memset(out, 0, samples * 2);
+        return nframes;
+    }
+    refilling = false;
+
+    while (samples > 0)
     {
-        auto zeroed_samples = nframes * 2 - avail;
-        memset(output_buffer, 0, zeroed_samples);
-        buffer.read((int16_t *)output_buffer + zeroed_samples, nframes * 2 - zeroed_samples);
-        buffer.add_silence(buffer.buffer_size / 2);
+        auto span = buffer.read_span(samples);
+        if (span.size == 0)
+            break;
+
+        memcpy(out, span.data, span.size * 2);
+        buffer.consume(span.size);
+        out += span.size;
+        samples -= span.size;
     }
-    else
+
+    if (samples > 0)
     {
-        buffer.read((int16_t *)output_buffer, nframes * 2);
+        memset(out, 0, samples * 2);
+        refilling = true;
     }
+
     return nframes;
 }
 
@@ -24,11 +24,14 @@ class S9xCubebSoundDriver : public S9xSoundDriver
     void stop() override;
     long data_callback(cubeb_stream *stream, void const *input_buffer, void *output_buffer, long nframes);
     bool write_samples(int16_t *data, int samples) override;
+    int16_t *begin_write(int &samples) override;
+    void end_write(int samples) override;
     int space_free() override;
     std::pair<int, int> buffer_level() override;
 
   private:
     Resampler buffer;
+    bool refilling = true;
     cubeb *context = nullptr;
     cubeb_stream *stream = nullptr;
 };
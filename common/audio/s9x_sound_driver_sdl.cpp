@@ -7,28 +7,55 @@
 #include "s9x_sound_driver_sdl.hpp"
 #include "SDL_audio.h"
 
+// The emulator thread only ever adds to the buffer and the callback only
+// ever takes from it, so a batch that doesn't fit is dropped here rather
+// than making room by discarding what the callback hasn't played yet.
 bool S9xSDLSoundDriver::write_samples(int16_t *data, int samples)
 {
-    bool retval = true;
-    auto empty = buffer.space_empty();
-    if (samples > empty)
-    {
-        retval = false;
-        buffer.dump(buffer.buffer_size / 2 - empty);
-    }
-    buffer.push(data, samples);
+    return buffer.push(data, samples);
+}
 
-    return retval;
+int16_t *S9xSDLSoundDriver::begin_write(int &samples)
+{
+    auto span = buffer.write_span(samples);
+    samples = span.size;
+    return span.size ? span.data : nullptr;
+}
+
+void S9xSDLSoundDriver::end_write(int samples)
+{
+    buffer.commit(samples);
 }
 
 void S9xSDLSoundDriver::mix(unsigned char *output, int bytes)
 {
-    if (buffer.avail() >= bytes >> 1)
-        buffer.read((int16_t *)output, bytes >> 1);
-    else
+    int16_t *out = (int16_t *)output;
+    int samples = bytes >> 1;
+
+    // After running dry, play silence until half the buffer is queued again.
+    if (refilling && buffer.space_filled() < buffer.buffer_size / 2)
+    {
+        memset(out, 0, bytes);
+        return;
+    }
+    refilling = false;
+
+    while (samples > 0)
+    {
+        auto span = buffer.read_span(samples);
+        if (span.size == 0)
+            break;
+
+        memcpy(out, span.data, span.size * 2);
+        buffer.consume(span.size);
+        out += span.size;
+        samples -= span.size;
+    }
+
+    if (samples > 0)
     {
-        buffer.read((int16_t *)output, buffer.avail());
-        buffer.add_silence(buffer.buffer_size / 2);
+        memset(out, 0, samples * 2);
+        refilling = true;
     }
 }
 
@@ -15,7 +15,6 @@
 #include "s9x_sound_driver.hpp"
 #include "../../apu/resampler.h"
 
-#include <mutex>
 #include <cstdint>
 
 class S9xSDLSoundDriver : public S9xSoundDriver
@@ -29,6 +28,8 @@ class S9xSDLSoundDriver : public S9xSoundDriver
     void start() override;
     void stop() override;
     bool write_samples(int16_t *data, int samples) override;
+    int16_t *begin_write(int &samples) override;
+    void end_write(int samples) override;
     int space_free() override;
     std::pair<int, int> buffer_level() override;
 
@@ -37,8 +38,7 @@ class S9xSDLSoundDriver : public S9xSoundDriver
 
     SDL_AudioSpec audiospec;
     Resampler buffer;
-    std::mutex mutex;
-    int16_t temp[512];
+    bool refilling = true;
 };
 
 #endif /* __S9X_SOUND_DRIVER_SDL_HPP */
@@ -3159,7 +3159,7 @@ void S9xControlEOF (void)
 					if (i == NONE)
 						continue;
 
-					if (++joypad[i - JOYPAD0].turbo_ct >= turbo_time)
+					if (!IPPU.HiddenFrame && ++joypad[i - JOYPAD0].turbo_ct >= turbo_time)
 					{
 						joypad[i - JOYPAD0].turbo_ct = 0;
 						joypad[i - JOYPAD0].buttons ^= joypad[i - JOYPAD0].turbos;
@@ -3176,7 +3176,7 @@ void S9xControlEOF (void)
 			case JOYPAD5:
 			case JOYPAD6:
 			case JOYPAD7:
-				if (++joypad[i - JOYPAD0].turbo_ct >= turbo_time)
+				if (!IPPU.HiddenFrame && ++joypad[i - JOYPAD0].turbo_ct >= turbo_time)
 				{
 					joypad[i - JOYPAD0].turbo_ct = 0;
 					joypad[i - JOYPAD0].buttons ^= joypad[i - JOYPAD0].turbos;
@@ -3251,6 +3251,15 @@ void S9xControlEOF (void)
 		}
 	}
 
+	// Frames that get rolled back (run-ahead, netplay rollback) keep the gun
+	// latches above, which the emulation sees, but must not move turbo,
+	// pointers or multi-key scripts on or poll the devices again.
+	if (IPPU.HiddenFrame)
+	{
+		pad_read = false;
+		return;
+	}
+
 	for (int n = 0; n < 8; n++)
 	{
 		if (!pseudopointer[n].mapped)
@@ -47,6 +47,7 @@ static void S9xSoftResetCPU (void)
 	CPU.MemSpeed = SLOW_ONE_CYCLE;
 	CPU.MemSpeedx2 = SLOW_ONE_CYCLE * 2;
 	CPU.FastROMSpeed = SLOW_ONE_CYCLE;
+	S9xUpdateBlockSpeed();
 	CPU.InDMA = FALSE;
 	CPU.InHDMA = FALSE;
 	CPU.InDMAorHDMA = FALSE;
@@ -101,6 +102,7 @@ void S9xReset (void)
 	memset(Memory.RAM, 0x55, sizeof(Memory.RAM));
 	memset(Memory.VRAM, 0x00, sizeof(Memory.VRAM));
 	memset(Memory.FillRAM, 0, 0x8000);
+	S9xMarkAllDirty();
 
 	S9xResetBSX();
 	S9xResetCPU();
@@ -136,6 +138,7 @@ void S9xSoftReset (void)
 	S9xResetSaveTimer(FALSE);
 
 	memset(Memory.FillRAM, 0, 0x8000);
+	S9xMarkAllDirty();
 
 	if (Settings.BS)
 		S9xResetBSX();
@@ -12,14 +12,252 @@
 #include "fxemu.h"
 #include "snapshot.h"
 #include "movie.h"
+#include "profile.h"
 #ifdef DEBUGGER
 #include "debug.h"
 #include "missing.h"
 #endif
 
 static inline void S9xReschedule (void);
+static void S9xRunFrame (void);
+static void S9xRunAhead (void);
+
+// Set while emulating a frame that is not the one presented.
+static bool8	skipSyncSpeed = FALSE;
+// Time spent waiting in the last S9xSyncSpeed(), left out of RunAheadStats.
+static uint32	syncMicroseconds = 0;
+
+// Straight-line runs of code, decoded once and then dispatched without
+// fetching the opcode or looking it up in the M/X/E table. A block is keyed
+// on where it starts, the opcode table (M, X and E) and CPU.PCBase. It ends
+// at anything that can jump or change M, X or E, and never leaves the 256-byte
+// page it starts in, so one dirty-page stamp (see dirty.h) tells whether it
+// was written since it was decoded. Only those instructions and interrupts
+// move PC elsewhere, so the main loop just drops the block on an interrupt.
+
+#define CPU_BLOCK_CACHE_SIZE	2048
+#define CPU_BLOCK_INSNS			16
+
+struct SCPUBlock
+{
+	struct SOpcodes	*Opcodes;
+	uint8	*PCBase;
+	uint32	*Stamp;
+	uint32	Since;
+	uint32	Address;
+	uint32	Count;
+	void	(*Op[CPU_BLOCK_INSNS]) (void);
+};
+
+static struct SCPUBlock	cpuBlocks[CPU_BLOCK_CACHE_SIZE];
+// Set when code couldn't be cached because its page was written during the
+// current dirty generation, which S9xRunFrame() then ends.
+static bool8			cpuBlockWantsGeneration = FALSE;
+
+static const uint8	cpuBlockEnds[256] =
+{
+	1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,		// 00 BRK, 02 COP
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,		// 10 BPL
+	1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0,		// 20 JSR, 22 JSL, 28 PLP
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,		// 30 BMI
+	1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,		// 40 RTI, 44 MVP, 4C JMP
+	1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,		// 50 BVC, 54 MVN, 5C JML
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0,		// 60 RTS, 6B RTL, 6C JMP (a)
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,		// 70 BVS, 7C JMP (a,X)
+	1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,		// 80 BRA, 82 BRL
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,		// 90 BCC
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,		// B0 BCS
+	0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0,		// C2 REP, CB WAI
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0,		// D0 BNE, DB STP, DC JML [a]
+	0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,		// E2 SEP
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0		// F0 BEQ, FB XCE, FC JSR (a,X)
+};
+
+// Returns the block starting at PBPC, decoding it if needed, or NULL to run
+// the instruction the usual way. retry is cleared if the next few
+// instructions are no more likely to be cacheable.
+static struct SCPUBlock * S9xFindBlock (bool8 &retry)
+{
+	uint32				pbpc = Registers.PBPC;
+	struct SCPUBlock	*b = &cpuBlocks[(pbpc ^ (pbpc >> 11)) & (CPU_BLOCK_CACHE_SIZE - 1)];
+
+	if (b->Address == pbpc && b->Opcodes == ICPU.S9xOpcodes && b->PCBase == CPU.PCBase &&
+		*b->Stamp <= b->Since && Dirty.AllDirty <= b->Since)
+		return (b);
+
+	retry = FALSE;
+
+	// Only ROM and memory whose writes stamp their own pages can be cached.
+	// Coprocessors write SRAM without stamping it, see Dirty.SRAMTracked.
+	int		block = pbpc >> MEMMAP_SHIFT;
+	uint8	*p = CPU.PCBase + Registers.PCw;
+	bool8	ram = p >= Memory.RAM && p < Memory.RAM + sizeof(Memory.RAM);
+
+	if (Settings.BS || (!Memory.BlockIsROM[block] && (Memory.BlockDirty[block] == Dirty.Untracked || (!ram && !Dirty.SRAMTracked))))
+		return (NULL);
+
+	uint32	*stamp = &Memory.BlockDirty[block][Registers.PCw >> DIRTY_PAGE_SHIFT];
+	if (*stamp >= Dirty.Generation || Dirty.AllDirty >= Dirty.Generation)
+	{
+		cpuBlockWantsGeneration = TRUE;
+		return (NULL);
+	}
+
+	uint16	pc = Registers.PCw;
+	uint32	count = 0;
+
+	while (count < CPU_BLOCK_INSNS)
+	{
+		uint8	op = CPU.PCBase[pc];
+		uint8	length = ICPU.S9xOpLengths[op];
+
+		// Left to the main loop's own block-crossing check
+		if ((pc & MEMMAP_MASK) + length >= MEMMAP_BLOCK_SIZE || (pc & (DIRTY_PAGE_SIZE - 1)) + length > DIRTY_PAGE_SIZE)
+			break;
+
+		b->Op[count++] = ICPU.S9xOpcodes[op].S9xOpcode;
+		pc += length;
+
+		if (cpuBlockEnds[op])
+			break;
+	}
+
+	if (!count)
+	{
+		b->Opcodes = NULL;
+		retry = TRUE;
+		return (NULL);
+	}
+
+	b->Opcodes = ICPU.S9xOpcodes;
+	b->Address = pbpc;
+	b->PCBase = CPU.PCBase;
+	b->Stamp = stamp;
+	b->Since = Dirty.Generation - 1;
+	b->Count = count;
+	retry = TRUE;
+
+	return (b);
+}
+
+static inline uint32 S9xMicrosecondsSince (std::chrono::steady_clock::time_point start)
+{
+	return ((uint32) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
 
 void S9xMainLoop (void)
+{
+	S9xProfileScope	profile(PROFILE_MAINLOOP);
+
+	// Movies and netplay need every frame's input to land on that frame.
+	if (Settings.RunAhead && !Settings.NetPlay && !S9xMovieActive()
+	#ifdef DEBUGGER
+		&& !(CPU.Flags & (DEBUG_MODE_FLAG | TRACE_FLAG | SINGLE_STEP_FLAG | FRAME_ADVANCE_FLAG | BREAK_FLAG))
+	#endif
+		)
+		S9xRunAhead();
+	else
+	{
+		RunAheadStats.Frames = 0;
+		S9xRunFrame();
+	}
+}
+
+// Run-ahead hides the lag games build into their input handling. The frame is
+// emulated for real but not shown, and saved. Then Settings.RunAhead more
+// frames are emulated with the same input and without sound, the last one is
+// shown, and the saved state is put back. Saving and restoring only touch the
+// pages written since the previous save, so most of the cost is the extra
+// frames themselves.
+
+static std::vector<uint8>					runAheadState;
+static std::vector<struct SHotStateRange>	runAheadRanges;
+static uint32								runAheadSince = 0;
+
+static void S9xRunAhead (void)
+{
+	std::chrono::steady_clock::time_point	start = std::chrono::steady_clock::now(), t;
+
+	bool8	render = IPPU.RenderThisFrame;
+	uint32	size = S9xHotFreezeSize();
+	int		frames = Settings.RunAhead;
+
+	// Frontends may set Settings.RunAhead directly, so keep the bound here too.
+	if (frames > MAX_RUNAHEAD_FRAMES)
+		frames = MAX_RUNAHEAD_FRAMES;
+
+	IPPU.RenderThisFrame = FALSE;
+	skipSyncSpeed = TRUE;
+	S9xRunFrame();
+	RunAheadStats.FrameMicroseconds = S9xMicrosecondsSince(start);
+
+	{
+		S9xProfileScope	profile(PROFILE_RUNAHEAD_SAVE);
+
+		t = std::chrono::steady_clock::now();
+
+		if (runAheadState.size() != size)
+		{
+			runAheadState.resize(size);
+			runAheadSince = 0;
+		}
+
+		uint32	checkpoint = S9xDirtyCheckpoint();
+		S9xHotFreezeGameDirty(runAheadState.data(), size, runAheadSince, runAheadRanges);
+		runAheadSince = checkpoint;
+		RunAheadStats.SaveMicroseconds = S9xMicrosecondsSince(t);
+	}
+
+	IPPU.HiddenFrame = TRUE;
+	S9xAPUSuppressOutput(TRUE);
+
+	for (int i = 1; i < frames; i++)
+		S9xRunFrame();
+
+	IPPU.RenderThisFrame = render;
+	skipSyncSpeed = FALSE;
+	syncMicroseconds = 0;
+	S9xRunFrame();
+
+	{
+		S9xProfileScope	profile(PROFILE_RUNAHEAD_LOAD);
+
+		t = std::chrono::steady_clock::now();
+		S9xHotUnfreezeGameDirty(runAheadState.data(), size, runAheadSince);
+		RunAheadStats.LoadMicroseconds = S9xMicrosecondsSince(t);
+	}
+
+	S9xAPUSuppressOutput(FALSE);
+	IPPU.HiddenFrame = FALSE;
+
+	RunAheadStats.Frames = frames;
+	RunAheadStats.TotalMicroseconds = S9xMicrosecondsSince(start) - syncMicroseconds;
+}
+
+// Netplay rollback re-emulates frames that were already shown: no picture,
+// no sound and no frame pacing.
+
+void S9xMainLoopHidden (void)
+{
+	S9xProfileScope	profile(PROFILE_MAINLOOP);
+
+	bool8	render = IPPU.RenderThisFrame;
+
+	IPPU.RenderThisFrame = FALSE;
+	IPPU.HiddenFrame = TRUE;
+	skipSyncSpeed = TRUE;
+	S9xAPUSuppressOutput(TRUE);
+
+	S9xRunFrame();
+
+	S9xAPUSuppressOutput(FALSE);
+	skipSyncSpeed = FALSE;
+	IPPU.HiddenFrame = FALSE;
+	IPPU.RenderThisFrame = render;
+}
+
+static void S9xRunFrame (void)
 {
 	#define CHECK_FOR_IRQ_CHANGE() \
 	if (Timings.IRQFlagChanging) \
@@ -42,6 +280,16 @@ void S9xMainLoop (void)
 		S9xMovieUpdate();
 	}
 
+	if (cpuBlockWantsGeneration)
+	{
+		cpuBlockWantsGeneration = FALSE;
+		Dirty.Generation++;
+	}
+
+	struct SCPUBlock	*block = NULL;
+	uint32				insn = 0;
+	bool8				lookup = TRUE;
+
 	for (;;)
 	{
 		if (CPU.NMIPending)
@@ -65,6 +313,8 @@ void S9xMainLoop (void)
 
 				CHECK_FOR_IRQ_CHANGE();
 				S9xOpcode_NMI();
+				block = NULL;
+				lookup = TRUE;
 			}
 		}
 
@@ -94,6 +344,8 @@ void S9xMainLoop (void)
 				/* The flag pushed onto the stack is the new value */
 				CHECK_FOR_IRQ_CHANGE();
 				S9xOpcode_IRQ();
+				block = NULL;
+				lookup = TRUE;
 			}
 		}
 
@@ -135,6 +387,36 @@ void S9xMainLoop (void)
 			break;
 		}
 
+		// Leave the block if it was written to.
+		if (block && *block->Stamp > block->Since)
+		{
+			block = NULL;
+			lookup = TRUE;
+		}
+
+		if (!block && lookup && CPU.PCBase)
+		{
+			block = S9xFindBlock(lookup);
+			insn = 0;
+		}
+
+		if (block)
+		{
+			void	(*op) (void) = block->Op[insn];
+
+			if (++insn == block->Count)
+				block = NULL;
+
+			CPU.Cycles += CPU.MemSpeed;
+			Registers.PCw++;
+			(*op)();
+
+			if (Settings.SA1)
+				S9xSA1MainLoop();
+
+			continue;
+		}
+
 		uint8				Op;
 		struct	SOpcodes	*Opcodes;
 
@@ -163,10 +445,17 @@ void S9xMainLoop (void)
 		Registers.PCw++;
 		(*Opcodes[Op].S9xOpcode)();
 
+		if (cpuBlockEnds[Op])
+			lookup = TRUE;
+
 		if (Settings.SA1)
 			S9xSA1MainLoop();
 	}
 
+	// Ports may save state, or take sound, or touch the screen between frames.
+	S9xAPUCatchUp();
+	S9xWaitForRenderer();
+
 	S9xPackStatus();
 }
 
@@ -185,8 +474,17 @@ static inline void S9xReschedule (void)
 			break;
 
 		case HC_HCOUNTER_MAX_EVENT:
-			CPU.WhichEvent = HC_HDMA_INIT_EVENT;
-			CPU.NextEvent  = Timings.HDMAInit;
+			// HDMA is only initialized on the first line, so don't stop for it elsewhere.
+			if (CPU.V_Counter == 0)
+			{
+				CPU.WhichEvent = HC_HDMA_INIT_EVENT;
+				CPU.NextEvent  = Timings.HDMAInit;
+			}
+			else
+			{
+				CPU.WhichEvent = HC_RENDER_EVENT;
+				CPU.NextEvent  = Timings.RenderPos;
+			}
 			break;
 
 		case HC_HDMA_INIT_EVENT:
@@ -200,8 +498,9 @@ static inline void S9xReschedule (void)
 			break;
 
 		case HC_WRAM_REFRESH_EVENT:
-			CPU.WhichEvent = HC_HBLANK_START_EVENT;
-			CPU.NextEvent  = Timings.HBlankStart;
+			// HBlank start has nothing to do, it only remains for older snapshots.
+			CPU.WhichEvent = HC_HDMA_START_EVENT;
+			CPU.NextEvent  = Timings.HDMAStart;
 			break;
 	}
 }
@@ -323,7 +622,12 @@ void S9xDoHEventProcessing (void)
 					if (!(CPU.Flags & FRAME_ADVANCE_FLAG))
 				#endif
 				{
-					S9xSyncSpeed();
+					if (!skipSyncSpeed)
+					{
+						std::chrono::steady_clock::time_point	t = std::chrono::steady_clock::now();
+						S9xSyncSpeed();
+						syncMicroseconds = S9xMicrosecondsSince(t);
+					}
 				}
 
 				CPU.Flags |= SCAN_KEYS_FLAG;
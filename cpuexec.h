@@ -45,6 +45,7 @@ extern uint8			S9xOpLengthsM0X1[256];
 extern uint8			S9xOpLengthsM0X0[256];
 
 void S9xMainLoop (void);
+void S9xMainLoopHidden (void);
 void S9xReset (void);
 void S9xSoftReset (void);
 void S9xDoHEventProcessing (void);
@@ -0,0 +1,56 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+#ifndef _DIRTY_H_
+#define _DIRTY_H_
+
+// Write generations for the big memories that make up most of a savestate.
+// Every write stamps its page with the current generation. Something that
+// keeps states around (rewind, run-ahead) takes a checkpoint whenever it saves
+// one, and next time only has to look at the pages stamped after it.
+// S9xMarkAllDirty() is for anything that rewrites memory wholesale, like
+// resets and loading a state.
+
+#define DIRTY_PAGE_SHIFT	8
+#define DIRTY_PAGE_SIZE		(1 << DIRTY_PAGE_SHIFT)
+
+struct SDirtyPages
+{
+	uint32	Generation;
+	uint32	AllDirty;
+	bool8	SRAMTracked;
+	uint32	RAM[0x20000 >> DIRTY_PAGE_SHIFT];
+	uint32	SRAM[0x80000 >> DIRTY_PAGE_SHIFT];
+	uint32	VRAM[0x10000 >> DIRTY_PAGE_SHIFT];
+	uint32	APURAM[0x10000 >> DIRTY_PAGE_SHIFT];
+	uint32	Untracked[0x10000 >> DIRTY_PAGE_SHIFT];	// direct writes to anything else
+};
+
+extern struct SDirtyPages	Dirty;
+
+static inline void S9xMarkDirty (uint32 *pages, uint32 offset)
+{
+	pages[offset >> DIRTY_PAGE_SHIFT] = Dirty.Generation;
+}
+
+static inline void S9xMarkAllDirty (void)
+{
+	Dirty.AllDirty = Dirty.Generation;
+}
+
+static inline bool8 S9xIsDirty (const uint32 *pages, uint32 page, uint32 since)
+{
+	return (pages[page] > since || Dirty.AllDirty > since);
+}
+
+// Returns the generation to pass to S9xIsDirty() later. A checkpoint of 0
+// means "never", for which every page is dirty.
+static inline uint32 S9xDirtyCheckpoint (void)
+{
+	return (Dirty.Generation++);
+}
+
+#endif
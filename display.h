@@ -13,6 +13,7 @@ void S9xUsage (void);
 char * S9xParseArgs (char **, int);
 void S9xParseArgsForCheats (char **, int);
 void S9xLoadConfigFiles (char **, int);
+uint8 S9xClampRunAhead (int);
 void S9xSetInfoString (const char *);
 
 // Routines the port has to implement even if it doesn't use them
@@ -113,6 +113,8 @@ bool8 S9xDoDMA (uint8 Channel)
 		case 0x19:
 			if (IPPU.RenderThisFrame)
 				FLUSH_REDRAW();
+			// The renderer thread reads VRAM in place.
+			S9xWaitForRenderer();
 			break;
 	}
 
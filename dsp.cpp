@@ -6,6 +6,7 @@
 
 #include "snes9x.h"
 #include "memmap.h"
+#include "profile.h"
 #ifdef DEBUGGER
 #include "missing.h"
 #endif
@@ -32,6 +33,8 @@ void S9xResetDSP (void)
 
 uint8 S9xGetDSP (uint16 address)
 {
+	S9xProfileScope	profile(PROFILE_DSP);
+
 #ifdef DEBUGGER
 	if (Settings.TraceDSP)
 	{
@@ -45,6 +48,8 @@ uint8 S9xGetDSP (uint16 address)
 
 void S9xSetDSP (uint8 byte, uint16 address)
 {
+	S9xProfileScope	profile(PROFILE_DSP);
+
 #ifdef DEBUGGER
 	missing.unknowndsp_write = address;
 	if (Settings.TraceDSP)
@@ -54,11 +54,20 @@ static inline int32 memory_speed (uint32 address)
 	return (TWO_CYCLES);
 }
 
+// Blocks are uniform in speed except for $4000-$4fff, where $4000-$41ff is
+// slower. That block is always the CPU registers, so those accesses fall back
+// to memory_speed() and the table keeps the speed of the rest of the block.
+static inline void S9xUpdateBlockSpeed (void)
+{
+	for (int c = 0; c < MEMMAP_NUM_BLOCKS; c++)
+		Memory.BlockSpeed[c] = (uint8) memory_speed((c << MEMMAP_SHIFT) | MEMMAP_MASK);
+}
+
 inline uint8 S9xGetByte (uint32 Address)
 {
 	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
 	uint8	*GetAddress = Memory.Map[block];
-	int32	speed = memory_speed(Address);
+	int32	speed = Memory.BlockSpeed[block];
 	uint8	byte;
 
 	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
@@ -71,6 +80,7 @@ inline uint8 S9xGetByte (uint32 Address)
 	switch ((pint) GetAddress)
 	{
 		case CMemory::MAP_CPU:
+			speed = memory_speed(Address);
 			byte = S9xGetCPU(Address & 0xffff);
 			addCyclesInMemoryAccess;
 			return (byte);
@@ -188,7 +198,7 @@ inline uint16 S9xGetWord (uint32 Address, enum s9xwrap_t w = WRAP_NONE)
 
 	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
 	uint8	*GetAddress = Memory.Map[block];
-	int32	speed = memory_speed(Address);
+	int32	speed = Memory.BlockSpeed[block];
 
 	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
 	{
@@ -200,6 +210,7 @@ inline uint16 S9xGetWord (uint32 Address, enum s9xwrap_t w = WRAP_NONE)
 	switch ((pint) GetAddress)
 	{
 		case CMemory::MAP_CPU:
+			speed = memory_speed(Address);
 			word  = S9xGetCPU(Address & 0xffff);
 			addCyclesInMemoryAccess;
 			word |= S9xGetCPU((Address + 1) & 0xffff) << 8;
@@ -321,11 +332,12 @@ inline void S9xSetByte (uint8 Byte, uint32 Address)
 {
 	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
 	uint8	*SetAddress = Memory.WriteMap[block];
-	int32	speed = memory_speed(Address);
+	int32	speed = Memory.BlockSpeed[block];
 
 	if (SetAddress >= (uint8 *) CMemory::MAP_LAST)
 	{
 		*(SetAddress + (Address & 0xffff)) = Byte;
+		Memory.BlockDirty[block][(Address & 0xffff) >> DIRTY_PAGE_SHIFT] = Dirty.Generation;
 		addCyclesInMemoryAccess;
 		return;
 	}
@@ -333,6 +345,7 @@ inline void S9xSetByte (uint8 Byte, uint32 Address)
 	switch ((pint) SetAddress)
 	{
 		case CMemory::MAP_CPU:
+			speed = memory_speed(Address);
 			S9xSetCPU(Byte, Address & 0xffff);
 			addCyclesInMemoryAccess;
 			return;
@@ -349,6 +362,7 @@ inline void S9xSetByte (uint8 Byte, uint32 Address)
 			if (Memory.SRAMMask)
 			{
 				*(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask)) = Byte;
+				S9xMarkDirty(Dirty.SRAM, (((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask);
 				CPU.SRAMModified = TRUE;
 			}
 
@@ -359,6 +373,7 @@ inline void S9xSetByte (uint8 Byte, uint32 Address)
 			if (Multi.sramMaskB)
 			{
 				*(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB)) = Byte;
+				S9xMarkDirty(Dirty.SRAM, 0x10000 + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB));
 				CPU.SRAMModified = TRUE;
 			}
 
@@ -369,6 +384,7 @@ inline void S9xSetByte (uint8 Byte, uint32 Address)
 			if (Memory.SRAMMask)
 			{
 				*(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0x1f0000) >> 3)) & Memory.SRAMMask)) = Byte;
+				S9xMarkDirty(Dirty.SRAM, ((Address & 0x7fff) - 0x6000 + ((Address & 0x1f0000) >> 3)) & Memory.SRAMMask);
 				CPU.SRAMModified = TRUE;
 			}
 
@@ -461,11 +477,13 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 
 	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
 	uint8	*SetAddress = Memory.WriteMap[block];
-	int32	speed = memory_speed(Address);
+	int32	speed = Memory.BlockSpeed[block];
 
 	if (SetAddress >= (uint8 *) CMemory::MAP_LAST)
 	{
 		WRITE_WORD(SetAddress + (Address & 0xffff), Word);
+		Memory.BlockDirty[block][(Address & 0xffff) >> DIRTY_PAGE_SHIFT] = Dirty.Generation;
+		Memory.BlockDirty[block][((Address + 1) & 0xffff) >> DIRTY_PAGE_SHIFT] = Dirty.Generation;
 		addCyclesInMemoryAccess_x2;
 		return;
 	}
@@ -473,6 +491,7 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 	switch ((pint) SetAddress)
 	{
 		case CMemory::MAP_CPU:
+			speed = memory_speed(Address);
 			if (o)
 			{
 				S9xSetCPU(Word >> 8, (Address + 1) & 0xffff);
@@ -528,6 +547,8 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 					*(Memory.SRAM + (((((Address + 1) & 0xff0000) >> 1) | ((Address + 1) & 0x7fff)) & Memory.SRAMMask)) = Word >> 8;
 				}
 
+				S9xMarkDirty(Dirty.SRAM, (((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask);
+				S9xMarkDirty(Dirty.SRAM, ((((Address + 1) & 0xff0000) >> 1) | ((Address + 1) & 0x7fff)) & Memory.SRAMMask);
 				CPU.SRAMModified = TRUE;
 			}
 
@@ -545,6 +566,8 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 					*(Multi.sramB + (((((Address + 1) & 0xff0000) >> 1) | ((Address + 1) & 0x7fff)) & Multi.sramMaskB)) = Word >> 8;
 				}
 
+				S9xMarkDirty(Dirty.SRAM, 0x10000 + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB));
+				S9xMarkDirty(Dirty.SRAM, 0x10000 + (((((Address + 1) & 0xff0000) >> 1) | ((Address + 1) & 0x7fff)) & Multi.sramMaskB));
 				CPU.SRAMModified = TRUE;
 			}
 
@@ -562,6 +585,8 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 					*(Memory.SRAM + ((((Address + 1) & 0x7fff) - 0x6000 + (((Address + 1) & 0x1f0000) >> 3)) & Memory.SRAMMask)) = Word >> 8;
 				}
 
+				S9xMarkDirty(Dirty.SRAM, ((Address & 0x7fff) - 0x6000 + ((Address & 0x1f0000) >> 3)) & Memory.SRAMMask);
+				S9xMarkDirty(Dirty.SRAM, (((Address + 1) & 0x7fff) - 0x6000 + (((Address + 1) & 0x1f0000) >> 3)) & Memory.SRAMMask);
 				CPU.SRAMModified = TRUE;
 			}
 
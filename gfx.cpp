@@ -12,7 +12,14 @@
 #include "cheats.h"
 #include "movie.h"
 #include "screenshot.h"
+#include "snapshot.h"
 #include "display.h"
+#include "profile.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 extern struct SCheatData		Cheat;
 extern struct SLineData			LineData[240];
@@ -36,11 +43,165 @@ static void DrawBackgroundOffsetMosaic (int, uint8, uint8, int);
 static inline void DrawBackgroundMode7 (int, void (*DrawMath) (uint32, uint32, int), void (*DrawNomath) (uint32, uint32, int), int);
 static inline void DrawBackdrop (void);
 static inline void RenderScreen (bool8);
+struct SRenderChunk;
+static void PrepareScreenUpdate (struct SRenderChunk &);
+static void DrawScreenUpdate (const struct SRenderChunk &);
 static uint16 get_crosshair_color (uint8);
 static void S9xDisplayStringType (const char *, int, int, bool, int);
 
 #define TILE_PLUS(t, x)	(((t) & 0xfc00) | ((t + x) & 0x3ff))
 
+// Threaded renderer: ranges of scanlines are queued together with a copy of
+// the PPU state they were displayed with, and a worker thread draws them in
+// order while the CPU carries on with the frame. Register writes, HDMA
+// included, only flush a range into the queue. The CPU still waits for the
+// worker before it changes what the drawing code reads in place: VRAM, OAM
+// and the OBJ tables, the direct colour maps, the screen layout, and the
+// finished frame.
+
+#define THREADED_RENDER_LINES	16
+#define RENDER_QUEUE_SIZE		32
+
+struct SRenderChunk
+{
+	uint32				StartY;
+	uint32				EndY;
+	uint32				FixedColour;
+	struct SRenderPPU	PPU;
+	struct ClipData		Clip[2][6];
+	uint16				ScreenColors[256];
+};
+
+static struct
+{
+	std::thread				thread;
+	std::mutex				mutex;
+	std::condition_variable	cond;
+	bool8					running;
+	bool8					quit;
+	uint32					head;		// next chunk to draw
+	uint32					tail;		// next chunk to fill
+	std::atomic<uint32>		pending;	// chunks queued or being drawn
+	struct SRenderChunk		queue[RENDER_QUEUE_SIZE];
+} Renderer;
+
+static void RendererThreadEntry (void)
+{
+	std::unique_lock<std::mutex>	lock(Renderer.mutex);
+
+	for (;;)
+	{
+		while (Renderer.head == Renderer.tail && !Renderer.quit)
+			Renderer.cond.wait(lock);
+
+		if (Renderer.quit)
+			break;
+
+		struct SRenderChunk	&chunk = Renderer.queue[Renderer.head % RENDER_QUEUE_SIZE];
+
+		lock.unlock();
+		DrawScreenUpdate(chunk);
+		lock.lock();
+
+		Renderer.head++;
+		Renderer.pending--;
+		Renderer.cond.notify_all();
+	}
+}
+
+static bool8 StartRenderer (void)
+{
+	if (Renderer.running)
+		return (TRUE);
+
+	// On a single core the worker would only add a wakeup to every chunk.
+	if (std::thread::hardware_concurrency() < 2)
+	{
+		Settings.ThreadedRenderer = FALSE;
+		return (FALSE);
+	}
+
+	Renderer.quit = FALSE;
+	Renderer.head = Renderer.tail = 0;
+	Renderer.pending = 0;
+	Renderer.thread = std::thread(RendererThreadEntry);
+	Renderer.running = TRUE;
+
+	return (TRUE);
+}
+
+static void StopRenderer (void)
+{
+	if (!Renderer.running)
+		return;
+
+	{
+		std::lock_guard<std::mutex>	lock(Renderer.mutex);
+		Renderer.quit = TRUE;
+		Renderer.cond.notify_all();
+	}
+
+	Renderer.thread.join();
+	Renderer.running = FALSE;
+}
+
+void S9xWaitForRenderer (void)
+{
+	if (!Renderer.pending)
+		return;
+
+	std::unique_lock<std::mutex>	lock(Renderer.mutex);
+	while (Renderer.pending)
+		Renderer.cond.wait(lock);
+}
+
+// Queues the lines not drawn yet, with the PPU state to draw them with, for
+// the renderer thread. Waits only if the queue is full.
+static void QueueScreenUpdate (uint32 &EndY)
+{
+	struct SRenderChunk	*chunk;
+
+	{
+		std::unique_lock<std::mutex>	lock(Renderer.mutex);
+		while (Renderer.tail - Renderer.head >= RENDER_QUEUE_SIZE)
+			Renderer.cond.wait(lock);
+
+		chunk = &Renderer.queue[Renderer.tail % RENDER_QUEUE_SIZE];
+	}
+
+	PrepareScreenUpdate(*chunk);
+	EndY = chunk->EndY;
+
+	if (chunk->StartY > chunk->EndY)
+		return;
+
+	// The live clip windows and palette change under the worker; give it its own.
+	memcpy(chunk->Clip, IPPU.Clip, sizeof(chunk->Clip));
+	memcpy(chunk->ScreenColors, IPPU.ScreenColors, sizeof(chunk->ScreenColors));
+	chunk->PPU.Clip[0] = chunk->Clip[0];
+	chunk->PPU.Clip[1] = chunk->Clip[1];
+	chunk->PPU.ScreenColors = chunk->ScreenColors;
+
+	std::lock_guard<std::mutex>	lock(Renderer.mutex);
+	Renderer.tail++;
+	Renderer.pending++;
+	Renderer.cond.notify_all();
+}
+
+static void S9xUpdateScreenAsync (void)
+{
+	uint32	EndY;
+
+	if (!StartRenderer())
+		return;
+
+	if (IPPU.OBJChanged || IPPU.InterlaceOBJ)
+		SetupOBJ();
+
+	QueueScreenUpdate(EndY);
+	IPPU.DrawnLine = IPPU.CurrentLine;
+}
+
 
 bool8 S9xGraphicsInit (void)
 {
@@ -103,6 +264,8 @@ bool8 S9xGraphicsInit (void)
 
 void S9xGraphicsDeinit (void)
 {
+	StopRenderer();
+
 	if (GFX.ZERO)       { free(GFX.ZERO);       GFX.ZERO       = NULL; }
 	if (GFX.SubScreen)  { free(GFX.SubScreen);  GFX.SubScreen  = NULL; }
 	if (GFX.ZBuffer)    { free(GFX.ZBuffer);    GFX.ZBuffer    = NULL; }
@@ -154,9 +317,13 @@ void S9xBuildDirectColourMaps (void)
 
 void S9xStartScreenRefresh (void)
 {
+	S9xWaitForRenderer();
+
 	if (GFX.DoInterlace)
 		GFX.DoInterlace--;
 
+	IPPU.PreviousLine = IPPU.DrawnLine = IPPU.CurrentLine = 0;
+
 	if (IPPU.RenderThisFrame)
 	{
 		if (!GFX.DoInterlace || !S9xInterlaceField())
@@ -172,14 +339,24 @@ void S9xStartScreenRefresh (void)
 			IPPU.RenderedFramesCount++;
 		}
 
+		if (IPPU.BrightnessChanged)
+		{
+			S9xFixColourBrightness();
+			S9xBuildDirectColourMaps();
+			IPPU.BrightnessChanged = FALSE;
+		}
+
 		PPU.MosaicStart = 0;
 		PPU.RecomputeClipWindows = TRUE;
-		IPPU.PreviousLine = IPPU.CurrentLine = 0;
 
 		memset(GFX.ZBuffer, 0, GFX.ScreenSize);
 		memset(GFX.SubZBuffer, 0, GFX.ScreenSize);
 	}
 
+	// Hidden frames (run-ahead, netplay rollback) are not counted as shown.
+	if (IPPU.HiddenFrame)
+		return;
+
 	if (++IPPU.FrameCount == (uint32)Memory.ROMFramesPerSecond)
 	{
 		IPPU.DisplayedRenderedFrameCount = IPPU.RenderedFramesCount;
@@ -195,9 +372,11 @@ void S9xStartScreenRefresh (void)
 
 void S9xEndScreenRefresh (void)
 {
+	FLUSH_REDRAW();
+
 	if (IPPU.RenderThisFrame)
 	{
-		FLUSH_REDRAW();
+		S9xWaitForRenderer();
 
 		if (GFX.DoInterlace && S9xInterlaceField() == 0)
 		{
@@ -246,7 +425,8 @@ void S9xEndScreenRefresh (void)
 	}
 #endif
 
-	if (CPU.SRAMModified)
+	// Hidden frames leave the SRAM autosave to the next frame shown.
+	if (CPU.SRAMModified && !IPPU.HiddenFrame)
 	{
 		if (!CPU.AutoSaveTimer)
 		{
@@ -262,10 +442,14 @@ void S9xEndScreenRefresh (void)
 			}
 		}
 	}
+
+	S9xReportFileWrites();
 }
 
 void RenderLine (uint8 C)
 {
+	S9xProfileScope	profile(PROFILE_RENDERLINE);
+
 	if (IPPU.RenderThisFrame)
 	{
 		LineData[C].BG[0].VOffset = PPU.BG[0].VOffset + 1;
@@ -294,14 +478,17 @@ void RenderLine (uint8 C)
 		}
 
 		IPPU.CurrentLine = C + 1;
+
+		// Mosaic blocks are aligned to GFX.StartY, so they can't be split into extra chunks.
+		if (Settings.ThreadedRenderer && IPPU.CurrentLine - IPPU.DrawnLine >= THREADED_RENDER_LINES && !CPU.InDMAorHDMA && PPU.Mosaic <= 1)
+			S9xUpdateScreenAsync();
 	}
 	else
 	{
-		// if we're not rendering this frame, we still need to update this
-		// XXX: Check ForceBlank? Or anything else?
-		if (IPPU.OBJChanged)
-			SetupOBJ();
-		PPU.RangeTimeOver |= GFX.OBJLines[C].RTOFlags;
+		// Nothing is drawn on a skipped frame. Just note how far it has got,
+		// S9xUpdateScreen() catches up on the OBJ range/time-over flags when
+		// a register write or a $213E read flushes.
+		IPPU.CurrentLine = C + 1;
 	}
 }
 
@@ -316,62 +503,62 @@ static inline void RenderScreen (bool8 sub)
 		if (GFX.DoInterlace && S9xInterlaceField())
 			GFX.S += GFX.RealPPL;
 		GFX.DB = GFX.ZBuffer;
-		GFX.Clip = IPPU.Clip[0];
-		BGActive = Memory.FillRAM[0x212c] & ~Settings.BG_Forced;
+		GFX.Clip = RPPU.Clip[0];
+		BGActive = RPPU.Regs[0x2c] & ~Settings.BG_Forced;
 		D = 32;
 	}
 	else
 	{
 		GFX.S = GFX.SubScreen;
 		GFX.DB = GFX.SubZBuffer;
-		GFX.Clip = IPPU.Clip[1];
-		BGActive = Memory.FillRAM[0x212d] & ~Settings.BG_Forced;
-		D = (Memory.FillRAM[0x2130] & 2) << 4; // 'do math' depth flag
+		GFX.Clip = RPPU.Clip[1];
+		BGActive = RPPU.Regs[0x2d] & ~Settings.BG_Forced;
+		D = (RPPU.Regs[0x30] & 2) << 4; // 'do math' depth flag
 	}
 
 	if (BGActive & 0x10)
 	{
-		BG.TileAddress = PPU.OBJNameBase;
-		BG.NameSelect = PPU.OBJNameSelect;
-		BG.EnableMath = !sub && (Memory.FillRAM[0x2131] & 0x10);
+		BG.TileAddress = RPPU.OBJNameBase;
+		BG.NameSelect = RPPU.OBJNameSelect;
+		BG.EnableMath = !sub && (RPPU.Regs[0x31] & 0x10);
 		BG.StartPalette = 128;
 		S9xSelectTileConverter(4, FALSE, sub, FALSE);
-		S9xSelectTileRenderers(PPU.BGMode, sub, TRUE);
+		S9xSelectTileRenderers(RPPU.BGMode, sub, TRUE);
 		DrawOBJS(D + 4);
 	}
 
 	BG.NameSelect = 0;
-	S9xSelectTileRenderers(PPU.BGMode, sub, FALSE);
+	S9xSelectTileRenderers(RPPU.BGMode, sub, FALSE);
 
 	#define DO_BG(n, pal, depth, hires, offset, Zh, Zl, voffoff) \
 		if (BGActive & (1 << n)) \
 		{ \
 			BG.StartPalette = pal; \
-			BG.EnableMath = !sub && (Memory.FillRAM[0x2131] & (1 << n)); \
-			BG.TileSizeH = (!hires && PPU.BG[n].BGSize) ? 16 : 8; \
-			BG.TileSizeV = (PPU.BG[n].BGSize) ? 16 : 8; \
-			S9xSelectTileConverter(depth, hires, sub, PPU.BGMosaic[n]); \
+			BG.EnableMath = !sub && (RPPU.Regs[0x31] & (1 << n)); \
+			BG.TileSizeH = (!hires && RPPU.BG[n].BGSize) ? 16 : 8; \
+			BG.TileSizeV = (RPPU.BG[n].BGSize) ? 16 : 8; \
+			S9xSelectTileConverter(depth, hires, sub, RPPU.BGMosaic[n]); \
 			\
 			if (offset) \
 			{ \
-				BG.OffsetSizeH = (!hires && PPU.BG[2].BGSize) ? 16 : 8; \
-				BG.OffsetSizeV = (PPU.BG[2].BGSize) ? 16 : 8; \
+				BG.OffsetSizeH = (!hires && RPPU.BG[2].BGSize) ? 16 : 8; \
+				BG.OffsetSizeV = (RPPU.BG[2].BGSize) ? 16 : 8; \
 				\
-				if (PPU.BGMosaic[n] && (hires || PPU.Mosaic > 1)) \
+				if (RPPU.BGMosaic[n] && (hires || RPPU.Mosaic > 1)) \
 					DrawBackgroundOffsetMosaic(n, D + Zh, D + Zl, voffoff); \
 				else \
 					DrawBackgroundOffset(n, D + Zh, D + Zl, voffoff); \
 			} \
 			else \
 			{ \
-				if (PPU.BGMosaic[n] && (hires || PPU.Mosaic > 1)) \
+				if (RPPU.BGMosaic[n] && (hires || RPPU.Mosaic > 1)) \
 					DrawBackgroundMosaic(n, D + Zh, D + Zl); \
 				else \
 					DrawBackground(n, D + Zh, D + Zl); \
 			} \
 		}
 
-	switch (PPU.BGMode)
+	switch (RPPU.BGMode)
 	{
 		case 0:
 			DO_BG(0,  0, 2, FALSE, FALSE, 15, 11, 0);
@@ -383,7 +570,7 @@ static inline void RenderScreen (bool8 sub)
 		case 1:
 			DO_BG(0,  0, 4, FALSE, FALSE, 15, 11, 0);
 			DO_BG(1,  0, 4, FALSE, FALSE, 14, 10, 0);
-			DO_BG(2,  0, 2, FALSE, FALSE, (PPU.BG3Priority ? 17 : 7), 3, 0);
+			DO_BG(2,  0, 2, FALSE, FALSE, (RPPU.BG3Priority ? 17 : 7), 3, 0);
 			break;
 
 		case 2:
@@ -413,13 +600,13 @@ static inline void RenderScreen (bool8 sub)
 		case 7:
 			if (BGActive & 0x01)
 			{
-				BG.EnableMath = !sub && (Memory.FillRAM[0x2131] & 1);
+				BG.EnableMath = !sub && (RPPU.Regs[0x31] & 1);
 				DrawBackgroundMode7(0, GFX.DrawMode7BG1Math, GFX.DrawMode7BG1Nomath, D);
 			}
 
-			if ((Memory.FillRAM[0x2133] & 0x40) && (BGActive & 0x02))
+			if ((RPPU.Regs[0x33] & 0x40) && (BGActive & 0x02))
 			{
-				BG.EnableMath = !sub && (Memory.FillRAM[0x2131] & 2);
+				BG.EnableMath = !sub && (RPPU.Regs[0x31] & 2);
 				DrawBackgroundMode7(1, GFX.DrawMode7BG2Math, GFX.DrawMode7BG2Nomath, D);
 			}
 
@@ -428,22 +615,68 @@ static inline void RenderScreen (bool8 sub)
 
 	#undef DO_BG
 
-	BG.EnableMath = !sub && (Memory.FillRAM[0x2131] & 0x20);
+	BG.EnableMath = !sub && (RPPU.Regs[0x31] & 0x20);
 
 	DrawBackdrop();
 }
 
 void S9xUpdateScreen (void)
 {
+	S9xProfileScope	profile(PROFILE_UPDATESCREEN);
+	static uint32	SyncEndY = 0;
+
+	if (!IPPU.RenderThisFrame)
+	{
+		// Skipped frame: only the flags $213E reports are kept up to date.
+		// RTOFlags accumulate down the screen, so the last line reached
+		// covers all the lines before it, and once both flags are set there
+		// is nothing more to find out this frame.
+		if ((PPU.RangeTimeOver & 0xc0) != 0xc0)
+		{
+			if (IPPU.OBJChanged || IPPU.InterlaceOBJ)
+				SetupOBJ();
+			PPU.RangeTimeOver |= GFX.OBJLines[IPPU.CurrentLine - 1].RTOFlags;
+		}
+
+		IPPU.PreviousLine = IPPU.CurrentLine;
+		return;
+	}
+
 	if (IPPU.OBJChanged || IPPU.InterlaceOBJ)
 		SetupOBJ();
 
 	// XXX: Check ForceBlank? Or anything else?
-	PPU.RangeTimeOver |= GFX.OBJLines[GFX.EndY].RTOFlags;
+	// Only sampled here, at the end of the last update a register write or
+	// $213E read asked for, so the threaded renderer's extra chunks do not
+	// change what $213E returns.
+	PPU.RangeTimeOver |= GFX.OBJLines[SyncEndY].RTOFlags;
+
+	if (Settings.ThreadedRenderer && StartRenderer())
+		QueueScreenUpdate(SyncEndY);
+	else
+	{
+		static struct SRenderChunk	chunk;
 
-	GFX.StartY = IPPU.PreviousLine;
-	if ((GFX.EndY = IPPU.CurrentLine - 1) >= PPU.ScreenHeight)
-		GFX.EndY = PPU.ScreenHeight - 1;
+		S9xWaitForRenderer();
+		PrepareScreenUpdate(chunk);
+		SyncEndY = chunk.EndY;
+
+		if (chunk.StartY <= chunk.EndY)
+			DrawScreenUpdate(chunk);
+	}
+
+	IPPU.PreviousLine = IPPU.DrawnLine = IPPU.CurrentLine;
+}
+
+// Works out the next range of lines to draw and captures the PPU state to
+// draw it with. Runs on the main thread.
+static void PrepareScreenUpdate (struct SRenderChunk &chunk)
+{
+	static uint32	FixedColour = 0;
+
+	chunk.StartY = IPPU.DrawnLine;
+	if ((chunk.EndY = IPPU.CurrentLine - 1) >= PPU.ScreenHeight)
+		chunk.EndY = PPU.ScreenHeight - 1;
 
 	if (!PPU.ForcedBlanking)
 	{
@@ -459,7 +692,9 @@ void S9xUpdateScreen (void)
 		if (!IPPU.DoubleWidthPixels && (PPU.BGMode == 5 || PPU.BGMode == 6 || IPPU.PseudoHires))
 		{
 			// Have to back out of the regular speed hack
-			for (uint32 y = 0; y < GFX.StartY; y++)
+			S9xWaitForRenderer();
+
+			for (uint32 y = 0; y < chunk.StartY; y++)
 			{
 				uint16	*p = GFX.Screen + y * GFX.PPL + 255;
 				uint16	*q = GFX.Screen + y * GFX.PPL + 510;
@@ -474,20 +709,66 @@ void S9xUpdateScreen (void)
 
 		if (!IPPU.DoubleHeightPixels && IPPU.Interlace && (PPU.BGMode == 5 || PPU.BGMode == 6))
 		{
+			S9xWaitForRenderer();
+
 			IPPU.DoubleHeightPixels = TRUE;
 			IPPU.RenderedScreenHeight = PPU.ScreenHeight << 1;
 			GFX.PPL = GFX.RealPPL << 1;
 			GFX.DoInterlace = 2;
 
-			for (int32 y = (int32) GFX.StartY - 2; y >= 0; y--)
+			for (int32 y = (int32) chunk.StartY - 2; y >= 0; y--)
 				memmove(GFX.Screen + (y + 1) * GFX.PPL, GFX.Screen + y * GFX.RealPPL, GFX.PPL * sizeof(uint16));
 		}
 
 		if ((Memory.FillRAM[0x2130] & 0x30) != 0x30 && (Memory.FillRAM[0x2131] & 0x3f))
-			GFX.FixedColour = BUILD_PIXEL(IPPU.XB[PPU.FixedColourRed], IPPU.XB[PPU.FixedColourGreen], IPPU.XB[PPU.FixedColourBlue]);
+			FixedColour = BUILD_PIXEL(IPPU.XB[PPU.FixedColourRed], IPPU.XB[PPU.FixedColourGreen], IPPU.XB[PPU.FixedColourBlue]);
+	}
+
+	chunk.FixedColour = FixedColour;
 
-		if (PPU.BGMode == 5 || PPU.BGMode == 6 || IPPU.PseudoHires ||
-			((Memory.FillRAM[0x2130] & 0x30) != 0x30 && (Memory.FillRAM[0x2130] & 2) && (Memory.FillRAM[0x2131] & 0x3f) && (Memory.FillRAM[0x212d] & 0x1f)))
+	struct SRenderPPU	&r = chunk.PPU;
+
+	for (int i = 0; i < 4; i++)
+	{
+		r.BG[i].SCBase = PPU.BG[i].SCBase;
+		r.BG[i].BGSize = PPU.BG[i].BGSize;
+		r.BG[i].NameBase = PPU.BG[i].NameBase;
+		r.BG[i].SCSize = PPU.BG[i].SCSize;
+		r.BGMosaic[i] = PPU.BGMosaic[i];
+	}
+
+	r.BGMode = PPU.BGMode;
+	r.BG3Priority = PPU.BG3Priority;
+	r.OBJNameBase = PPU.OBJNameBase;
+	r.OBJNameSelect = PPU.OBJNameSelect;
+	r.Mode7HFlip = PPU.Mode7HFlip;
+	r.Mode7VFlip = PPU.Mode7VFlip;
+	r.Mode7Repeat = PPU.Mode7Repeat;
+	r.Mosaic = PPU.Mosaic;
+	r.MosaicStart = PPU.MosaicStart;
+	r.ForcedBlanking = PPU.ForcedBlanking;
+	r.Interlace = IPPU.Interlace;
+	r.PseudoHires = IPPU.PseudoHires;
+	memcpy(r.Regs, &Memory.FillRAM[0x2100], sizeof(r.Regs));
+	r.Clip[0] = IPPU.Clip[0];
+	r.Clip[1] = IPPU.Clip[1];
+	r.ScreenColors = IPPU.ScreenColors;
+}
+
+// Draws one range of lines. May run on the renderer thread, so it must only
+// read the captured state and what the main thread waits for before changing,
+// and write the screen buffers, GFX, BG and RPPU.
+static void DrawScreenUpdate (const struct SRenderChunk &chunk)
+{
+	GFX.StartY = chunk.StartY;
+	GFX.EndY = chunk.EndY;
+	GFX.FixedColour = chunk.FixedColour;
+	RPPU = chunk.PPU;
+
+	if (!RPPU.ForcedBlanking)
+	{
+		if (RPPU.BGMode == 5 || RPPU.BGMode == 6 || RPPU.PseudoHires ||
+			((RPPU.Regs[0x30] & 0x30) != 0x30 && (RPPU.Regs[0x30] & 2) && (RPPU.Regs[0x31] & 0x3f) && (RPPU.Regs[0x2d] & 0x1f)))
 			// If hires (Mode 5/6 or pseudo-hires) or math is to be done
 			// involving the subscreen, then we need to render the subscreen...
 			RenderScreen(TRUE);
@@ -506,14 +787,15 @@ void S9xUpdateScreen (void)
 			for (int x = 0; x < IPPU.RenderedScreenWidth; x++)
 				GFX.S[x] = black;
 	}
-
-	IPPU.PreviousLine = IPPU.CurrentLine;
 }
 
 static void SetupOBJ (void)
 {
 	int	SmallWidth, SmallHeight, LargeWidth, LargeHeight;
 
+	// The renderer thread draws from the tables built here.
+	S9xWaitForRenderer();
+
 	switch (PPU.OBJSizeSelect)
 	{
 		case 0:
@@ -848,19 +1130,19 @@ static void DrawOBJS (int D)
 
 static void DrawBackground (int bg, uint8 Zh, uint8 Zl)
 {
-	BG.TileAddress = PPU.BG[bg].NameBase << 1;
+	BG.TileAddress = RPPU.BG[bg].NameBase << 1;
 
 	uint32	Tile;
 	uint16	*SC0, *SC1, *SC2, *SC3;
 
-	SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
-	SC1 = (PPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
+	SC0 = (uint16 *) &Memory.VRAM[RPPU.BG[bg].SCBase << 1];
+	SC1 = (RPPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
 	if (SC1 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC1 -= 0x8000;
-	SC2 = (PPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
+	SC2 = (RPPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
 	if (SC2 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC2 -= 0x8000;
-	SC3 = (PPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
+	SC3 = (RPPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
 	if (SC3 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC3 -= 0x8000;
 
@@ -868,7 +1150,7 @@ static void DrawBackground (int bg, uint8 Zh, uint8 Zl)
 	int		OffsetMask  = (BG.TileSizeH == 16) ? 0x3ff : 0x1ff;
 	int		OffsetShift = (BG.TileSizeV == 16) ? 4 : 3;
 	int		PixWidth = IPPU.DoubleWidthPixels ? 2 : 1;
-	bool8	HiresInterlace = IPPU.Interlace && IPPU.DoubleWidthPixels;
+	bool8	HiresInterlace = RPPU.Interlace && IPPU.DoubleWidthPixels;
 
 	void (*DrawTile) (uint32, uint32, uint32, uint32);
 	void (*DrawClippedTile) (uint32, uint32, uint32, uint32, uint32, uint32);
@@ -895,15 +1177,13 @@ static void DrawBackground (int bg, uint8 Zh, uint8 Zl)
 			uint32	HOffset = LineData[Y].BG[bg].HOffset;
 			int		VirtAlign = ((Y2 + VOffset) & 7) >> (HiresInterlace ? 1 : 0);
 
-			for (Lines = 1; Lines < GFX.LinesPerTile - VirtAlign; Lines++)
+			// Lines past GFX.EndY may not have been captured yet.
+			for (Lines = 1; Lines < GFX.LinesPerTile - VirtAlign && Y + Lines <= GFX.EndY; Lines++)
 			{
 				if ((VOffset != LineData[Y + Lines].BG[bg].VOffset) || (HOffset != LineData[Y + Lines].BG[bg].HOffset))
 					break;
 			}
 
-			if (Y + Lines > GFX.EndY)
-				Lines = GFX.EndY - Y + 1;
-
 			VirtAlign <<= 3;
 
 			uint32	t1, t2;
@@ -1065,19 +1345,19 @@ static void DrawBackground (int bg, uint8 Zh, uint8 Zl)
 
 static void DrawBackgroundMosaic (int bg, uint8 Zh, uint8 Zl)
 {
-	BG.TileAddress = PPU.BG[bg].NameBase << 1;
+	BG.TileAddress = RPPU.BG[bg].NameBase << 1;
 
 	uint32	Tile;
 	uint16	*SC0, *SC1, *SC2, *SC3;
 
-	SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
-	SC1 = (PPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
+	SC0 = (uint16 *) &Memory.VRAM[RPPU.BG[bg].SCBase << 1];
+	SC1 = (RPPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
 	if (SC1 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC1 -= 0x8000;
-	SC2 = (PPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
+	SC2 = (RPPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
 	if (SC2 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC2 -= 0x8000;
-	SC3 = (PPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
+	SC3 = (RPPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
 	if (SC3 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC3 -= 0x8000;
 
@@ -1085,11 +1365,11 @@ static void DrawBackgroundMosaic (int bg, uint8 Zh, uint8 Zl)
 	int	OffsetMask  = (BG.TileSizeH == 16) ? 0x3ff : 0x1ff;
 	int	OffsetShift = (BG.TileSizeV == 16) ? 4 : 3;
 	int	PixWidth = IPPU.DoubleWidthPixels ? 2 : 1;
-	bool8	HiresInterlace = IPPU.Interlace && IPPU.DoubleWidthPixels;
+	bool8	HiresInterlace = RPPU.Interlace && IPPU.DoubleWidthPixels;
 
 	void (*DrawPix) (uint32, uint32, uint32, uint32, uint32, uint32);
 
-	int	MosaicStart = ((uint32) GFX.StartY - PPU.MosaicStart) % PPU.Mosaic;
+	int	MosaicStart = ((uint32) GFX.StartY - RPPU.MosaicStart) % RPPU.Mosaic;
 
 	for (int clip = 0; clip < GFX.Clip[bg].Count; clip++)
 	{
@@ -1100,13 +1380,13 @@ static void DrawBackgroundMosaic (int bg, uint8 Zh, uint8 Zl)
 		else
 			DrawPix = GFX.DrawMosaicPixelNomath;
 
-		for (uint32 Y = GFX.StartY - MosaicStart; Y <= GFX.EndY; Y += PPU.Mosaic)
+		for (uint32 Y = GFX.StartY - MosaicStart; Y <= GFX.EndY; Y += RPPU.Mosaic)
 		{
 			uint32	Y2 = HiresInterlace ? Y * 2 : Y;
 			uint32	VOffset = LineData[Y + MosaicStart].BG[bg].VOffset + (HiresInterlace ? 1 : 0);
 			uint32	HOffset = LineData[Y + MosaicStart].BG[bg].HOffset;
 
-			Lines = PPU.Mosaic - MosaicStart;
+			Lines = RPPU.Mosaic - MosaicStart;
 			if (Y + MosaicStart + Lines > GFX.EndY)
 				Lines = GFX.EndY - Y - MosaicStart + 1;
 
@@ -1146,7 +1426,7 @@ static void DrawBackgroundMosaic (int bg, uint8 Zh, uint8 Zl)
 			uint32	Left   = GFX.Clip[bg].Left[clip];
 			uint32	Right  = GFX.Clip[bg].Right[clip];
 			uint32	Offset = Left * PixWidth + (Y + MosaicStart) * GFX.PPL;
-			uint32	HPos   = (HOffset + Left - (Left % PPU.Mosaic)) & OffsetMask;
+			uint32	HPos   = (HOffset + Left - (Left % RPPU.Mosaic)) & OffsetMask;
 			uint32	HTile  = HPos >> 3;
 			uint16	*t;
 
@@ -1171,7 +1451,7 @@ static void DrawBackgroundMosaic (int bg, uint8 Zh, uint8 Zl)
 
 			while (Left < Right)
 			{
-				uint32	w = PPU.Mosaic - (Left % PPU.Mosaic);
+				uint32	w = RPPU.Mosaic - (Left % RPPU.Mosaic);
 				if (w > Width)
 					w = Width;
 
@@ -1191,7 +1471,7 @@ static void DrawBackgroundMosaic (int bg, uint8 Zh, uint8 Zl)
 						DrawPix(TILE_PLUS(Tile, 1 - (HTile & 1)), Offset, VirtAlign, HPos & 7, w, Lines);
 				}
 
-				HPos += PPU.Mosaic;
+				HPos += RPPU.Mosaic;
 
 				while (HPos >= 8)
 				{
@@ -1231,31 +1511,31 @@ static void DrawBackgroundMosaic (int bg, uint8 Zh, uint8 Zl)
 
 static void DrawBackgroundOffset (int bg, uint8 Zh, uint8 Zl, int VOffOff)
 {
-	BG.TileAddress = PPU.BG[bg].NameBase << 1;
+	BG.TileAddress = RPPU.BG[bg].NameBase << 1;
 
 	uint32	Tile;
 	uint16	*SC0, *SC1, *SC2, *SC3;
 	uint16	*BPS0, *BPS1, *BPS2, *BPS3;
 
-	BPS0 = (uint16 *) &Memory.VRAM[PPU.BG[2].SCBase << 1];
-	BPS1 = (PPU.BG[2].SCSize & 1) ? BPS0 + 1024 : BPS0;
+	BPS0 = (uint16 *) &Memory.VRAM[RPPU.BG[2].SCBase << 1];
+	BPS1 = (RPPU.BG[2].SCSize & 1) ? BPS0 + 1024 : BPS0;
 	if (BPS1 >= (uint16 *) (Memory.VRAM + 0x10000))
 		BPS1 -= 0x8000;
-	BPS2 = (PPU.BG[2].SCSize & 2) ? BPS1 + 1024 : BPS0;
+	BPS2 = (RPPU.BG[2].SCSize & 2) ? BPS1 + 1024 : BPS0;
 	if (BPS2 >= (uint16 *) (Memory.VRAM + 0x10000))
 		BPS2 -= 0x8000;
-	BPS3 = (PPU.BG[2].SCSize & 1) ? BPS2 + 1024 : BPS2;
+	BPS3 = (RPPU.BG[2].SCSize & 1) ? BPS2 + 1024 : BPS2;
 	if (BPS3 >= (uint16 *) (Memory.VRAM + 0x10000))
 		BPS3 -= 0x8000;
 
-	SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
-	SC1 = (PPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
+	SC0 = (uint16 *) &Memory.VRAM[RPPU.BG[bg].SCBase << 1];
+	SC1 = (RPPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
 	if (SC1 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC1 -= 0x8000;
-	SC2 = (PPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
+	SC2 = (RPPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
 	if (SC2 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC2 -= 0x8000;
-	SC3 = (PPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
+	SC3 = (RPPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
 	if (SC3 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC3 -= 0x8000;
 
@@ -1265,7 +1545,7 @@ static void DrawBackgroundOffset (int bg, uint8 Zh, uint8 Zl, int VOffOff)
 	int	Offset2Shift = (BG.OffsetSizeV == 16) ? 4 : 3;
 	int	OffsetEnableMask = 0x2000 << bg;
 	int	PixWidth = IPPU.DoubleWidthPixels ? 2 : 1;
-	bool8	HiresInterlace = IPPU.Interlace && IPPU.DoubleWidthPixels;
+	bool8	HiresInterlace = RPPU.Interlace && IPPU.DoubleWidthPixels;
 
 	void (*DrawClippedTile) (uint32, uint32, uint32, uint32, uint32, uint32);
 
@@ -1459,31 +1739,31 @@ static void DrawBackgroundOffset (int bg, uint8 Zh, uint8 Zl, int VOffOff)
 
 static void DrawBackgroundOffsetMosaic (int bg, uint8 Zh, uint8 Zl, int VOffOff)
 {
-	BG.TileAddress = PPU.BG[bg].NameBase << 1;
+	BG.TileAddress = RPPU.BG[bg].NameBase << 1;
 
 	uint32	Tile;
 	uint16	*SC0, *SC1, *SC2, *SC3;
 	uint16	*BPS0, *BPS1, *BPS2, *BPS3;
 
-	BPS0 = (uint16 *) &Memory.VRAM[PPU.BG[2].SCBase << 1];
-	BPS1 = (PPU.BG[2].SCSize & 1) ? BPS0 + 1024 : BPS0;
+	BPS0 = (uint16 *) &Memory.VRAM[RPPU.BG[2].SCBase << 1];
+	BPS1 = (RPPU.BG[2].SCSize & 1) ? BPS0 + 1024 : BPS0;
 	if (BPS1 >= (uint16 *) (Memory.VRAM + 0x10000))
 		BPS1 -= 0x8000;
-	BPS2 = (PPU.BG[2].SCSize & 2) ? BPS1 + 1024 : BPS0;
+	BPS2 = (RPPU.BG[2].SCSize & 2) ? BPS1 + 1024 : BPS0;
 	if (BPS2 >= (uint16 *) (Memory.VRAM + 0x10000))
 		BPS2 -= 0x8000;
-	BPS3 = (PPU.BG[2].SCSize & 1) ? BPS2 + 1024 : BPS2;
+	BPS3 = (RPPU.BG[2].SCSize & 1) ? BPS2 + 1024 : BPS2;
 	if (BPS3 >= (uint16 *) (Memory.VRAM + 0x10000))
 		BPS3 -= 0x8000;
 
-	SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
-	SC1 = (PPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
+	SC0 = (uint16 *) &Memory.VRAM[RPPU.BG[bg].SCBase << 1];
+	SC1 = (RPPU.BG[bg].SCSize & 1) ? SC0 + 1024 : SC0;
 	if (SC1 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC1 -= 0x8000;
-	SC2 = (PPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
+	SC2 = (RPPU.BG[bg].SCSize & 2) ? SC1 + 1024 : SC0;
 	if (SC2 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC2 -= 0x8000;
-	SC3 = (PPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
+	SC3 = (RPPU.BG[bg].SCSize & 1) ? SC2 + 1024 : SC2;
 	if (SC3 >= (uint16 *) (Memory.VRAM + 0x10000))
 		SC3 -= 0x8000;
 
@@ -1493,11 +1773,11 @@ static void DrawBackgroundOffsetMosaic (int bg, uint8 Zh, uint8 Zl, int VOffOff)
 	int	Offset2Shift = (BG.OffsetSizeV == 16) ? 4 : 3;
 	int	OffsetEnableMask = 0x2000 << bg;
 	int	PixWidth = IPPU.DoubleWidthPixels ? 2 : 1;
-	bool8	HiresInterlace = IPPU.Interlace && IPPU.DoubleWidthPixels;
+	bool8	HiresInterlace = RPPU.Interlace && IPPU.DoubleWidthPixels;
 
 	void (*DrawPix) (uint32, uint32, uint32, uint32, uint32, uint32);
 
-	int	MosaicStart = ((uint32) GFX.StartY - PPU.MosaicStart) % PPU.Mosaic;
+	int	MosaicStart = ((uint32) GFX.StartY - RPPU.MosaicStart) % RPPU.Mosaic;
 
 	for (int clip = 0; clip < GFX.Clip[bg].Count; clip++)
 	{
@@ -1508,13 +1788,13 @@ static void DrawBackgroundOffsetMosaic (int bg, uint8 Zh, uint8 Zl, int VOffOff)
 		else
 			DrawPix = GFX.DrawMosaicPixelNomath;
 
-		for (uint32 Y = GFX.StartY - MosaicStart; Y <= GFX.EndY; Y += PPU.Mosaic)
+		for (uint32 Y = GFX.StartY - MosaicStart; Y <= GFX.EndY; Y += RPPU.Mosaic)
 		{
 			uint32	Y2 = HiresInterlace ? Y * 2 : Y;
 			uint32	VOff = LineData[Y + MosaicStart].BG[2].VOffset - 1;
 			uint32	HOff = LineData[Y + MosaicStart].BG[2].HOffset;
 
-			Lines = PPU.Mosaic - MosaicStart;
+			Lines = RPPU.Mosaic - MosaicStart;
 			if (Y + MosaicStart + Lines > GFX.EndY)
 				Lines = GFX.EndY - Y - MosaicStart + 1;
 
@@ -1635,7 +1915,7 @@ static void DrawBackgroundOffsetMosaic (int bg, uint8 Zh, uint8 Zl, int VOffOff)
 				b1 += (TilemapRow & 0x1f) << 5;
 				b2 += (TilemapRow & 0x1f) << 5;
 
-				uint32	HPos = (HOffset + Left - (Left % PPU.Mosaic)) & OffsetMask;
+				uint32	HPos = (HOffset + Left - (Left % RPPU.Mosaic)) & OffsetMask;
 				uint32	HTile = HPos >> 3;
 				uint16	*t;
 
@@ -1654,7 +1934,7 @@ static void DrawBackgroundOffsetMosaic (int bg, uint8 Zh, uint8 Zl, int VOffOff)
 						t = b1 + (HTile >> 1);
 				}
 
-				uint32	w = PPU.Mosaic - (Left % PPU.Mosaic);
+				uint32	w = RPPU.Mosaic - (Left % RPPU.Mosaic);
 				if (w > Width)
 					w = Width;
 
@@ -1924,6 +2204,16 @@ static void DisplayFrameRate (void)
 #endif
 
 	S9xDisplayString(string, 1, IPPU.RenderedScreenWidth - (font_width - 1) * len - 1, false);
+
+	// What run-ahead adds on top of emulating the frame once.
+	if (RunAheadStats.Frames)
+	{
+		char	ra[32];
+		uint32	extra = RunAheadStats.TotalMicroseconds > RunAheadStats.FrameMicroseconds ? RunAheadStats.TotalMicroseconds - RunAheadStats.FrameMicroseconds : 0;
+
+		snprintf(ra, sizeof(ra), "RA%u +%u.%ums", RunAheadStats.Frames, extra / 1000, (extra / 100) % 10);
+		S9xDisplayString(ra, 3, IPPU.RenderedScreenWidth - (font_width - 1) * strlen(ra) - 1, false);
+	}
 }
 
 static void DisplayPressedKeys (void)
@@ -93,6 +93,9 @@ struct SBG
 	uint8	*BufferFlip;
 	uint8	*Buffered;
 	uint8	*BufferedFlip;
+	uint32	*BufferedGen;
+	uint32	*BufferedGenFlip;
+	uint32	CacheLines;
 	bool8	DirectColourMode;
 };
 
@@ -117,12 +120,45 @@ struct SLineMatrixData
 	short	M7VOFS;
 };
 
+// PPU state the scanline renderer reads, captured when a range of lines is
+// handed to it. The threaded renderer draws from its own copy, so the CPU can
+// keep writing these registers (HDMA included) without waiting for it.
+struct SRenderPPU
+{
+	struct
+	{
+		uint16	SCBase;
+		uint8	BGSize;
+		uint16	NameBase;
+		uint16	SCSize;
+	}	BG[4];
+
+	uint8	BGMode;
+	uint8	BG3Priority;
+	uint16	OBJNameBase;
+	uint16	OBJNameSelect;
+	bool8	Mode7HFlip;
+	bool8	Mode7VFlip;
+	uint8	Mode7Repeat;
+	uint8	Mosaic;
+	uint8	MosaicStart;
+	bool8	BGMosaic[4];
+	bool8	ForcedBlanking;
+	bool8	Interlace;
+	bool8	PseudoHires;
+	uint8	Regs[0x40];			// $2100-$213F
+
+	struct ClipData	*Clip[2];
+	uint16	*ScreenColors;
+};
+
 extern uint16		BlackColourMap[256];
 extern uint16		DirectColourMaps[8][256];
 extern uint8		mul_brightness[16][32];
 extern uint8		brightness_cap[64];
 extern struct SBG	BG;
 extern struct SGFX	GFX;
+extern struct SRenderPPU	RPPU;
 
 #define H_FLIP		0x4000
 #define V_FLIP		0x8000
@@ -204,6 +240,7 @@ void S9xStartScreenRefresh (void);
 void S9xEndScreenRefresh (void);
 void S9xBuildDirectColourMaps (void);
 void RenderLine (uint8);
+void S9xWaitForRenderer (void);
 void S9xComputeClipWindows (void);
 void S9xDisplayChar (uint16 *, uint8);
 void S9xGraphicsScreenResize (void);
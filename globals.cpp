@@ -12,6 +12,7 @@
 #include "fxemu.h"
 #include "srtc.h"
 #include "cheats.h"
+#include "profile.h"
 #ifdef NETPLAY_SUPPORT
 #include "netplay.h"
 #endif
@@ -29,6 +30,7 @@ struct SDMA				DMA[8];
 struct STimings			Timings;
 struct SGFX				GFX;
 struct SBG				BG;
+struct SRenderPPU		RPPU;
 struct SLineData		LineData[240];
 struct SLineMatrixData	LineMatrixData[240];
 struct SDSP0			DSP0;
@@ -50,8 +52,11 @@ struct SRTCData			RTCData;
 struct SBSX				BSX;
 struct SMSU1			MSU1;
 struct SMulti			Multi;
+struct SDirtyPages		Dirty;
 struct SSettings		Settings;
 struct SSNESGameFixes	SNESGameFixes;
+struct SProfiler		Profiler;
+struct SRunAheadStats	RunAheadStats;
 #ifdef NETPLAY_SUPPORT
 struct SNetPlay			NetPlay;
 #endif
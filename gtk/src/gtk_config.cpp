@@ -132,11 +132,13 @@ int Snes9xConfig::load_defaults()
     ntsc_scanline_intensity = 1;
     scanline_filter_intensity = 0;
     Settings.BilinearFilter = false;
+    Settings.ThreadedRenderer = false;
     netplay_activated = false;
     netplay_server_up = false;
     netplay_is_server = false;
     netplay_sync_reset = true;
     netplay_send_rom = false;
+    netplay_rollback = false;
     netplay_default_port = 6096;
     netplay_max_frame_loss = 10;
     netplay_last_rom.clear();
@@ -162,6 +164,7 @@ int Snes9xConfig::load_defaults()
     Settings.MultiPlayer5Master = true;
     Settings.UpAndDown = false;
     Settings.AutoSaveDelay = 0;
+    Settings.RunAhead = 0;
     Settings.SkipFrames = 0;
     Settings.Transparency = true;
     Settings.DisplayTime = false;
@@ -180,6 +183,8 @@ int Snes9xConfig::load_defaults()
     Settings.DynamicRateControl = false;
     Settings.DynamicRateLimit = 5;
     Settings.InterpolationMethod = DSP_INTERPOLATION_GAUSSIAN;
+    Settings.ResamplerQuality = 0;
+    Settings.ParallelVoices = false;
     Settings.HDMATimingHack = 100;
     Settings.SuperFXClockMultiplier = 100;
     Settings.NetPlay = false;
@@ -228,6 +233,7 @@ int Snes9xConfig::save_config_file()
     outbool("MaintainAspectRatio", maintain_aspect_ratio, "Resize the screen to the proportions set by aspect ratio option");
     outbool("Multithreading", multithreading, "Apply filters using multiple threads");
     outbool("BilinearFilter", Settings.BilinearFilter, "Smoothes scaled image");
+    outbool("ThreadedRenderer", Settings.ThreadedRenderer, "Draw the SNES screen on a separate thread");
     outbool("ForceInvertedByteOrder", force_inverted_byte_order);
     outint("VideoMode", xrr_index, "Platform-specific video mode number");
     outint("AspectRatio", aspect_ratio, "0: uncorrected, 1: uncorrected integer scale, 2: 4:3, 3: 4/3 integer scale, 4: NTSC/PAL, 5: NTSC/PAL integer scale");
@@ -299,6 +305,7 @@ int Snes9xConfig::save_config_file()
     outbool("ActAsServer", netplay_is_server);
     outbool("UseResetToSync", netplay_sync_reset);
     outbool("SendROM", netplay_send_rom);
+    outbool("Rollback", netplay_rollback, "Predict other players' input and roll back when wrong, instead of waiting for it");
     outint("DefaultPort", netplay_default_port);
     outint("MaxFrameLoss", netplay_max_frame_loss);
     outint("LastUsedPort", netplay_last_port);
@@ -322,12 +329,15 @@ int Snes9xConfig::save_config_file()
     outbool("DisplayIndicators", Settings.DisplayIndicators);
     outint("SpeedControlMethod", Settings.SkipFrames, "0: Time the frames to 50 or 60Hz, 1: Same, but skip frames if too slow, 2: Synchronize to the sound buffer, 3: Unlimited, except potentially by vsync");
     outint("SaveSRAMEveryNSeconds", Settings.AutoSaveDelay);
+    outint("RunAheadFrames", Settings.RunAhead, "Emulate this many frames ahead to hide the game's input lag, 0 to disable");
     outbool("BlockInvalidVRAMAccess", Settings.BlockInvalidVRAMAccessMaster);
     outbool("AllowDPadContradictions", Settings.UpAndDown, "Allow the D-Pad to press both up + down at the same time, or left + right");
 
     section = "Hacks";
     outint("SuperFXClockMultiplier", Settings.SuperFXClockMultiplier);
     outint("SoundInterpolationMethod", Settings.InterpolationMethod, "0: None, 1: Linear, 2: Gaussian (what the hardware uses), 3: Cubic, 4: Sinc");
+    outint("ResamplerQuality", Settings.ResamplerQuality, "0: Cubic, 1: 8-tap sinc, 2: 16-tap sinc");
+    outbool("ParallelVoices", Settings.ParallelVoices, "Mix the DSP voices in lockstep, with identical output");
     outbool("RemoveSpriteLimit", Settings.MaxSpriteTilesPerLine == 34 ? 0 : 1);
     outbool("OverclockCPU", Settings.OneClockCycle == 6 ? 0 : 1);
     outbool("EchoBufferHack", Settings.SeparateEchoBuffer, "Prevents echo buffer from overwriting APU RAM");
@@ -462,6 +472,7 @@ int Snes9xConfig::load_config_file()
     inint("NumberOfThreads", num_threads);
     instr("HardwareAcceleration", display_driver);
     inbool("BilinearFilter", Settings.BilinearFilter);
+    inbool("ThreadedRenderer", Settings.ThreadedRenderer);
     inint("SplashBackground", splash_image);
     inbool("AutoVRR", auto_vrr);
     inint("OSDSize", osd_size);
@@ -522,6 +533,7 @@ int Snes9xConfig::load_config_file()
     inbool("ActAsServer", netplay_is_server);
     inbool("UseResetToSync", netplay_sync_reset);
     inbool("SendROM", netplay_send_rom);
+    inbool("Rollback", netplay_rollback);
     inint("DefaultPort", netplay_default_port);
     inint("MaxFrameLoss", netplay_max_frame_loss);
     inint("LastUsedPort", netplay_last_port);
@@ -544,6 +556,9 @@ int Snes9xConfig::load_config_file()
     inbool("DisplayPressedKeys", Settings.DisplayPressedKeys);
     inint("SpeedControlMethod", Settings.SkipFrames);
     inint("SaveSRAMEveryNSeconds", Settings.AutoSaveDelay);
+    int run_ahead = Settings.RunAhead;
+    inint("RunAheadFrames", run_ahead);
+    Settings.RunAhead = S9xClampRunAhead(run_ahead);
     inbool("BlockInvalidVRAMAccess", Settings.BlockInvalidVRAMAccessMaster);
     inbool("AllowDPadContradictions", Settings.UpAndDown);
     inbool("DisplayIndicators", Settings.DisplayIndicators);
@@ -551,6 +566,8 @@ int Snes9xConfig::load_config_file()
     section = "Hacks";
     inint("SuperFXClockMultiplier", Settings.SuperFXClockMultiplier);
     inint("SoundInterpolationMethod", Settings.InterpolationMethod);
+    inint("ResamplerQuality", Settings.ResamplerQuality);
+    inbool("ParallelVoices", Settings.ParallelVoices);
 
     bool RemoveSpriteLimit = false;
     inbool("RemoveSpriteLimit", RemoveSpriteLimit);
@@ -112,6 +112,7 @@ class Snes9xConfig
     bool netplay_is_server;
     bool netplay_sync_reset;
     bool netplay_send_rom;
+    bool netplay_rollback;
     int netplay_default_port;
     int netplay_max_frame_loss;
     std::string netplay_last_rom;
@@ -143,6 +143,7 @@ void S9xNetplayStartServer()
     Settings.NetPlayServer = true;
     NPServer.SyncByReset = gui_config->netplay_sync_reset;
     NPServer.SendROMImageOnConnect = gui_config->netplay_send_rom;
+    NPServer.Rollback = gui_config->netplay_rollback;
 
     npthread = g_thread_new(NULL, S9xNetplayServerThread, NULL);
 
@@ -197,7 +198,7 @@ void S9xNetplayDialogOpen()
 
 int S9xNetplaySyncSpeed()
 {
-    if (!Settings.NetPlay || !NetPlay.Connected)
+    if (!Settings.NetPlay || !NetPlay.Connected || NetPlay.Rollback)
         return 0;
 
     // Send 1st joypad's position update to server
@@ -272,6 +273,30 @@ int S9xNetplayPush()
     if (!Settings.NetPlay)
         return 0;
 
+    if (NetPlay.Rollback)
+    {
+        // Paused here: the server has been told and pauses the others.
+        // Keep reading from it, but send no input and run no frame.
+        if (Settings.Paused)
+        {
+            S9xNPRollbackPoll();
+            return 1;
+        }
+
+        for (int i = 0; i < 8; i++)
+            local_joypads[i] = MovieGetJoypad(i);
+
+        if (!S9xNPRollbackFrame(local_joypads[0]))
+        {
+            S9xProcessEvents(false);
+            S9xSoundStop();
+            return 1;
+        }
+
+        S9xSoundStart();
+        return 0;
+    }
+
     if (NetPlay.PendingWait4Sync && !S9xNPWaitForHeartBeatDelay(100))
     {
         S9xProcessEvents(false);
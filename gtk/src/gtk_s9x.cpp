@@ -317,7 +317,10 @@ static bool S9xIdleFunc()
 
     if (!S9xNetplayPush())
     {
-        if (Settings.Rewinding)
+        // Rollback netplay keeps its own states; rewinding would desync it.
+        if (Settings.NetPlay && NetPlay.Rollback)
+            Settings.Rewinding = false;
+        else if (Settings.Rewinding)
         {
             uint16 joypads[8];
             for (int i = 0; i < 8; i++)
@@ -201,10 +201,27 @@ void S9xSamplesAvailable(void *userdata)
         return;
     }
 
-    if ((int)temp_buffer.size() < samples)
-        temp_buffer.resize(samples);
-    S9xMixSamples((uint8_t *)temp_buffer.data(), samples);
-    driver->write_samples(temp_buffer.data(), samples);
+    // Mix straight into the driver's ring where it has one; the ring wraps
+    // at most once, so that takes two goes at most.
+    while (samples > 0)
+    {
+        int length = samples;
+        int16_t *dest = driver->begin_write(length);
+        if (!dest)
+            break;
+
+        S9xMixSamples((uint8_t *)dest, length);
+        driver->end_write(length);
+        samples -= length;
+    }
+
+    if (samples > 0)
+    {
+        if ((int)temp_buffer.size() < samples)
+            temp_buffer.resize(samples);
+        S9xMixSamples((uint8_t *)temp_buffer.data(), samples);
+        driver->write_samples(temp_buffer.data(), samples);
+    }
 
     if (clear_leftover_samples)
         S9xClearSamples();
@@ -27,5 +27,6 @@
 #define SAVE_ERR_WRONG_VERSION			"Incompatible snapshot version"
 #define SAVE_ERR_ROM_NOT_FOUND			"ROM image \"%s\" for snapshot not found"
 #define SAVE_ERR_SAVE_NOT_FOUND			"Snapshot %s does not exist"
+#define SAVE_ERR_WRITE_FAILED			"Couldn't save %s"
 
 #endif
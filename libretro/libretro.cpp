@@ -329,6 +329,13 @@ static void update_variables(void)
         Settings.SuperFXClockMultiplier = freq;
     }
 
+    var.key = "snes9x_runahead";
+    var.value = NULL;
+
+    Settings.RunAhead = 0;
+    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var))
+        Settings.RunAhead = S9xClampRunAhead(atoi(var.value));
+
     var.key = "snes9x_up_down_allowed";
     var.value = NULL;
 
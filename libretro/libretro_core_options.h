@@ -179,6 +179,24 @@ struct retro_core_option_definition option_defs_us[] = {
       },
       "100%"
    },
+   {
+      "snes9x_runahead",
+      "Core Run-Ahead",
+      "Emulate this many frames ahead of the one shown to hide the game's own input lag. Each frame costs another frame of emulation. Do not combine with the frontend's run-ahead.",
+      {
+         { "0", "disabled" },
+         { "1", NULL },
+         { "2", NULL },
+         { "3", NULL },
+         { "4", NULL },
+         { "5", NULL },
+         { "6", NULL },
+         { "7", NULL },
+         { "8", NULL },
+         { NULL, NULL},
+      },
+      "0"
+   },
    {
       "snes9x_overclock_cycles",
       "Reduce Slowdown (Hack, Unsafe)",
@@ -25,6 +25,17 @@
 #include <ctype.h>
 #include <sys/stat.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#define MMAP_ROM
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
 #include "snes9x.h"
 #include "memmap.h"
 #include "apu/apu.h"
@@ -893,6 +904,149 @@ static void S9xDeinterleaveGD24 (int size, uint8 *base)
 
 // allocation and deallocation
 
+// The ROM image area is FillRAM (32K) followed by room for the largest ROM
+// plus a copier header. Where possible it comes straight from the kernel, so
+// pages that no ROM ever touches are never backed by memory.
+
+#define ROM_STORAGE_SIZE	(0x8000 + 0x200 + CMemory::MAX_ROM_SIZE)
+
+static uint8 * AllocateROMStorage (void)
+{
+#ifdef MMAP_ROM
+	void	*p = mmap(NULL, ROM_STORAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return (p == MAP_FAILED ? NULL : (uint8 *) p);
+#else
+	return ((uint8 *) calloc(ROM_STORAGE_SIZE, 1));
+#endif
+}
+
+static void FreeROMStorage (uint8 *p)
+{
+#ifdef MMAP_ROM
+	munmap(p, ROM_STORAGE_SIZE);
+#else
+	free(p);
+#endif
+}
+
+#ifdef MMAP_ROM
+// Mapping needs the ROM image area to start on a page boundary.
+static bool8 ROMAreaIsPageAligned (const uint8 *storage)
+{
+	long	page = sysconf(_SC_PAGESIZE);
+	return (page > 0 && ((uintptr_t) (storage + 0x8000) % page) == 0);
+}
+#endif
+
+#ifdef MMAP_ROM
+// With Settings.ShareROM, every process running the same ROM image maps it
+// from one file in $TMPDIR named after its SHA-256, so the pages are held
+// once however many sessions a host runs. Each user keeps a shared flock on
+// the file, and whoever drops the last one removes it.
+
+static int			SharedROMFd = -1;
+static std::string	SharedROMName;
+
+static void ReleaseSharedROM (void)
+{
+	if (SharedROMFd < 0)
+		return;
+
+	struct stat	a, b;
+
+	if (flock(SharedROMFd, LOCK_EX | LOCK_NB) == 0 &&
+		fstat(SharedROMFd, &a) == 0 && stat(SharedROMName.c_str(), &b) == 0 &&
+		a.st_dev == b.st_dev && a.st_ino == b.st_ino)
+		unlink(SharedROMName.c_str());
+
+	close(SharedROMFd);
+	SharedROMFd = -1;
+}
+
+static int PublishSharedROM (const std::string &name, const uint8 *data, size_t len)
+{
+	// mkstemp() creates the file itself with O_EXCL, so nobody can plant a
+	// symlink at the temporary name and have us write through it.
+	std::string	temp = name + ".XXXXXX";
+
+	int	fd = mkstemp(&temp[0]);
+	if (fd < 0)
+		return (-1);
+
+	if (fchmod(fd, 0644) != 0)
+	{
+		close(fd);
+		unlink(temp.c_str());
+		return (-1);
+	}
+
+	size_t	done = 0;
+	while (done < len)
+	{
+		ssize_t	n = write(fd, data + done, len - done);
+		if (n <= 0)
+			break;
+		done += n;
+	}
+
+	if (close(fd) != 0 || done != len || rename(temp.c_str(), name.c_str()) != 0)
+	{
+		unlink(temp.c_str());
+		return (-1);
+	}
+
+	return (open(name.c_str(), O_RDONLY));
+}
+
+static void ShareROMImage (uint8 *rom, uint32 size, const uint8 *sha256)
+{
+	long	page = sysconf(_SC_PAGESIZE);
+	if (page <= 0 || ((uintptr_t) rom % page) != 0)
+		return;
+
+	// Only whole pages covered by the hash are shared.
+	size_t	len = size - size % page;
+	if (len == 0)
+		return;
+
+	const char	*dir = getenv("TMPDIR");
+	char		hex[65];
+
+	for (int i = 0; i < 32; i++)
+		snprintf(hex + i * 2, 3, "%02x", sha256[i]);
+
+	std::string	name = std::string(dir && *dir ? dir : "/tmp") + SLASH_STR + "snes9x-rom-" + hex;
+
+	int	fd = open(name.c_str(), O_RDONLY);
+	if (fd < 0)
+		fd = PublishSharedROM(name, rom, len);
+	if (fd < 0)
+		return;
+
+	// Anyone can write to $TMPDIR, so the file has to be ours and hold
+	// exactly this image before it replaces the one in memory.
+	struct stat	st;
+	void		*p = MAP_FAILED;
+
+	if (flock(fd, LOCK_SH) == 0 && fstat(fd, &st) == 0 &&
+		st.st_uid == getuid() && (size_t) st.st_size == len)
+		p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+
+	if (p == MAP_FAILED || memcmp(p, rom, len) != 0 ||
+		mmap(rom, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		if (p != MAP_FAILED)
+			munmap(p, len);
+		close(fd);
+		return;
+	}
+
+	munmap(p, len);
+	SharedROMFd = fd;
+	SharedROMName = name;
+}
+#endif
+
 bool8 CMemory::Init (void)
 {
 	IPPU.TileCache[TILE_2BIT]       = (uint8 *) malloc(MAX_2BIT_TILES * 64);
@@ -911,6 +1065,14 @@ bool8 CMemory::Init (void)
 	IPPU.TileCached[TILE_4BIT_EVEN] = (uint8 *) malloc(MAX_4BIT_TILES);
 	IPPU.TileCached[TILE_4BIT_ODD]  = (uint8 *) malloc(MAX_4BIT_TILES);
 
+	IPPU.TileCachedGen[TILE_2BIT]      = (uint32 *) malloc(MAX_2BIT_TILES * sizeof(uint32));
+	IPPU.TileCachedGen[TILE_4BIT]      = (uint32 *) malloc(MAX_4BIT_TILES * sizeof(uint32));
+	IPPU.TileCachedGen[TILE_8BIT]      = (uint32 *) malloc(MAX_8BIT_TILES * sizeof(uint32));
+	IPPU.TileCachedGen[TILE_2BIT_EVEN] = (uint32 *) malloc(MAX_2BIT_TILES * sizeof(uint32));
+	IPPU.TileCachedGen[TILE_2BIT_ODD]  = (uint32 *) malloc(MAX_2BIT_TILES * sizeof(uint32));
+	IPPU.TileCachedGen[TILE_4BIT_EVEN] = (uint32 *) malloc(MAX_4BIT_TILES * sizeof(uint32));
+	IPPU.TileCachedGen[TILE_4BIT_ODD]  = (uint32 *) malloc(MAX_4BIT_TILES * sizeof(uint32));
+
 	if (!IPPU.TileCache[TILE_2BIT]       ||
 		!IPPU.TileCache[TILE_4BIT]       ||
 		!IPPU.TileCache[TILE_8BIT]       ||
@@ -924,14 +1086,29 @@ bool8 CMemory::Init (void)
 		!IPPU.TileCached[TILE_2BIT_EVEN] ||
 		!IPPU.TileCached[TILE_2BIT_ODD]  ||
 		!IPPU.TileCached[TILE_4BIT_EVEN] ||
-		!IPPU.TileCached[TILE_4BIT_ODD])
+		!IPPU.TileCached[TILE_4BIT_ODD]  ||
+		!IPPU.TileCachedGen[TILE_2BIT]      ||
+		!IPPU.TileCachedGen[TILE_4BIT]      ||
+		!IPPU.TileCachedGen[TILE_8BIT]      ||
+		!IPPU.TileCachedGen[TILE_2BIT_EVEN] ||
+		!IPPU.TileCachedGen[TILE_2BIT_ODD]  ||
+		!IPPU.TileCachedGen[TILE_4BIT_EVEN] ||
+		!IPPU.TileCachedGen[TILE_4BIT_ODD])
     {
 		Deinit();
 		return (FALSE);
     }
 
-	ROMStorage.resize(MAX_ROM_SIZE + 0x200 + 0x8000);
-	std::fill(ROMStorage.begin(), ROMStorage.end(), 0);
+	if (!ROMStorage)
+	{
+		ROMStorage = AllocateROMStorage();
+		if (!ROMStorage)
+		{
+			Deinit();
+			return (FALSE);
+		}
+	}
+
 	SRAMStorage.resize(SRAM_SIZE);
 	std::fill(SRAMStorage.begin(), SRAMStorage.end(), 0);
 	SRAM = &SRAMStorage[0];
@@ -954,6 +1131,24 @@ bool8 CMemory::Init (void)
 	memset(IPPU.TileCached[TILE_4BIT_EVEN], 0, MAX_4BIT_TILES);
 	memset(IPPU.TileCached[TILE_4BIT_ODD], 0,  MAX_4BIT_TILES);
 
+	memset(IPPU.TileCachedGen[TILE_2BIT], 0,      MAX_2BIT_TILES * sizeof(uint32));
+	memset(IPPU.TileCachedGen[TILE_4BIT], 0,      MAX_4BIT_TILES * sizeof(uint32));
+	memset(IPPU.TileCachedGen[TILE_8BIT], 0,      MAX_8BIT_TILES * sizeof(uint32));
+	memset(IPPU.TileCachedGen[TILE_2BIT_EVEN], 0, MAX_2BIT_TILES * sizeof(uint32));
+	memset(IPPU.TileCachedGen[TILE_2BIT_ODD], 0,  MAX_2BIT_TILES * sizeof(uint32));
+	memset(IPPU.TileCachedGen[TILE_4BIT_EVEN], 0, MAX_4BIT_TILES * sizeof(uint32));
+	memset(IPPU.TileCachedGen[TILE_4BIT_ODD], 0,  MAX_4BIT_TILES * sizeof(uint32));
+
+	memset(IPPU.VRAMLineGen, 0, sizeof(IPPU.VRAMLineGen));
+	IPPU.TileGen = IPPU.TileFlushGen = 1;
+
+	memset(&Dirty, 0, sizeof(Dirty));
+	Dirty.Generation = 1;
+	S9xMarkAllDirty();
+
+	for (int c = 0; c < MEMMAP_NUM_BLOCKS; c++)
+		BlockDirty[c] = Dirty.Untracked;
+
 	// FillRAM uses first 32K of ROM image area, otherwise space just
 	// wasted. Might be read by the SuperFX code.
 
@@ -962,18 +1157,12 @@ bool8 CMemory::Init (void)
 	// Add 0x8000 to ROM image pointer to stop SuperFX code accessing
 	// unallocated memory (can cause crash on some ports).
 
-	ROM = &ROMStorage[0x8000];
-
-	C4RAM   = ROM + 0x400000 + 8192 * 8; // C4
-	OBC1RAM = ROM + 0x400000; // OBC1
-	BIOSROM = ROM + 0x300000; // BS
-	BSRAM   = ROM + 0x400000; // BS
+	SetROMBase(0x8000);
 
 	SuperFX.pvRegisters = FillRAM + 0x3000;
 	SuperFX.nRamBanks   = 2; // Most only use 1.  1=64KB=512Mb, 2=128KB=1024Mb
 	SuperFX.pvRam       = SRAM;
 	SuperFX.nRomBanks   = (2 * 1024 * 1024) / (32 * 1024);
-	SuperFX.pvRom       = (uint8 *) ROM;
 
 	PostRomInitFunc = NULL;
 
@@ -983,6 +1172,17 @@ bool8 CMemory::Init (void)
 void CMemory::Deinit (void)
 {
 	ROM = NULL;
+	FillRAM = NULL;
+
+#ifdef MMAP_ROM
+	ReleaseSharedROM();
+#endif
+
+	if (ROMStorage)
+	{
+		FreeROMStorage(ROMStorage);
+		ROMStorage = NULL;
+	}
 
 	for (int t = 0; t < 7; t++)
 	{
@@ -997,6 +1197,12 @@ void CMemory::Deinit (void)
 			free(IPPU.TileCached[t]);
 			IPPU.TileCached[t] = NULL;
 		}
+
+		if (IPPU.TileCachedGen[t])
+		{
+			free(IPPU.TileCachedGen[t]);
+			IPPU.TileCachedGen[t] = NULL;
+		}
 	}
 }
 
@@ -1186,25 +1392,29 @@ int CMemory::First512BytesCountZeroes() const
 	return zeroCount;
 }
 
+void CMemory::DetectNSRTHeader (uint8 *buf)
+{
+	uint8	*NSRTHead = buf + 0x1D0; // NSRT Header Location
+
+	if (!strncmp("NSRT", (char *) &NSRTHead[24], 4))
+	{
+		if (NSRTHead[28] == 22)
+		{
+			if (((std::accumulate(NSRTHead, NSRTHead + sizeof(NSRTHeader), 0) & 0xFF) == NSRTHead[30]) &&
+				(NSRTHead[30] + NSRTHead[31] == 255) && ((NSRTHead[0] & 0x0F) <= 13) &&
+				(((NSRTHead[0] & 0xF0) >> 4) <= 3) && ((NSRTHead[0] & 0xF0) >> 4))
+				memcpy(NSRTHeader, NSRTHead, sizeof(NSRTHeader));
+		}
+	}
+}
+
 uint32 CMemory::HeaderRemove (uint32 size, uint8 *buf)
 {
 	uint32	calc_size = (size / 0x2000) * 0x2000;
 
 	if ((size - calc_size == 512 && !Settings.ForceNoHeader) || Settings.ForceHeader)
 	{
-		uint8	*NSRTHead = buf + 0x1D0; // NSRT Header Location
-
-		// detect NSRT header
-		if (!strncmp("NSRT", (char *) &NSRTHead[24], 4))
-		{
-			if (NSRTHead[28] == 22)
-			{
-				if (((std::accumulate(NSRTHead, NSRTHead + sizeof(NSRTHeader), 0) & 0xFF) == NSRTHead[30]) &&
-					(NSRTHead[30] + NSRTHead[31] == 255) && ((NSRTHead[0] & 0x0F) <= 13) &&
-					(((NSRTHead[0] & 0xF0) >> 4) <= 3) && ((NSRTHead[0] & 0xF0) >> 4))
-					memcpy(NSRTHeader, NSRTHead, sizeof(NSRTHeader));
-			}
-		}
+		DetectNSRTHeader(buf);
 
 		memmove(buf, buf + 512, calc_size);
 		HeaderCount++;
@@ -1214,11 +1424,105 @@ uint32 CMemory::HeaderRemove (uint32 size, uint8 *buf)
 	return (size);
 }
 
-uint32 CMemory::FileLoader (uint8 *buffer, const char *filename, uint32 maxsize)
+void CMemory::SetROMBase (uint32 offset)
+{
+	ROM = ROMStorage + offset;
+
+	C4RAM   = ROM + 0x400000 + 8192 * 8; // C4
+	OBC1RAM = ROM + 0x400000; // OBC1
+	BIOSROM = ROM + 0x300000; // BS
+	BSRAM   = ROM + 0x400000; // BS
+
+	SuperFX.pvRom = (uint8 *) ROM;
+}
+
+void CMemory::ClearROM (void)
+{
+	SetROMBase(0x8000);
+
+#ifdef MMAP_ROM
+	ReleaseSharedROM();
+
+	// Swapping in fresh zero pages drops the previous ROM, shared or not,
+	// without touching every page of the area.
+	if (ROMAreaIsPageAligned(ROMStorage) &&
+		mmap(ROMStorage + 0x8000, ROM_STORAGE_SIZE - 0x8000, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED)
+		return;
+#endif
+
+	memset(ROMStorage + 0x8000, 0, ROM_STORAGE_SIZE - 0x8000);
+}
+
+uint32 CMemory::ReadROMFile (const char *filename, uint32 maxsize)
+{
+	// <- ROM size without header, 0 if the stream loader has to be used
+	// ** Memory.ROM moves past a copier header rather than the data moving
+
+	// The file is read, not mapped. A private mapping keeps reading through
+	// to the file for pages nobody has written yet, so a ROM rebuilt on disk
+	// while loaded would show up half-changed, or raise SIGBUS if it shrank.
+	// Sharing the pages between instances is left to Settings.ShareROM,
+	// which maps a copy nobody edits.
+
+#ifdef MMAP_ROM
+	int	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return (0);
+
+	struct stat	st;
+	uint8		magic[2];
+
+	// gzip'd files are left to the stream loader.
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+		pread(fd, magic, 2, 0) != 2 || (magic[0] == 0x1f && magic[1] == 0x8b))
+	{
+		close(fd);
+		return (0);
+	}
+
+	uint32	size = 0;
+	uint32	want = (uint32) min(st.st_size, (off_t) (maxsize + 0x200));
+
+	while (size < want)
+	{
+		ssize_t	n = pread(fd, ROMStorage + 0x8000 + size, want - size, size);
+		if (n <= 0)
+			break;
+		size += n;
+	}
+
+	close(fd);
+
+	uint32	calc_size = (size / 0x2000) * 0x2000;
+	bool8	header = (size - calc_size == 512 && !Settings.ForceNoHeader) || Settings.ForceHeader;
+
+	if (size == 0 || (header && size <= 512))
+	{
+		ClearROM();
+		return (0);
+	}
+
+	if (header)
+	{
+		DetectNSRTHeader(ROMStorage + 0x8000);
+		SetROMBase(0x8000 + 0x200);
+		HeaderCount++;
+		size -= 512;
+	}
+
+	return (size);
+#else
+	return (0);
+#endif
+}
+
+uint32 CMemory::FileLoader (uint8 *buffer, const char *filename, uint32 maxsize, bool8 direct)
 {
 	// <- ROM size without header
 	// ** Memory.HeaderCount
 	// ** Memory.ROMFilename
+	// ** Memory.ROM, if direct is set (buffer must be a freshly cleared ROM)
 
 	uint32	totalSize = 0;
 	memset(NSRTHeader, 0, sizeof(NSRTHeader));
@@ -1274,6 +1578,12 @@ uint32 CMemory::FileLoader (uint8 *buffer, const char *filename, uint32 maxsize)
 		case FILE_DEFAULT:
 		default:
 		{
+			if (direct && (totalSize = ReadROMFile(filename, maxsize)) != 0)
+			{
+				ROMFilename = filename;
+				break;
+			}
+
 			STREAM	fp = OPEN_STREAM(filename, "rb");
 			if (!fp)
 				return (0);
@@ -1313,7 +1623,7 @@ bool8 CMemory::LoadROMMem (const uint8 *source, uint32 sourceSize, const char* o
 
     do
     {
-        memset(ROM,0, MAX_ROM_SIZE);
+        ClearROM();
         memset(&Multi, 0,sizeof(Multi));
         memcpy(ROM,source,sourceSize);
     }
@@ -1333,9 +1643,9 @@ bool8 CMemory::LoadROM (const char *filename)
 
     do
     {
-        memset(ROM,0, MAX_ROM_SIZE);
+        ClearROM();
         memset(&Multi, 0,sizeof(Multi));
-        totalFileSize = FileLoader(ROM, filename, MAX_ROM_SIZE);
+        totalFileSize = FileLoader(ROM, filename, MAX_ROM_SIZE, TRUE);
 
         if (!totalFileSize)
             return (FALSE);
@@ -1568,7 +1878,7 @@ bool8 CMemory::LoadMultiCartMem (const uint8 *sourceA, uint32 sourceASize,
                                  const uint8 *bios, uint32 biosSize)
 {
     uint32 offset = 0;
-    memset(ROM, 0, MAX_ROM_SIZE);
+    ClearROM();
 	memset(&Multi, 0, sizeof(Multi));
 
     if(bios) {
@@ -1602,7 +1912,7 @@ bool8 CMemory::LoadMultiCart (const char *cartA, const char *cartB)
 {
     S9xResetSaveTimer(FALSE); // reset oops timer here so that .oops file has rom name of previous rom
 
-    memset(ROM, 0, MAX_ROM_SIZE);
+    ClearROM();
 	memset(&Multi, 0, sizeof(Multi));
 
 	Settings.DisplayColor = BUILD_PIXEL(31, 31, 31);
@@ -1809,6 +2119,8 @@ bool8 CMemory::LoadSRTC (void)
 {
 	FILE	*fp;
 
+	S9xWaitForFileWrites();
+
 	fp = fopen(S9xGetFilename(".rtc", SRAM_DIR).c_str(), "rb");
 	if (!fp)
 		return (FALSE);
@@ -1822,19 +2134,9 @@ bool8 CMemory::LoadSRTC (void)
 
 bool8 CMemory::SaveSRTC (void)
 {
-	FILE	*fp;
+	std::vector<uint8>	data(RTCData.reg, RTCData.reg + 20);
 
-	fp = fopen(S9xGetFilename(".rtc", SRAM_DIR).c_str(), "wb");
-	if (!fp)
-		return (FALSE);
-
-	if (fwrite(RTCData.reg, 1, 20, fp) < 20)
-	{
-		printf ("Failed to save clock data.\n");
-	}
-	fclose(fp);
-
-	return (TRUE);
+	return (S9xQueueFileWrite(S9xGetFilename(".rtc", SRAM_DIR).c_str(), data, FALSE, NULL));
 }
 
 void CMemory::ClearSRAM (bool8 onlyNonSavedSRAM)
@@ -1844,6 +2146,34 @@ void CMemory::ClearSRAM (bool8 onlyNonSavedSRAM)
 			return;
 	// TODO: If SRAM size changes change this value as well
 	memset(SRAM, SNESGameFixes.SRAMInitialValue, 0x80000);
+	S9xMarkAllDirty();
+}
+
+// How much of the SRAM buffer the cartridge can reach, for snapshots.
+uint32 CMemory::SRAMInUse (void)
+{
+	// SA-1 and SuperFX address their RAM without SRAMMask, and the Seta DSPs
+	// keep their own data in it.
+	if (Settings.SA1 || Settings.SuperFX || Settings.SETA)
+		return (SRAM_SIZE);
+
+	uint32	size = SRAMMask ? SRAMMask + 1 : 0;
+
+	if (Settings.BS && size < 0x8000)
+		size = 0x8000;
+
+	if (Multi.cartType && Multi.sramB && Multi.sramMaskB)
+	{
+		uint32	end = (Multi.sramB - SRAM) + Multi.sramMaskB + 1;
+		if (size < end)
+			size = end;
+	}
+
+	// Never empty: older versions reject zero-length snapshot blocks.
+	if (size < 0x800)
+		size = 0x800;
+
+	return (size < SRAM_SIZE ? size : SRAM_SIZE);
 }
 
 bool8 CMemory::LoadSRAM (const char *filename)
@@ -1852,6 +2182,7 @@ bool8 CMemory::LoadSRAM (const char *filename)
 	int		size, len;
 
 	ClearSRAM();
+	S9xWaitForFileWrites();
 
 	if (Multi.cartType && Multi.sramSizeB)
 	{
@@ -1926,21 +2257,16 @@ bool8 CMemory::SaveSRAM (const char *filename)
 	if (Settings.SA1 && ROMType == 0x34)    // doesn't have SRAM
 		return (TRUE);
 
-	FILE	*file;
 	int		size;
 
+	// The SRAM is copied now and written out in the background.
 	if (Multi.cartType && Multi.sramSizeB)
 	{
 		std::string name = S9xGetFilename(Multi.fileNameB, ".srm", SRAM_DIR);
 		size = (1 << (Multi.sramSizeB + 3)) * 128;
 
-		file = fopen(name.c_str(), "wb");
-		if (file)
-		{
-			if (!fwrite((char *) Multi.sramB, size, 1, file))
-				printf ("Couldn't write to subcart SRAM file.\n");
-			fclose(file);
-		}
+		std::vector<uint8>	data(Multi.sramB, Multi.sramB + size);
+		S9xQueueFileWrite(name.c_str(), data, FALSE, NULL);
     }
 
     size = SRAMSize ? (1 << (SRAMSize + 3)) * 128 : 0;
@@ -1951,13 +2277,10 @@ bool8 CMemory::SaveSRAM (const char *filename)
 
 	if (size)
 	{
-		file = fopen(filename, "wb");
-		if (file)
-		{
-			if (!fwrite((char *) SRAM, size, 1, file))
-				printf ("Couldn't write to SRAM file.\n");
-			fclose(file);
+		std::vector<uint8>	data(SRAM, SRAM + size);
 
+		if (S9xQueueFileWrite(filename, data, FALSE, NULL))
+		{
 			if (Settings.SRTC || Settings.SPC7110RTC)
 				SaveSRTC();
 
@@ -2002,6 +2325,29 @@ static uint32 caCRC32 (uint8 *array, uint32 size, uint32 crc32)
 	return (~crc32);
 }
 
+// Both hashes in one pass, a cache-sized chunk at a time, so the image is
+// only read from memory once.
+static uint32 HashROM (uint8 *data, uint32 size, uint8 *sha256)
+{
+	const uint32	chunk = 0x10000;
+	uint32			crc32 = 0;
+	SHA256_CTX		ctx;
+
+	sha256_init(&ctx);
+
+	for (uint32 i = 0; i < size; i += chunk)
+	{
+		uint32	n = min(chunk, size - i);
+
+		crc32 = caCRC32(data + i, n, ~crc32);
+		sha256_update(&ctx, data + i, n);
+	}
+
+	sha256_final(&ctx, sha256);
+
+	return (crc32);
+}
+
 void CMemory::ParseSNESHeader (uint8 *RomHeader)
 {
 	bool8	bs = Settings.BS & !Settings.BSXItself;
@@ -2319,11 +2665,14 @@ void CMemory::InitROM (void)
 
 	//// Build more ROM information
 
-	// CRC32
+	// CRC32 and SHA-256
 	if (!Settings.BS || Settings.BSXItself) // Not BS Dump
 	{
-		ROMCRC32 = caCRC32(ROM, CalculatedSize);
-		sha256sum(ROM, CalculatedSize, ROMSHA256);
+		ROMCRC32 = HashROM(ROM, CalculatedSize, ROMSHA256);
+	#ifdef MMAP_ROM
+		if (Settings.ShareROM && !Multi.cartType)
+			ShareROMImage(ROM, CalculatedSize, ROMSHA256);
+	#endif
 	}
 	else // Convert to correct format before scan
 	{
@@ -2335,8 +2684,7 @@ void CMemory::InitROM (void)
 		ROM[offset + 22] = 0x42;
 		ROM[offset + 23] = 0x00;
 		// Calc
-		ROMCRC32 = caCRC32(ROM, CalculatedSize);
-		sha256sum(ROM, CalculatedSize, ROMSHA256);
+		ROMCRC32 = HashROM(ROM, CalculatedSize, ROMSHA256);
 		// Convert back
 		ROM[offset + 22] = BSMagic0;
 		ROM[offset + 23] = BSMagic1;
@@ -2708,6 +3056,33 @@ void CMemory::map_WriteProtectROM (void)
 		if (BlockIsROM[c])
 			WriteMap[c] = (uint8 *) MAP_NONE;
 	}
+
+	// SA-1, SuperFX and the Seta DSPs write their SRAM behind the CPU's back.
+	Dirty.SRAMTracked = !Settings.SA1 && !Settings.SuperFX && !Settings.SETA;
+
+	for (int c = 0; c < 0x1000; c++)
+	{
+		BlockDirty[c] = Dirty.Untracked;
+
+		if (WriteMap[c] < (uint8 *) MAP_LAST)
+			continue;
+
+		// WriteMap entries are biased by the block's offset within its bank.
+		uint32	base  = (c << MEMMAP_SHIFT) & 0xffff;
+		uint8	*p    = WriteMap[c] + base;
+		uint32	first = base >> DIRTY_PAGE_SHIFT;
+
+		if (p >= RAM && p + MEMMAP_BLOCK_SIZE <= RAM + sizeof(RAM) && !((p - RAM) & (DIRTY_PAGE_SIZE - 1)))
+			BlockDirty[c] = Dirty.RAM + ((p - RAM) >> DIRTY_PAGE_SHIFT) - first;
+		else
+		if (SRAM && p >= SRAM && p + MEMMAP_BLOCK_SIZE <= SRAM + SRAM_SIZE)
+		{
+			if ((p - SRAM) & (DIRTY_PAGE_SIZE - 1))
+				Dirty.SRAMTracked = FALSE;
+			else
+				BlockDirty[c] = Dirty.SRAM + ((p - SRAM) >> DIRTY_PAGE_SHIFT) - first;
+		}
+	}
 }
 
 void CMemory::Map_Initialize (void)
@@ -15,6 +15,7 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include "dirty.h"
 
 struct CMemory
 {
@@ -58,7 +59,7 @@ struct CMemory
 	int32	HeaderCount;
 
 	uint8	RAM[0x20000];
-	std::vector<uint8_t> ROMStorage;
+	uint8	*ROMStorage;
 	uint8   *ROM;
 	std::vector<uint8_t> SRAMStorage;
 	uint8	*SRAM;
@@ -73,8 +74,10 @@ struct CMemory
 
 	uint8	*Map[MEMMAP_NUM_BLOCKS];
 	uint8	*WriteMap[MEMMAP_NUM_BLOCKS];
+	uint32	*BlockDirty[MEMMAP_NUM_BLOCKS];
 	uint8	BlockIsRAM[MEMMAP_NUM_BLOCKS];
 	uint8	BlockIsROM[MEMMAP_NUM_BLOCKS];
+	uint8	BlockSpeed[MEMMAP_NUM_BLOCKS];
 	uint8	ExtendedFormat;
 
 	std::string ROMFilename;
@@ -107,8 +110,12 @@ struct CMemory
 	int		ScoreHiROM (bool8, int32 romoff = 0);
 	int		ScoreLoROM (bool8, int32 romoff = 0);
 	int		First512BytesCountZeroes() const;
+	void	DetectNSRTHeader (uint8 *);
 	uint32	HeaderRemove (uint32, uint8 *);
-	uint32	FileLoader (uint8 *, const char *, uint32);
+	void	SetROMBase (uint32);
+	void	ClearROM (void);
+	uint32	ReadROMFile (const char *, uint32);
+	uint32	FileLoader (uint8 *, const char *, uint32, bool8 direct = FALSE);
     bool8   LoadROMMem (const uint8 *, uint32, const char* optional_rom_filename = NULL);
 	bool8	LoadROM (const char *);
     bool8	LoadROMInt (int32);
@@ -121,6 +128,7 @@ struct CMemory
 	bool8	LoadSRAM (const char *);
 	bool8	SaveSRAM (const char *);
 	void	ClearSRAM (bool8 onlyNonSavedSRAM = 0);
+	uint32	SRAMInUse (void);
 	bool8	LoadSRTC (void);
 	bool8	SaveSRTC (void);
 	bool8	SaveMPAK (const char *);
@@ -17,6 +17,7 @@ STREAM dataStream = NULL;
 STREAM audioStream = NULL;
 uint32 audioLoopPos;
 size_t partial_frames;
+static int32 audioTrack = -1;	// track audioStream has open
 
 // Sample buffer
 static Resampler *msu_resampler = NULL;
@@ -103,6 +104,8 @@ static void AudioClose()
 		CLOSE_STREAM(audioStream);
 		audioStream = NULL;
 	}
+
+	audioTrack = -1;
 }
 
 static bool AudioOpen()
@@ -116,6 +119,8 @@ static bool AudioOpen()
     audioStream = S9xMSU1OpenFile(extension.c_str());
 	if (audioStream)
 	{
+		audioTrack = MSU1.MSU1_CURRENT_TRACK;
+
 		if (GETC_STREAM(audioStream) != 'M')
 			return false;
 		if (GETC_STREAM(audioStream) != 'S')
@@ -434,3 +439,39 @@ void S9xMSU1PostLoadState(void)
 
 	partial_frames = 0;
 }
+
+// Run-ahead and rollback restore a state from a few frames back on every
+// frame. The open files are kept, and they are only seeked if the restore
+// moved the position away from where 'before' left them. The output buffer
+// holds audio that is already playing, so it is left alone.
+void S9xMSU1PostHotLoadState(const struct SMSU1 &before)
+{
+	if (dataStream && MSU1.MSU1_DATA_POS != before.MSU1_DATA_POS)
+	{
+        REVERT_STREAM(dataStream, MSU1.MSU1_DATA_POS, 0);
+	}
+
+	if (audioStream && audioTrack == MSU1.MSU1_CURRENT_TRACK)
+	{
+		if (MSU1.MSU1_AUDIO_POS != before.MSU1_AUDIO_POS)
+		{
+            REVERT_STREAM(audioStream, MSU1.MSU1_AUDIO_POS, 0);
+		}
+	}
+	else
+	if (MSU1.MSU1_STATUS & AudioPlaying)
+	{
+		uint32 savedPosition = MSU1.MSU1_AUDIO_POS;
+
+		if (AudioOpen())
+		{
+			MSU1.MSU1_AUDIO_POS = savedPosition;
+            REVERT_STREAM(audioStream, MSU1.MSU1_AUDIO_POS, 0);
+		}
+		else
+		{
+			MSU1.MSU1_STATUS &= ~(AudioPlaying | AudioRepeating);
+			MSU1.MSU1_STATUS |= AudioError;
+		}
+	}
+}
@@ -40,6 +40,7 @@ enum SMSU1_CMD {
 };
 
 extern struct SMSU1	MSU1;
+extern size_t		partial_frames;	// phase of the 44.1kHz track against the 32kHz DSP output
 
 void S9xResetMSU(void);
 void S9xMSU1Init(void);
@@ -54,5 +55,6 @@ size_t S9xMSU1Samples(void);
 class Resampler;
 void S9xMSU1SetOutput(Resampler *resampler);
 void S9xMSU1PostLoadState(void);
+void S9xMSU1PostHotLoadState(const struct SMSU1 &);
 
 #endif
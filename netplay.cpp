@@ -48,10 +48,14 @@
 #include <semaphore.h>
 #endif
 
+#include <vector>
+
 #include "memmap.h"
 #include "netplay.h"
 #include "snapshot.h"
 #include "display.h"
+#include "cpuexec.h"
+#include "movie.h"
 
 void S9xNPClientLoop (void *);
 bool8 S9xNPLoadROM (uint32 len);
@@ -59,6 +63,7 @@ bool8 S9xNPLoadROMDialog (const char *);
 bool8 S9xNPGetROMImage (uint32 len);
 void S9xNPGetSRAMData (uint32 len);
 void S9xNPGetFreezeFile (uint32 len);
+static void S9xNPRollbackInput (int player, uint32 frame, uint32 joypad);
 
 unsigned long START = 0;
 
@@ -274,9 +279,29 @@ version of the protocol. Disconnecting.");
     NetPlay.Player = data [1];
     delete[] data;
 
+    NetPlay.Rollback = (header [2] & NP_SERV_HELLO_ROLLBACK) != 0;
+#ifdef __WIN32__
+    // The client thread here hands heartbeats to the emulation thread, which
+    // has no place for inputs that arrive out of step.
+    if (NetPlay.Rollback)
+    {
+        S9xNPSetError ("The Snes9x NetPlay server is in rollback mode,\n\
+which this version does not support. Disconnecting.");
+	S9xNPDisconnect ();
+        return (FALSE);
+    }
+#endif
+
     NetPlay.PendingWait4Sync = TRUE;
     Settings.NetPlay = TRUE;
     S9xNPResetJoypadReadPos ();
+    if (NetPlay.Rollback)
+    {
+        // Wait for the server to say who is playing.
+        NetPlay.Paused = TRUE;
+        NetPlay.RollbackPlayers = 0;
+        S9xNPRollbackReset ();
+    }
     NetPlay.ServerSequenceNum = 1;
 
 #ifdef NP_DEBUG
@@ -485,10 +510,14 @@ bool8 S9xNPWaitForHeartBeat ()
 		S9xReset ();
                 NetPlay.FrameCount = READ_LONG (&header [3]);
                 S9xNPResetJoypadReadPos ();
+                if (NetPlay.Rollback)
+                    S9xNPRollbackReset ();
                 S9xNPSendReady ();
                 break;
 	    case NP_SERV_PAUSE:
                 NetPlay.Paused = (header [2] & 0x20) != 0;
+                if (NetPlay.Rollback)
+                    NetPlay.RollbackPlayers = READ_LONG (&header [3]);
 				if (NetPlay.Paused)
 					S9xNPSetWarning("CLIENT: Server has paused.");
 				else
@@ -530,8 +559,23 @@ bool8 S9xNPWaitForHeartBeat ()
                 S9xNPDiscardHeartbeats ();
                 S9xNPGetFreezeFile (len - 7);
                 S9xNPResetJoypadReadPos ();
+                if (NetPlay.Rollback)
+                    S9xNPRollbackReset ();
                 S9xNPSendReady ();
                 break;
+            case NP_SERV_INPUT:
+            {
+                uint8 input [9];
+
+                if (len != 7 + 9 || !S9xNPGetData (NetPlay.Socket, input, 9))
+                {
+                    S9xNPSetError ("Error while receiving 'INPUT' message.");
+                    S9xNPDisconnect ();
+                    return (FALSE);
+                }
+                S9xNPRollbackInput (input [0], READ_LONG (&input [1]), READ_LONG (&input [5]));
+                break;
+            }
             default:
 #ifdef NP_DEBUG
                 printf ("CLIENT: UNKNOWN received @%ld\n", S9xGetMilliTime () - START);
@@ -539,6 +583,10 @@ bool8 S9xNPWaitForHeartBeat ()
                 S9xNPDisconnect ();
                 return (FALSE);
 	    }
+
+            // Rollback mode polls between frames and must not block.
+            if (NetPlay.Rollback)
+                return (TRUE);
 	}
     }
 
@@ -680,6 +728,7 @@ void S9xNPGetSRAMData (uint32 len)
         S9xNPSetError ("Error while receiving S-RAM data from server.");
         S9xNPDisconnect ();
     }
+    S9xMarkAllDirty ();
 	S9xNPSetAction ("", TRUE);
 }
 
@@ -831,6 +880,234 @@ bool8 S9xNPSendJoypadUpdate (uint32 joypad)
     return (TRUE);
 }
 
+/*
+ * Rollback mode. Every client runs on its own clock and guesses that the
+ * other players still hold whatever they last sent. Inputs are tagged with
+ * the frame they were used on and relayed by the server as soon as they
+ * arrive. When one turns out to differ from the guess, the client loads the
+ * state it saved before that frame and quietly emulates back to where it was.
+ * States are saved every frame, copying only the pages written since that
+ * slot was last used.
+ */
+
+struct SNPRollbackState
+{
+    std::vector<uint8> Data;
+    uint32 Since;
+};
+
+static struct SNPRollbackState RollbackStates [NP_ROLLBACK_FRAMES];
+static std::vector<struct SHotStateRange> RollbackRanges;
+static uint32 RollbackSecondStart = 0;
+static uint32 RollbackSecondFrames = 0;
+
+void S9xNPRollbackReset ()
+{
+    NetPlay.RollbackFrame = 0;
+    NetPlay.RollbackTo = 0;
+    NetPlay.FrameCount = 0;
+    memset ((void *) NetPlay.Confirmed, 0, sizeof (NetPlay.Confirmed));
+    memset ((void *) NetPlay.LastInput, 0, sizeof (NetPlay.LastInput));
+    memset ((void *) NetPlay.Inputs, 0, sizeof (NetPlay.Inputs));
+    memset ((void *) NetPlay.Used, 0, sizeof (NetPlay.Used));
+
+    for (int i = 0; i < NP_ROLLBACK_FRAMES; i++)
+        RollbackStates [i].Since = 0;
+}
+
+static void S9xNPRollbackInput (int player, uint32 frame, uint32 joypad)
+{
+    // Our own inputs come back too; they are already known.
+    if (player < 0 || player >= NP_MAX_CLIENTS || player == NetPlay.Player - 1 ||
+        frame != NetPlay.Confirmed [player])
+        return;
+
+    NetPlay.Inputs [frame % NP_ROLLBACK_INPUTS][player] = joypad;
+    NetPlay.LastInput [player] = joypad;
+    NetPlay.Confirmed [player] = frame + 1;
+
+    if (frame < NetPlay.RollbackTo &&
+        NetPlay.Used [frame % NP_ROLLBACK_FRAMES][player] != joypad)
+        NetPlay.RollbackTo = frame;
+}
+
+static uint32 S9xNPRollbackGuess (int player, uint32 frame)
+{
+    if (player == NetPlay.Player - 1 || frame < NetPlay.Confirmed [player])
+        return (NetPlay.Inputs [frame % NP_ROLLBACK_INPUTS][player]);
+
+    return (NetPlay.LastInput [player]);
+}
+
+static void S9xNPRollbackSetJoypads (uint32 frame)
+{
+    for (int p = 0; p < NP_MAX_CLIENTS; p++)
+    {
+        uint32 joypad = S9xNPRollbackGuess (p, frame);
+
+        NetPlay.Used [frame % NP_ROLLBACK_FRAMES][p] = joypad;
+        MovieSetJoypad (p, joypad);
+    }
+}
+
+static void S9xNPRollbackSave (uint32 frame)
+{
+    struct SNPRollbackState &state = RollbackStates [frame % NP_ROLLBACK_FRAMES];
+    uint32 size = S9xHotFreezeSize ();
+
+    if (state.Data.size () != size)
+    {
+        state.Data.resize (size);
+        state.Since = 0;
+    }
+
+    uint32 checkpoint = S9xDirtyCheckpoint ();
+    S9xHotFreezeGameDirty (state.Data.data (), size, state.Since, RollbackRanges);
+    state.Since = checkpoint;
+}
+
+static void S9xNPRollbackResimulate ()
+{
+    uint32 from = NetPlay.RollbackTo;
+    uint32 to = NetPlay.RollbackFrame;
+    struct SNPRollbackState &state = RollbackStates [from % NP_ROLLBACK_FRAMES];
+
+    S9xHotUnfreezeGameDirty (state.Data.data (), state.Data.size (), state.Since);
+
+    for (uint32 frame = from; frame < to; frame++)
+    {
+        // The state before the first frame is the one just loaded.
+        if (frame != from)
+            S9xNPRollbackSave (frame);
+        S9xNPRollbackSetJoypads (frame);
+        S9xMainLoopHidden ();
+    }
+
+    NetPlay.RollbackTo = to;
+    NetPlay.Stats.Rollbacks++;
+    NetPlay.Stats.LastDepth = to - from;
+    if (NetPlay.Stats.MaxDepth < to - from)
+        NetPlay.Stats.MaxDepth = to - from;
+    NetPlay.Stats.ResimulatedFrames += to - from;
+    RollbackSecondFrames += to - from;
+}
+
+static bool8 S9xNPSendInput (uint32 frame, uint32 joypad)
+{
+    uint8 data [7 + 8];
+    uint8 *ptr = data;
+
+    *ptr++ = NP_CLNT_MAGIC;
+    *ptr++ = NetPlay.MySequenceNum++;
+    *ptr++ = NP_CLNT_INPUT;
+    WRITE_LONG (ptr, 7 + 8);
+    ptr += 4;
+    WRITE_LONG (ptr, frame);
+    ptr += 4;
+    WRITE_LONG (ptr, joypad);
+
+    if (!S9xNPSendData (NetPlay.Socket, data, 7 + 8))
+    {
+        S9xNPSetError ("Error while sending input to server.");
+	S9xNPDisconnect ();
+	return (FALSE);
+    }
+    return (TRUE);
+}
+
+// Handles everything the server has sent, waiting up to time_msec for the
+// first message. Returns FALSE if the connection is gone.
+bool8 S9xNPRollbackPoll (uint32 time_msec)
+{
+    while (NetPlay.Connected && S9xNPCheckForHeartBeat (time_msec))
+    {
+        if (!S9xNPWaitForHeartBeat ())
+            return (FALSE);
+        time_msec = 0;
+    }
+
+    return (NetPlay.Connected);
+}
+
+// Called before each frame with the local player's input. Sets the joypads
+// for the frame and returns TRUE, or returns FALSE when the frame has to wait:
+// the game is paused, here or by the server, or the other players are too far
+// behind to roll back to. A frame that waits sends nothing and saves nothing.
+bool8 S9xNPRollbackFrame (uint32 joypad)
+{
+    if (!S9xNPRollbackPoll ())
+        return (FALSE);
+
+    uint32 frame = NetPlay.RollbackFrame;
+    uint32 oldest = frame;
+
+    for (int p = 0; p < NP_MAX_CLIENTS; p++)
+    {
+        if ((NetPlay.RollbackPlayers & (1 << p)) && p != NetPlay.Player - 1 &&
+            NetPlay.Confirmed [p] < oldest)
+            oldest = NetPlay.Confirmed [p];
+    }
+
+    bool8 paused = NetPlay.Paused || Settings.Paused;
+
+    if (paused || frame - oldest >= NP_ROLLBACK_FRAMES)
+    {
+        if (!paused)
+            NetPlay.Stats.Stalls++;
+        NetPlay.PendingWait4Sync = TRUE;
+        S9xNPRollbackPoll (5);
+        return (FALSE);
+    }
+    NetPlay.PendingWait4Sync = FALSE;
+
+    if (NetPlay.RollbackTo < frame)
+        S9xNPRollbackResimulate ();
+
+    uint32 now = S9xGetMilliTime ();
+    if (now - RollbackSecondStart >= 1000)
+    {
+        NetPlay.Stats.ResimulatedPerSecond = RollbackSecondFrames;
+        RollbackSecondFrames = 0;
+        RollbackSecondStart = now;
+    }
+
+    NetPlay.Inputs [frame % NP_ROLLBACK_INPUTS][NetPlay.Player - 1] = joypad;
+    if (!S9xNPSendInput (frame, joypad))
+        return (FALSE);
+
+    S9xNPRollbackSave (frame);
+    S9xNPRollbackSetJoypads (frame);
+
+    NetPlay.FrameCount = frame;
+    NetPlay.RollbackFrame = frame + 1;
+    NetPlay.RollbackTo = frame + 1;
+    return (TRUE);
+}
+
+// Waits, without emulating further, until the inputs for every frame emulated
+// so far are known and applied. Returns TRUE when they are, at which point
+// every client that got as far is in the same state.
+bool8 S9xNPRollbackSettle ()
+{
+    NetPlay.PendingWait4Sync = TRUE;
+
+    if (!S9xNPRollbackPoll (5))
+        return (FALSE);
+
+    for (int p = 0; p < NP_MAX_CLIENTS; p++)
+    {
+        // Players who already left may still have inputs on the way.
+        if (((NetPlay.RollbackPlayers & (1 << p)) || NetPlay.Confirmed [p]) &&
+            p != NetPlay.Player - 1 && NetPlay.Confirmed [p] < NetPlay.RollbackFrame)
+            return (FALSE);
+    }
+
+    if (NetPlay.RollbackTo < NetPlay.RollbackFrame)
+        S9xNPRollbackResimulate ();
+
+    return (TRUE);
+}
+
 void S9xNPDisconnect ()
 {
     close (NetPlay.Socket);
@@ -20,13 +20,27 @@
  * sequence_no  1
  * opcode       1 + num joypads (top 3 bits)
  * joypad data  4 * n
+ *
+ * In rollback mode there are no heartbeats. Each client tags its input with
+ * the frame it was used on, and the server relays it to everyone at once.
+ *
+ * Client to server input (NP_CLNT_INPUT)
+ * header       7 (length 15)
+ * frame        4
+ * joypad data  4
+ *
+ * Server to client input (NP_SERV_INPUT)
+ * header       7 (length 16)
+ * player       1 (0-based)
+ * frame        4
+ * joypad data  4
  */
 
 #ifdef _DEBUG
 #define NP_DEBUG 1
 #endif
 
-#define NP_VERSION 10
+#define NP_VERSION 11
 #define NP_JOYPAD_HIST_SIZE 120
 #define NP_DEFAULT_PORT 6096
 
@@ -47,6 +61,7 @@
 #define NP_CLNT_LOADED_ROM 9
 #define NP_CLNT_RECEIVED_ROM_IMAGE 10
 #define NP_CLNT_WAITING_FOR_ROM_IMAGE 11
+#define NP_CLNT_INPUT 12
 
 #define NP_SERV_HELLO 0
 #define NP_SERV_JOYPAD 1
@@ -59,6 +74,18 @@
 #define NP_SERV_READY 8
 // ...
 #define NP_SERV_JOYPAD_SWAP 12
+#define NP_SERV_INPUT 13
+
+// Set in the opcode of the server's HELLO reply when it runs in rollback mode.
+#define NP_SERV_HELLO_ROLLBACK 0x40
+
+// Rollback mode keeps a savestate for each of the last NP_ROLLBACK_FRAMES
+// frames, so a client can run that far ahead of the slowest confirmed input
+// before it has to wait. Inputs can arrive from clients that are ahead, so
+// twice as many frames of them are kept.
+#define NP_ROLLBACK_FRAMES 16
+#define NP_ROLLBACK_INPUTS (NP_ROLLBACK_FRAMES * 2)
+#define NP_RELAY_QUEUE_SIZE 1024
 
 struct SNPClient
 {
@@ -109,10 +136,22 @@ struct SNPServer
     uint32 Paused;
     bool8  SendROMImageOnConnect;
     bool8  SyncByReset;
+    bool8  Rollback;
+    uint32 RelayDelay;              // ms added to every relayed input, for testing
 };
 
 #define NP_MAX_ACTION_LEN 200
 
+struct SNPRollbackStats
+{
+    uint32 Rollbacks;               // late inputs that differed from the guess
+    uint32 LastDepth;               // frames re-emulated by the last rollback
+    uint32 MaxDepth;
+    uint32 ResimulatedFrames;
+    uint32 ResimulatedPerSecond;    // over the last full second
+    uint32 Stalls;                  // calls that waited for input instead
+};
+
 struct SNetPlay
 {
     volatile uint8  MySequenceNum;
@@ -145,6 +184,15 @@ struct SNetPlay
     char   ActionMsg [NP_MAX_ACTION_LEN];
     char   ErrorMsg [NP_MAX_ACTION_LEN];
     char   WarningMsg [NP_MAX_ACTION_LEN];
+    bool8  Rollback;
+    volatile uint32 RollbackPlayers;    // bit per client taking part
+    uint32 RollbackFrame;               // next frame to emulate
+    uint32 RollbackTo;                  // first frame run on a wrong guess
+    uint32 Confirmed [NP_MAX_CLIENTS];  // inputs are known before this frame
+    uint32 LastInput [NP_MAX_CLIENTS];
+    uint32 Inputs [NP_ROLLBACK_INPUTS][NP_MAX_CLIENTS];
+    uint32 Used [NP_ROLLBACK_FRAMES][NP_MAX_CLIENTS];
+    struct SNPRollbackStats Stats;
 };
 
 extern "C" struct SNetPlay NetPlay;
@@ -198,6 +246,11 @@ void S9xNPServerQueueSendingLoadROMRequest (const char *filename);
 
 void S9xNPServerAddTask (uint32 task, void *data);
 
+void S9xNPRollbackReset ();
+bool8 S9xNPRollbackPoll (uint32 time_msec = 0);
+bool8 S9xNPRollbackFrame (uint32 joypad);
+bool8 S9xNPRollbackSettle ();
+
 bool8 S9xNPStartServer (int port);
 void S9xNPStopServer ();
 void S9xNPSendJoypadSwap ();
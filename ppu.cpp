@@ -251,6 +251,10 @@ void S9xSetPPU (uint8 Byte, uint16 Address)
 	else
 	if (Address <= 0x2183)
 	{
+		// The renderer thread reads VRAM in place (OAM: see REGISTER_2104).
+		if (Address == 0x2118 || Address == 0x2119)
+			S9xWaitForRenderer();
+
 		switch (Address)
 		{
 			case 0x2100: // INIDISP
@@ -262,8 +266,14 @@ void S9xSetPPU (uint8 Byte, uint16 Address)
 					{
 						IPPU.ColorsChanged = TRUE;
 						PPU.Brightness = Byte & 0xf;
-						S9xFixColourBrightness();
-						S9xBuildDirectColourMaps();
+						if (IPPU.RenderThisFrame)
+						{
+							S9xWaitForRenderer(); // DirectColourMaps
+							S9xFixColourBrightness();
+							S9xBuildDirectColourMaps();
+						}
+						else
+							IPPU.BrightnessChanged = TRUE; // rebuilt when a frame is next drawn
 						if (PPU.Brightness > IPPU.MaxBrightness)
 							IPPU.MaxBrightness = PPU.Brightness;
 					}
@@ -1548,6 +1558,7 @@ void S9xSetCPU (uint8 Byte, uint16 Address)
 					}
 					else
 						CPU.FastROMSpeed = SLOW_ONE_CYCLE;
+					S9xUpdateBlockSpeed();
 					// we might currently be in FastROMSpeed region, S9xSetPCBase will update CPU.MemSpeed
 					S9xSetPCBase(Registers.PBPC);
 				}
@@ -1735,18 +1746,38 @@ void S9xResetPPU (void)
 	PPU.M7byte = 0;
 }
 
-void S9xResetPPUFast (void)
+// Pass flush_tiles = FALSE only if every VRAM line that changed has been
+// stamped in IPPU.VRAMLineGen.
+void S9xResetPPUFast (bool8 flush_tiles)
 {
 	PPU.RecomputeClipWindows = TRUE;
 	IPPU.ColorsChanged = TRUE;
 	IPPU.OBJChanged = TRUE;
-	memset(IPPU.TileCached[TILE_2BIT], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT], 0, MAX_4BIT_TILES);
-	memset(IPPU.TileCached[TILE_8BIT], 0, MAX_8BIT_TILES);
-	memset(IPPU.TileCached[TILE_2BIT_EVEN], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_2BIT_ODD], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT_EVEN], 0, MAX_4BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT_ODD], 0, MAX_4BIT_TILES);
+	if (flush_tiles)
+		S9xFlushTileCache();
+}
+
+// The tile cache is validated by generation rather than cleared.
+// Every VRAM write stamps its 16-byte line with the current generation, and
+// a cached tile is good while it is at least as new as the lines it was built
+// from and as the last flush. Flushing is therefore O(1), except on the rare
+// wrap of the counter.
+void S9xFlushTileCache (void)
+{
+	if (IPPU.TileGen >= 0xfffffff0)
+	{
+		memset(IPPU.VRAMLineGen, 0, sizeof(IPPU.VRAMLineGen));
+		memset(IPPU.TileCachedGen[TILE_2BIT], 0, MAX_2BIT_TILES * sizeof(uint32));
+		memset(IPPU.TileCachedGen[TILE_4BIT], 0, MAX_4BIT_TILES * sizeof(uint32));
+		memset(IPPU.TileCachedGen[TILE_8BIT], 0, MAX_8BIT_TILES * sizeof(uint32));
+		memset(IPPU.TileCachedGen[TILE_2BIT_EVEN], 0, MAX_2BIT_TILES * sizeof(uint32));
+		memset(IPPU.TileCachedGen[TILE_2BIT_ODD], 0, MAX_2BIT_TILES * sizeof(uint32));
+		memset(IPPU.TileCachedGen[TILE_4BIT_EVEN], 0, MAX_4BIT_TILES * sizeof(uint32));
+		memset(IPPU.TileCachedGen[TILE_4BIT_ODD], 0, MAX_4BIT_TILES * sizeof(uint32));
+		IPPU.TileGen = 0;
+	}
+
+	IPPU.TileFlushGen = ++IPPU.TileGen;
 }
 
 void S9xSoftResetPPU (void)
@@ -1885,14 +1916,9 @@ void S9xSoftResetPPU (void)
 	for (int c = 0; c < 2; c++)
 		memset(&IPPU.Clip[c], 0, sizeof(struct ClipData));
 	IPPU.ColorsChanged = TRUE;
+	IPPU.BrightnessChanged = FALSE;
 	IPPU.OBJChanged = TRUE;
-	memset(IPPU.TileCached[TILE_2BIT], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT], 0, MAX_4BIT_TILES);
-	memset(IPPU.TileCached[TILE_8BIT], 0, MAX_8BIT_TILES);
-	memset(IPPU.TileCached[TILE_2BIT_EVEN], 0, MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_2BIT_ODD], 0,  MAX_2BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT_EVEN], 0, MAX_4BIT_TILES);
-	memset(IPPU.TileCached[TILE_4BIT_ODD], 0,  MAX_4BIT_TILES);
+	S9xFlushTileCache();
 	PPU.VRAMReadBuffer = 0; // XXX: FIXME: anything better?
 	GFX.DoInterlace = 0;
 	IPPU.Interlace = FALSE;
@@ -1901,11 +1927,13 @@ void S9xSoftResetPPU (void)
 	IPPU.DoubleHeightPixels = FALSE;
 	IPPU.CurrentLine = 0;
 	IPPU.PreviousLine = 0;
+	IPPU.DrawnLine = 0;
 	IPPU.XB = NULL;
 	for (int c = 0; c < 256; c++)
 		IPPU.ScreenColors[c] = c;
 	IPPU.MaxBrightness = 0;
 	IPPU.RenderThisFrame = TRUE;
+	IPPU.HiddenFrame = FALSE;
 	IPPU.RenderedScreenWidth = SNES_WIDTH;
 	IPPU.RenderedScreenHeight = SNES_HEIGHT;
 	IPPU.FrameCount = 0;
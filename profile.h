@@ -0,0 +1,106 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <chrono>
+
+// Wall-clock time spent in the main subsystems, for benchmarking.
+// Sections nest: MAINLOOP includes everything else that runs during a frame.
+// Collection is off unless a frontend sets Profiler.Enabled.
+
+enum
+{
+	PROFILE_MAINLOOP,
+	PROFILE_RENDERLINE,
+	PROFILE_UPDATESCREEN,
+	PROFILE_APU,
+	PROFILE_SUPERFX,
+	PROFILE_SA1,
+	PROFILE_SPC7110,
+	PROFILE_DSP,
+	PROFILE_RUNAHEAD_SAVE,
+	PROFILE_RUNAHEAD_LOAD,
+	PROFILE_NUM_SECTIONS
+};
+
+struct SProfiler
+{
+	bool8	Enabled;
+	uint64	Nanoseconds[PROFILE_NUM_SECTIONS];
+	uint64	Calls[PROFILE_NUM_SECTIONS];
+};
+
+extern struct SProfiler	Profiler;
+
+// What the last run-ahead frame cost. Kept whenever run-ahead is active, so
+// any frontend can show it; Frames is 0 when the last frame ran normally.
+// DisplayFrameRate() puts it on screen next to the frame rate.
+
+struct SRunAheadStats
+{
+	uint32	Frames;				// frames emulated ahead of the saved state
+	uint32	FrameMicroseconds;	// the real frame, as it would cost without run-ahead
+	uint32	SaveMicroseconds;
+	uint32	LoadMicroseconds;
+	uint32	TotalMicroseconds;	// the whole S9xMainLoop() call, less frame pacing
+};
+
+extern struct SRunAheadStats	RunAheadStats;
+
+class S9xProfileScope
+{
+	public:
+		inline S9xProfileScope (int s) : section(-1)
+		{
+			if (Profiler.Enabled)
+			{
+				section = s;
+				start = std::chrono::steady_clock::now();
+			}
+		}
+
+		inline ~S9xProfileScope (void)
+		{
+			if (section >= 0)
+			{
+				Profiler.Nanoseconds[section] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+				Profiler.Calls[section]++;
+			}
+		}
+
+	private:
+		int										section;
+		std::chrono::steady_clock::time_point	start;
+};
+
+static inline void S9xResetProfiler (void)
+{
+	for (int i = 0; i < PROFILE_NUM_SECTIONS; i++)
+		Profiler.Nanoseconds[i] = Profiler.Calls[i] = 0;
+}
+
+static inline const char * S9xProfileSectionName (int section)
+{
+	static const char	*names[PROFILE_NUM_SECTIONS] =
+	{
+		"main_loop",
+		"render_line",
+		"update_screen",
+		"apu_execute",
+		"superfx_exec",
+		"sa1_main_loop",
+		"spc7110",
+		"dsp",
+		"runahead_save",
+		"runahead_load"
+	};
+
+	return (names[section]);
+}
+
+#endif
@@ -226,6 +226,7 @@ bool EmuConfig::setDefaults(int section)
         restart_set(display_device_index, 0);
         enable_vsync = true;
         bilinear_filter = true;
+        threaded_renderer = false;
         reduce_input_lag = true;
         adjust_for_vrr = false;
         restart_set(use_shader, false);
@@ -270,6 +271,7 @@ bool EmuConfig::setDefaults(int section)
         speed_sync_method = eTimer;
         fixed_frame_rate = 0.0;
         fast_forward_skip_frames = 9;
+        run_ahead_frames = 0;
 
         rewind_buffer_size = 0;
         rewind_frame_interval = 5;
@@ -447,6 +449,7 @@ void EmuConfig::config(std::string filename, bool write)
     Bool("VSync", enable_vsync);
     Bool("ReduceInputLag", reduce_input_lag);
     Bool("BilinearFilter", bilinear_filter);
+    Bool("ThreadedRenderer", threaded_renderer);
     Bool("AdjustForVRR", adjust_for_vrr);
     Bool("UseShader", use_shader);
     String("Shader", shader);
@@ -483,6 +486,7 @@ void EmuConfig::config(std::string filename, bool write)
     Enum("SpeedSyncMethod", speed_sync_method, { "Timer", "TimerFrameskip", "SoundSync", "Unlimited" });
     Double("FixedFrameRate", fixed_frame_rate);
     Int("FastForwardSkipFrames", fast_forward_skip_frames);
+    Int("RunAheadFrames", run_ahead_frames);
     Int("RewindBufferSize", rewind_buffer_size);
     Int("RewindFrameInterval", rewind_frame_interval);
     Bool("AllowInvalidVRAMAccess", allow_invalid_vram_access);
@@ -52,6 +52,7 @@ struct EmuConfig
     int display_device_index;
     bool enable_vsync;
     bool bilinear_filter;
+    bool threaded_renderer;
     bool reduce_input_lag;
     bool adjust_for_vrr;
     bool use_shader;
@@ -108,6 +109,7 @@ struct EmuConfig
     int speed_sync_method;
     double fixed_frame_rate;
     int fast_forward_skip_frames;
+    int run_ahead_frames;
 
     int rewind_buffer_size;
     int rewind_frame_interval;
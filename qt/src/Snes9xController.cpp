@@ -143,6 +143,8 @@ void Snes9xController::updateSettings(const EmuConfig * const config)
 
     Settings.DisplayIndicators = config->show_indicators;
 
+    Settings.ThreadedRenderer = config->threaded_renderer;
+
     if (Settings.SoundPlaybackRate != config->playback_rate || Settings.SoundInputRate != config->input_rate)
     {
         Settings.SoundInputRate = config->input_rate;
@@ -162,6 +164,8 @@ void Snes9xController::updateSettings(const EmuConfig * const config)
 
     Settings.SuperFXClockMultiplier  = config->superfx_clock_multiplier;
 
+    Settings.RunAhead = S9xClampRunAhead(config->run_ahead_frames);
+
     if (rewind_buffer_size != config->rewind_buffer_size && active)
     {
         g_state_manager.init(config->rewind_buffer_size * 1048576);
@@ -6,6 +6,7 @@
 
 #include "snes9x.h"
 #include "memmap.h"
+#include "profile.h"
 
 #define CPU								SA1
 #define ICPU							SA1
@@ -59,6 +60,8 @@ static void S9xSA1UpdateTimer (void);
 
 void S9xSA1MainLoop (void)
 {
+	S9xProfileScope	profile(PROFILE_SA1);
+
 	if (Memory.FillRAM[0x2200] & 0x60)
 	{
 		SA1.Cycles += 6; // FIXME
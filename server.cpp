@@ -74,6 +74,9 @@ void S9xNPSyncClient (int);
 void S9xNPSendROMLoadRequest (const char *filename);
 void S9xNPSendFreezeFileToAllClients (const char *filename);
 void S9xNPStopServer ();
+static void S9xNPRelayInput (int c, const uint8 *input);
+static void S9xNPFlushRelayQueue (bool8 all);
+static void S9xNPSendRollbackPause (bool8 force);
 
 void S9xNPShutdownClient (int c, bool8 report_error = FALSE)
 {
@@ -364,11 +367,13 @@ void S9xNPProcessClient (int c)
             *ptr++ = NP_SERV_MAGIC;
             *ptr++ = NPServer.Clients [c].SendSequenceNum++;
 
+            *ptr = NP_SERV_HELLO;
             if (NPServer.SendROMImageOnConnect &&
                 NPServer.NumClients > NP_ONE_CLIENT)
-                *ptr++ = NP_SERV_HELLO | 0x80;
-            else
-                *ptr++ = NP_SERV_HELLO;
+                *ptr |= 0x80;
+            if (NPServer.Rollback)
+                *ptr |= NP_SERV_HELLO_ROLLBACK;
+            ptr++;
             WRITE_LONG (ptr, len);
             ptr += 4;
             *ptr++ = NP_VERSION;
@@ -491,6 +496,23 @@ void S9xNPProcessClient (int c)
         case NP_CLNT_JOYPAD:
             NPServer.Joypads [c] = len;
             break;
+        case NP_CLNT_INPUT:
+        {
+            uint8 input [8];
+
+            if (len != 7 + 8 || !S9xNPSGetData (NPServer.Clients [c].Socket, input, 8))
+            {
+                S9xNPSetWarning ("SERVER: Failed to get INPUT message content from client.");
+                S9xNPShutdownClient (c, TRUE);
+                return;
+            }
+            // Relayed even while paused: a client may have run frames before
+            // the pause reached it, and the others need every one of those
+            // inputs, in order, to go on after it.
+            if (NPServer.Rollback)
+                S9xNPRelayInput (c, input);
+            break;
+        }
         case NP_CLNT_PAUSE:
 #ifdef NP_DEBUG
             printf ("SERVER: Client %d Paused: %s @%ld\n", c, (header [2] & 0x80) ? "YES" : "NO", S9xGetMilliTime () - START);
@@ -623,6 +645,7 @@ static bool8 S9xNPServerInit (int port)
 
     NPServer.NumClients = 0;
     NPServer.FrameCount = 0;
+    S9xNPFlushRelayQueue (TRUE);
 
 #ifdef NP_DEBUG
     printf ("SERVER: Creating socket @%ld\n", S9xGetMilliTime () - START);
@@ -676,10 +699,106 @@ void S9xNPSendServerPause (bool8 paused)
     *ptr++ = NP_SERV_MAGIC;
     *ptr++ = 0;
     *ptr++ = NP_SERV_PAUSE | (paused ? 0x20 : 0);
-    WRITE_LONG (ptr, NPServer.FrameCount);
+    if (NPServer.Rollback)
+    {
+        // Rollback clients need to know whose input to wait for.
+        uint32 players = 0;
+        for (int c = 0; c < NP_MAX_CLIENTS; c++)
+        {
+            if (NPServer.Clients [c].SaidHello)
+                players |= 1 << c;
+        }
+        WRITE_LONG (ptr, players);
+    }
+    else
+        WRITE_LONG (ptr, NPServer.FrameCount);
     S9xNPSendToAllClients (pause, 7);
 }
 
+/*
+ * Rollback mode. Clients keep their own time, so the server sends no
+ * heartbeats; it relays each input to everyone as it arrives, optionally held
+ * back by NPServer.RelayDelay to test with latency on a local connection.
+ */
+
+struct SNPRelayedInput
+{
+    uint32 Due;
+    uint8  Data [7 + 9];
+};
+
+static struct SNPRelayedInput RelayQueue [NP_RELAY_QUEUE_SIZE];
+static int RelayHead = 0;
+static int RelayTail = 0;
+static int RollbackSentPaused = -1;
+static uint32 RollbackSentPlayers = 0;
+
+static void S9xNPRelayInput (int c, const uint8 *input)
+{
+    uint8 data [7 + 9];
+    uint8 *ptr = data;
+
+    *ptr++ = NP_SERV_MAGIC;
+    *ptr++ = 0;
+    *ptr++ = NP_SERV_INPUT;
+    WRITE_LONG (ptr, 7 + 9);
+    ptr += 4;
+    *ptr++ = c;
+    memcpy (ptr, input, 8);
+
+    if (!NPServer.RelayDelay)
+    {
+        S9xNPSendToAllClients (data, 7 + 9);
+        return;
+    }
+
+    if ((RelayTail + 1) % NP_RELAY_QUEUE_SIZE == RelayHead)
+    {
+        S9xNPSendToAllClients (RelayQueue [RelayHead].Data, 7 + 9);
+        RelayHead = (RelayHead + 1) % NP_RELAY_QUEUE_SIZE;
+    }
+
+    RelayQueue [RelayTail].Due = S9xGetMilliTime () + NPServer.RelayDelay;
+    memcpy (RelayQueue [RelayTail].Data, data, 7 + 9);
+    RelayTail = (RelayTail + 1) % NP_RELAY_QUEUE_SIZE;
+}
+
+static void S9xNPFlushRelayQueue (bool8 all)
+{
+    uint32 now = S9xGetMilliTime ();
+
+    while (RelayHead != RelayTail &&
+           (all || (int32) (now - RelayQueue [RelayHead].Due) >= 0))
+    {
+        S9xNPSendToAllClients (RelayQueue [RelayHead].Data, 7 + 9);
+        RelayHead = (RelayHead + 1) % NP_RELAY_QUEUE_SIZE;
+    }
+}
+
+// Sends the pause state and who is playing when either has changed. 'force'
+// pauses everyone whatever NPServer.Paused says, to park the emulation.
+static void S9xNPSendRollbackPause (bool8 force)
+{
+    bool8 paused = force || NPServer.Paused;
+    uint32 players = 0;
+
+    for (int c = 0; c < NP_MAX_CLIENTS; c++)
+    {
+        if (NPServer.Clients [c].SaidHello)
+            players |= 1 << c;
+    }
+
+    if ((int) paused == RollbackSentPaused && players == RollbackSentPlayers)
+        return;
+
+    // Everything relayed so far has to reach the clients before the pause.
+    S9xNPFlushRelayQueue (TRUE);
+
+    RollbackSentPaused = paused;
+    RollbackSentPlayers = players;
+    S9xNPSendServerPause (paused);
+}
+
 void S9xNPSendJoypadSwap()
 {
 #ifdef NP_DEBUG
@@ -719,6 +838,12 @@ void S9xNPServerLoop (void *)
         Sleep (0);
 #endif
 
+        if (NPServer.Rollback)
+        {
+            S9xNPFlushRelayQueue (FALSE);
+            S9xNPSendRollbackPause (FALSE);
+        }
+        else
         if (success && !(Settings.Paused && !Settings.FrameAdvance) && !Settings.StopEmulation &&
             !Settings.ForcedPause && !NPServer.Paused)
         {
@@ -773,34 +898,38 @@ void S9xNPServerLoop (void *)
 #ifdef __WIN32__
         success = WaitForSingleObject (GUI.ServerTimerSemaphore, 200) == WAIT_OBJECT_0;
 #else
-        while (gettimeofday (&now, NULL) < 0) ;
-
-        /* If there is no known "next" frame, initialize it now */
-        if (next1.tv_sec == 0) { next1 = now; ++next1.tv_usec; }
-
-	success=FALSE;
-
-	if (timercmp(&next1, &now, >))
+        // Rollback mode is paced by the select above.
+        if (!NPServer.Rollback)
         {
-            /* If we're ahead of time, sleep a while */
-            unsigned timeleft =
-                (next1.tv_sec - now.tv_sec) * 1000000
-                + next1.tv_usec - now.tv_usec;
-	    usleep(timeleft<(200*1000)?timeleft:(200*1000));
-        }
+            while (gettimeofday (&now, NULL) < 0) ;
 
-        if (!timercmp(&next1, &now, >))
-        {
+            /* If there is no known "next" frame, initialize it now */
+            if (next1.tv_sec == 0) { next1 = now; ++next1.tv_usec; }
+
+	    success=FALSE;
 
-            /* Calculate the timestamp of the next frame. */
-            next1.tv_usec += Settings.FrameTime;
-            if (next1.tv_usec >= 1000000)
+	    if (timercmp(&next1, &now, >))
             {
-                next1.tv_sec += next1.tv_usec / 1000000;
-                next1.tv_usec %= 1000000;
+                /* If we're ahead of time, sleep a while */
+                unsigned timeleft =
+                    (next1.tv_sec - now.tv_sec) * 1000000
+                    + next1.tv_usec - now.tv_usec;
+		usleep(timeleft<(200*1000)?timeleft:(200*1000));
             }
-            success=TRUE;
-         }
+
+            if (!timercmp(&next1, &now, >))
+            {
+
+                /* Calculate the timestamp of the next frame. */
+                next1.tv_usec += Settings.FrameTime;
+                if (next1.tv_usec >= 1000000)
+                {
+                    next1.tv_sec += next1.tv_usec / 1000000;
+                    next1.tv_usec %= 1000000;
+                }
+                success=TRUE;
+             }
+        }
 #endif
 
         while (NPServer.TaskHead != NPServer.TaskTail)
@@ -891,6 +1020,8 @@ bool8 S9xNPStartServer (int port)
 #endif
 
     server_continue = TRUE;
+    RollbackSentPaused = -1;
+    RollbackSentPlayers = 0;
     if (S9xNPServerInit (port))
 #ifdef __WIN32__
         return (_beginthread (S9xNPServerLoop, 0, &p) != (uintptr_t)(~0));
@@ -996,6 +1127,11 @@ void S9xNPSyncClient (int client)
     char fname [L_tmpnam];
 #endif
 
+    // Rollback mode restarts every client's frame count, so all of them
+    // have to load the state.
+    if (NPServer.Rollback)
+        client = -1;
+
     S9xNPWaitForEmulationToComplete ();
 
     S9xNPSetAction ("SERVER: Freezing game...", TRUE);
@@ -1008,6 +1144,7 @@ void S9xNPSyncClient (int client)
         uint8 *data;
         uint32 len;
 
+        S9xWaitForFileWrites ();
         S9xNPSetAction ("SERVER: Loading freeze file...", TRUE);
         if (S9xNPLoadFreezeFile (fname, data, len))
         {
@@ -1232,6 +1369,10 @@ void S9xNPWaitForEmulationToComplete ()
     printf ("SERVER: WaitForEmulationToComplete start @%ld\n", S9xGetMilliTime () - START);
 #endif
 
+    // Without heartbeats nothing else would stop the local client.
+    if (NPServer.Rollback)
+        S9xNPSendRollbackPause (TRUE);
+
     while (!NetPlay.PendingWait4Sync && NetPlay.Connected &&
            !Settings.ForcedPause && !Settings.StopEmulation &&
            !(Settings.Paused && !Settings.FrameAdvance))
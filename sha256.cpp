@@ -16,6 +16,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "sha256.h"
 
 /****************************** MACROS ******************************/
 #define ROTLEFT(a,b) (((a) << (b)) | ((a) >> (32-(b))))
@@ -33,13 +34,6 @@
 typedef unsigned char BYTE;             /* 8-bit byte */
 typedef unsigned int  WORD;             /* 32-bit word, change to "long" for 16-bit machines */
 
-typedef struct {
-	BYTE data[64];
-	WORD datalen;
-	uint64_t bitlen;
-	WORD state[8];
-} SHA256_CTX;
-
 /**************************** VARIABLES *****************************/
 static const WORD k[64] = {
 	0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
@@ -110,9 +104,17 @@ void sha256_init(SHA256_CTX *ctx)
 
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len)
 {
-	WORD i;
+	size_t i = 0;
+
+	/* Whole blocks are transformed in place once the buffer is empty. */
+	if (ctx->datalen == 0) {
+		for (; i + 64 <= len; i += 64) {
+			sha256_transform(ctx, data + i);
+			ctx->bitlen += 512;
+		}
+	}
 
-	for (i = 0; i < len; ++i) {
+	for (; i < len; ++i) {
 		ctx->data[ctx->datalen] = data[i];
 		ctx->datalen++;
 		if (ctx->datalen == 64) {
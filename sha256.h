@@ -1,6 +1,20 @@
 #ifndef __SHA256_H
 #define __SHA256_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+	unsigned char data[64];
+	unsigned int datalen;
+	uint64_t bitlen;
+	unsigned int state[8];
+} SHA256_CTX;
+
+void sha256_init (SHA256_CTX *ctx);
+void sha256_update (SHA256_CTX *ctx, const unsigned char data[], size_t len);
+void sha256_final (SHA256_CTX *ctx, unsigned char hash[]);
+
 void sha256sum (unsigned char *data, unsigned int length, unsigned char *hash);
 
 #endif
@@ -5,6 +5,13 @@
 \*****************************************************************************/
 
 #include <assert.h>
+#include <deque>
+#include <string>
+#include <utility>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "snes9x.h"
 #include "memmap.h"
 #include "dma.h"
@@ -1032,29 +1039,222 @@ bool8 S9xFreezeGameMem (uint8 *buf, uint32 bufSize)
 	return (TRUE);
 }
 
-bool8 S9xFreezeGame (const char *filename)
+// Savestates and SRAM are written out by a worker thread, so that a slow or
+// network drive doesn't stall emulation. The data is copied when the write is
+// queued. Each file is written under a temporary name and renamed over the old
+// one when complete, so a failed write leaves the old file alone. Results go
+// back to the emulation thread, which reports them through S9xMessage() from
+// S9xReportFileWrites(). The worker never calls into the frontend.
+
+struct SFileWrite
 {
-	STREAM	stream = NULL;
+	std::string			filename;
+	std::vector<uint8>	data;
+	bool8				snapshot;	// a STREAM, compressed if the core is built with zlib
+	std::string			message;	// reported on success, if not empty
+	bool8				result;
+};
 
-	if (S9xOpenSnapshotFile(filename, FALSE, &stream))
+static struct
+{
+	std::deque<struct SFileWrite>	queue;
+	std::deque<struct SFileWrite>	done;
+	std::thread					thread;
+	std::mutex					mutex;
+	std::condition_variable		cond;
+	bool8						running;
+	bool8						quit;
+	bool8						busy;
+	std::atomic<int>			done_count;
+} FileWriter;
+
+static bool8 WriteFileNow (struct SFileWrite &w)
+{
+	std::string	temp = w.filename + ".tmp";
+	bool8		ok = FALSE;
+
+	if (w.snapshot)
 	{
-		S9xFreezeToStream(stream);
-		S9xCloseSnapshotFile(stream);
+		// Same as the frontends' S9xOpenSnapshotFile(), which may not be
+		// called from this thread.
+		STREAM	stream = OPEN_STREAM(temp.c_str(), "wb");
 
-		S9xResetSaveTimer(TRUE);
+		if (stream)
+		{
+			ok = stream->write(w.data.data(), w.data.size()) == w.data.size();
+			CLOSE_STREAM(stream);
+		}
+	}
+	else
+	{
+		FILE	*fp = fopen(temp.c_str(), "wb");
 
-		auto base = S9xBasename(filename);
-		if (S9xMovieActive())
-			sprintf(String, MOVIE_INFO_SNAPSHOT " %s", base.c_str());
-		else
-			sprintf(String, SAVE_INFO_SNAPSHOT " %s", base.c_str());
+		if (fp)
+		{
+			ok = fwrite(w.data.data(), 1, w.data.size(), fp) == w.data.size();
+			ok = (fclose(fp) == 0) && ok;
+		}
+	}
 
-		S9xMessage(S9X_INFO, S9X_FREEZE_FILE_INFO, String);
+#ifdef _WIN32
+	// rename() doesn't replace an existing file here.
+	if (ok)
+		remove(w.filename.c_str());
+#endif
 
-		return (TRUE);
+	if (ok && rename(temp.c_str(), w.filename.c_str()) != 0)
+		ok = FALSE;
+
+	if (!ok)
+		remove(temp.c_str());
+
+	return (ok);
+}
+
+static void FileWriterThreadEntry (void)
+{
+	std::unique_lock<std::mutex>	lock(FileWriter.mutex);
+
+	for (;;)
+	{
+		while (FileWriter.queue.empty() && !FileWriter.quit)
+			FileWriter.cond.wait(lock);
+
+		if (FileWriter.queue.empty())
+			break;
+
+		struct SFileWrite	w = std::move(FileWriter.queue.front());
+		FileWriter.queue.pop_front();
+		FileWriter.busy = TRUE;
+
+		lock.unlock();
+		w.result = WriteFileNow(w);
+		w.data.clear();
+		w.data.shrink_to_fit();
+		lock.lock();
+
+		FileWriter.done.push_back(std::move(w));
+		FileWriter.done_count++;
+		FileWriter.busy = FALSE;
+		FileWriter.cond.notify_all();
 	}
+}
 
-	return (FALSE);
+static void StopFileWriter (void)
+{
+	if (!FileWriter.running)
+		return;
+
+	// Whatever is still queued gets written before the thread ends.
+	{
+		std::lock_guard<std::mutex>	lock(FileWriter.mutex);
+		FileWriter.quit = TRUE;
+		FileWriter.cond.notify_all();
+	}
+
+	FileWriter.thread.join();
+	FileWriter.running = FALSE;
+
+	S9xReportFileWrites();
+}
+
+static void StartFileWriter (void)
+{
+	if (FileWriter.running)
+		return;
+
+	FileWriter.quit = FALSE;
+	FileWriter.busy = FALSE;
+	FileWriter.thread = std::thread(FileWriterThreadEntry);
+	FileWriter.running = TRUE;
+
+	// Frontends exit() from all sorts of places; don't lose a save on the way.
+	static bool8	registered = FALSE;
+	if (!registered)
+	{
+		atexit(StopFileWriter);
+		registered = TRUE;
+	}
+}
+
+// Takes over the contents of data. The write is queued and reports its own
+// failure later, so this always returns TRUE.
+bool8 S9xQueueFileWrite (const char *filename, std::vector<uint8> &data, bool8 snapshot, const char *message)
+{
+	struct SFileWrite	w;
+
+	w.filename = filename;
+	w.data.swap(data);
+	w.snapshot = snapshot;
+	w.message = message ? message : "";
+	w.result = FALSE;
+
+	StartFileWriter();
+
+	std::lock_guard<std::mutex>	lock(FileWriter.mutex);
+	FileWriter.queue.push_back(std::move(w));
+	FileWriter.cond.notify_all();
+
+	return (TRUE);
+}
+
+// Blocks until every queued write has reached the disk. Call before reading
+// back a file that may have been saved.
+void S9xWaitForFileWrites (void)
+{
+	if (!FileWriter.running)
+		return;
+
+	std::unique_lock<std::mutex>	lock(FileWriter.mutex);
+	while (!FileWriter.queue.empty() || FileWriter.busy)
+		FileWriter.cond.wait(lock);
+}
+
+// Reports the writes finished since the last call. Called once a frame.
+void S9xReportFileWrites (void)
+{
+	std::deque<struct SFileWrite>	done;
+
+	if (!FileWriter.done_count)
+		return;
+
+	{
+		std::lock_guard<std::mutex>	lock(FileWriter.mutex);
+		done.swap(FileWriter.done);
+		FileWriter.done_count = 0;
+	}
+
+	for (size_t i = 0; i < done.size(); i++)
+	{
+		if (done[i].result)
+		{
+			if (!done[i].message.empty())
+				S9xMessage(S9X_INFO, S9X_FREEZE_FILE_INFO, done[i].message.c_str());
+		}
+		else
+		{
+			char	message[PATH_MAX + 64];
+
+			snprintf(message, sizeof(message), SAVE_ERR_WRITE_FAILED, S9xBasename(done[i].filename).c_str());
+			S9xMessage(S9X_ERROR, S9X_FILE_WRITE_FAILED, message);
+		}
+	}
+}
+
+bool8 S9xFreezeGame (const char *filename)
+{
+	std::vector<uint8>	data(S9xFreezeSize());
+
+	S9xFreezeGameMem(data.data(), data.size());
+	S9xResetSaveTimer(TRUE);
+
+	auto base = S9xBasename(filename);
+	if (S9xMovieActive())
+		sprintf(String, MOVIE_INFO_SNAPSHOT " %s", base.c_str());
+	else
+		sprintf(String, SAVE_INFO_SNAPSHOT " %s", base.c_str());
+
+	return (S9xQueueFileWrite(filename, data, TRUE, String));
 }
 
 int S9xUnfreezeGameMem (const uint8 *buf, uint32 bufSize)
@@ -1065,6 +1265,408 @@ int S9xUnfreezeGameMem (const uint8 *buf, uint32 bufSize)
 	return result;
 }
 
+// Hot states are for saving and restoring within the same process, several
+// times a frame for run-ahead and rollback. The emulator's structs are copied
+// as they are, so there are no block names to parse, no per-field endian
+// conversion and no staging copies. Pointers in them (PCBase, SA1 and GSU
+// maps) stay valid because the ROM and memory don't move while a game is
+// loaded. The format changes with the build: the header rejects states from
+// another version, another ROM, or with other special chips enabled.
+
+struct SHotStateHeader
+{
+	uint32	Magic;
+	uint32	Version;
+	uint32	Size;
+	uint32	ROMCRC32;
+};
+
+// Blocks start on 64-byte boundaries so that the page ranges handed out by
+// S9xHotFreezeGameDirty() stay aligned. The padding is zeroed on save to keep
+// deltas between states quiet.
+
+#define HOT_ALIGN(n)	(((n) + 63) & ~63)
+
+#define HOT_BLOCK(data, size) \
+	{ \
+		if (buf) \
+		{ \
+			if (save) \
+			{ \
+				memcpy(buf + pos, (data), (size)); \
+				memset(buf + pos + (size), 0, HOT_ALIGN(size) - (size)); \
+				HotStateRange(ranges, pos, HOT_ALIGN(size)); \
+			} \
+			else \
+				memcpy((data), buf + pos, (size)); \
+		} \
+		\
+		pos += HOT_ALIGN(size); \
+	}
+
+// Packs one field without padding; the caller aligns the group as a whole.
+#define HOT_FIELD(field) \
+	{ \
+		if (buf) \
+		{ \
+			if (save) \
+				memcpy(buf + pos, &(field), sizeof(field)); \
+			else \
+				memcpy(&(field), buf + pos, sizeof(field)); \
+		} \
+		\
+		pos += sizeof(field); \
+	}
+
+// Copies only the pages written since the last checkpoint when saving with a
+// range list; the rest of the buffer still holds them from the previous save.
+// Loading with a checkpoint likewise puts back only the pages written since,
+// and stamps them again: they changed, as far as any other checkpoint cares.
+// loaded(p) is then called for each page put back.
+#define HOT_PAGES(data, size, pages, tracked, loaded) \
+	{ \
+		if (buf && (save ? ranges != NULL : since != 0) && (tracked)) \
+		{ \
+			for (uint32 p = 0; p < (size) >> DIRTY_PAGE_SHIFT; p++) \
+			{ \
+				if (S9xIsDirty((pages), p, since)) \
+				{ \
+					if (save) \
+					{ \
+						memcpy(buf + pos + (p << DIRTY_PAGE_SHIFT), (data) + (p << DIRTY_PAGE_SHIFT), DIRTY_PAGE_SIZE); \
+						HotStateRange(ranges, pos + (p << DIRTY_PAGE_SHIFT), DIRTY_PAGE_SIZE); \
+					} \
+					else \
+					{ \
+						memcpy((data) + (p << DIRTY_PAGE_SHIFT), buf + pos + (p << DIRTY_PAGE_SHIFT), DIRTY_PAGE_SIZE); \
+						(pages)[p] = Dirty.Generation; \
+						loaded(p); \
+					} \
+				} \
+			} \
+			\
+			pos += HOT_ALIGN(size); \
+		} \
+		else \
+			HOT_BLOCK((data), (size)); \
+	}
+
+static void HotPageLoaded (uint32)
+{
+}
+
+// Tiles converted from a reloaded VRAM page are stale, and only those.
+static void HotVRAMPageLoaded (uint32 page)
+{
+	uint32	*gen = IPPU.VRAMLineGen + (page << (DIRTY_PAGE_SHIFT - 4));
+
+	for (uint32 l = 0; l < (DIRTY_PAGE_SIZE >> 4); l++)
+		gen[l] = IPPU.TileGen;
+}
+
+static void HotStateRange (std::vector<struct SHotStateRange> *ranges, uint32 offset, uint32 size)
+{
+	if (!ranges)
+		return;
+
+	if (!ranges->empty() && ranges->back().Offset + ranges->back().Size == offset)
+		ranges->back().Size += size;
+	else
+	{
+		struct SHotStateRange	r = { offset, size };
+		ranges->push_back(r);
+	}
+}
+
+static uint32 HotStateBlocks (uint8 *buf, bool8 save, struct SControlSnapshot *ctl_snap, uint32 since = 0, std::vector<struct SHotStateRange> *ranges = NULL)
+{
+	uint32	pos = HOT_ALIGN(sizeof(struct SHotStateHeader));
+
+	HOT_BLOCK(&CPU, sizeof(CPU));
+	HOT_BLOCK(&Registers, sizeof(Registers));
+	HOT_BLOCK(&PPU, sizeof(PPU));
+	HOT_BLOCK(DMA, sizeof(DMA));
+	HOT_PAGES(Memory.VRAM, sizeof(Memory.VRAM), Dirty.VRAM, TRUE, HotVRAMPageLoaded);
+	HOT_PAGES(Memory.RAM, sizeof(Memory.RAM), Dirty.RAM, TRUE, HotPageLoaded);
+	HOT_PAGES(Memory.SRAM, Memory.SRAMInUse(), Dirty.SRAM, Dirty.SRAMTracked, HotPageLoaded);
+	HOT_BLOCK(Memory.FillRAM, 0x8000);
+
+	// The APU block starts with its 64KB of RAM. It is always saved in full,
+	// but only the RAM pages written since the checkpoint are reported.
+	if (buf)
+	{
+		if (save)
+		{
+			S9xAPUSaveState(buf + pos);
+
+			if (ranges)
+			{
+				for (uint32 p = 0; p < (0x10000 >> DIRTY_PAGE_SHIFT); p++)
+				{
+					if (S9xIsDirty(Dirty.APURAM, p, since))
+						HotStateRange(ranges, pos + (p << DIRTY_PAGE_SHIFT), DIRTY_PAGE_SIZE);
+				}
+
+				HotStateRange(ranges, pos + 0x10000, HOT_ALIGN(SPC_SAVE_STATE_BLOCK_SIZE) - 0x10000);
+			}
+		}
+		else
+		{
+			S9xAPULoadState(buf + pos);
+
+			if (since)
+			{
+				for (uint32 p = 0; p < (0x10000 >> DIRTY_PAGE_SHIFT); p++)
+				{
+					if (S9xIsDirty(Dirty.APURAM, p, since))
+						Dirty.APURAM[p] = Dirty.Generation;
+				}
+			}
+		}
+	}
+
+	pos += HOT_ALIGN(SPC_SAVE_STATE_BLOCK_SIZE);
+
+	HOT_BLOCK(ctl_snap, sizeof(struct SControlSnapshot));
+	HOT_BLOCK(&Timings, sizeof(Timings));
+
+	if (Settings.SuperFX)
+		HOT_BLOCK(&GSU, sizeof(GSU));
+
+	if (Settings.SA1)
+	{
+		HOT_BLOCK(&SA1, sizeof(SA1));
+		HOT_BLOCK(&SA1Registers, sizeof(SA1Registers));
+	}
+
+	if (Settings.DSP == 1)
+		HOT_BLOCK(&DSP1, sizeof(DSP1));
+
+	if (Settings.DSP == 2)
+		HOT_BLOCK(&DSP2, sizeof(DSP2));
+
+	if (Settings.DSP == 4)
+		HOT_BLOCK(&DSP4, sizeof(DSP4));
+
+	if (Settings.C4)
+		HOT_BLOCK(Memory.C4RAM, 8192);
+
+	if (Settings.SETA == ST_010)
+		HOT_BLOCK(&ST010, sizeof(ST010));
+
+	if (Settings.OBC1)
+	{
+		HOT_BLOCK(&OBC1, sizeof(OBC1));
+		HOT_BLOCK(Memory.OBC1RAM, 8192);
+	}
+
+	if (Settings.SPC7110)
+		HOT_BLOCK(&s7snap, sizeof(s7snap));
+
+	if (Settings.SRTC)
+		HOT_BLOCK(&srtcsnap, sizeof(srtcsnap));
+
+	if (Settings.SRTC || Settings.SPC7110RTC)
+		HOT_BLOCK(RTCData.reg, 20);
+
+	// SBSX holds the satellaview file streams, so it can't be copied whole.
+	// Its plain fields go one by one into a single block; the streams and
+	// their latches are left alone.
+	if (Settings.BS)
+	{
+		uint32	start = pos;
+
+		HOT_FIELD(BSX.dirty);
+		HOT_FIELD(BSX.dirty2);
+		HOT_FIELD(BSX.bootup);
+		HOT_FIELD(BSX.flash_enable);
+		HOT_FIELD(BSX.write_enable);
+		HOT_FIELD(BSX.read_enable);
+		HOT_FIELD(BSX.flash_command);
+		HOT_FIELD(BSX.old_write);
+		HOT_FIELD(BSX.new_write);
+		HOT_FIELD(BSX.out_index);
+		HOT_FIELD(BSX.output);
+		HOT_FIELD(BSX.PPU);
+		HOT_FIELD(BSX.MMC);
+		HOT_FIELD(BSX.prevMMC);
+		HOT_FIELD(BSX.test2192);
+		HOT_FIELD(BSX.flash_csr);
+		HOT_FIELD(BSX.flash_gsr);
+		HOT_FIELD(BSX.flash_bsr);
+		HOT_FIELD(BSX.flash_cmd_done);
+
+		if (buf && save)
+		{
+			memset(buf + pos, 0, HOT_ALIGN(pos - start) - (pos - start));
+			HotStateRange(ranges, start, HOT_ALIGN(pos - start));
+		}
+
+		pos = start + HOT_ALIGN(pos - start);
+	}
+
+	if (Settings.MSU1)
+	{
+		HOT_BLOCK(&MSU1, sizeof(MSU1));
+		HOT_BLOCK(&partial_frames, sizeof(partial_frames));
+	}
+
+	return (pos);
+}
+
+#undef HOT_PAGES
+#undef HOT_FIELD
+#undef HOT_BLOCK
+
+uint32 S9xHotFreezeSize (void)
+{
+	return (HotStateBlocks(NULL, TRUE, NULL));
+}
+
+static bool8 HotFreeze (uint8 *buf, uint32 bufSize, uint32 since, std::vector<struct SHotStateRange> *ranges)
+{
+	struct SHotStateHeader	header;
+	struct SControlSnapshot	ctl_snap;
+
+	header.Magic    = HOTSTATE_MAGIC;
+	header.Version  = HOTSTATE_VERSION;
+	header.Size     = S9xHotFreezeSize();
+	header.ROMCRC32 = Memory.ROMCRC32;
+
+	if (bufSize < header.Size)
+		return (FALSE);
+
+	S9xWaitForRenderer();
+
+	S9xControlPreSaveState(&ctl_snap);
+	Timings.InterlaceField = S9xInterlaceField();
+
+	if (Settings.SA1)
+		S9xSA1PackStatus();
+
+	if (Settings.SPC7110)
+		S9xSPC7110PreSaveState();
+
+	if (Settings.SRTC)
+		S9xSRTCPreSaveState();
+
+	memset(buf, 0, HOT_ALIGN(sizeof(header)));
+	memcpy(buf, &header, sizeof(header));
+	HotStateRange(ranges, 0, HOT_ALIGN(sizeof(header)));
+	HotStateBlocks(buf, TRUE, &ctl_snap, since, ranges);
+
+	return (TRUE);
+}
+
+bool8 S9xHotFreezeGame (uint8 *buf, uint32 bufSize)
+{
+	return (HotFreeze(buf, bufSize, 0, NULL));
+}
+
+// buf must hold the state saved at checkpoint 'since', which only gets its
+// changed pages rewritten. ranges receives the parts of buf that may differ.
+bool8 S9xHotFreezeGameDirty (uint8 *buf, uint32 bufSize, uint32 since, std::vector<struct SHotStateRange> &ranges)
+{
+	ranges.clear();
+
+	return (HotFreeze(buf, bufSize, since, &ranges));
+}
+
+#undef HOT_ALIGN
+
+static int HotUnfreeze (const uint8 *buf, uint32 bufSize, uint32 since)
+{
+	struct SHotStateHeader	header;
+	struct SControlSnapshot	ctl_snap;
+
+	if (bufSize < sizeof(header))
+		return (WRONG_FORMAT);
+
+	memcpy(&header, buf, sizeof(header));
+
+	if (header.Magic != HOTSTATE_MAGIC)
+		return (WRONG_FORMAT);
+
+	if (header.Version != HOTSTATE_VERSION)
+		return (WRONG_VERSION);
+
+	if (header.ROMCRC32 != Memory.ROMCRC32 || header.Size != S9xHotFreezeSize() || bufSize < header.Size)
+		return (SNAPSHOT_INCONSISTENT);
+
+	uint32	old_flags     = CPU.Flags;
+	uint32	sa1_old_flags = SA1.Flags;
+	struct SMSU1	old_msu1 = MSU1;
+
+	S9xWaitForRenderer();
+
+	HotStateBlocks((uint8 *) buf, FALSE, &ctl_snap, since);
+
+	// A partial load stamped the pages it rewrote, and the VRAM lines in them,
+	// so the tile cache stays good for the rest.
+	if (!since)
+		S9xMarkAllDirty();
+
+	S9xResetPPUFast(!since);
+
+	CPU.Flags |= old_flags & (DEBUG_MODE_FLAG | TRACE_FLAG | SINGLE_STEP_FLAG | FRAME_ADVANCE_FLAG);
+	ICPU.ShiftedPB = Registers.PB << 16;
+	ICPU.ShiftedDB = Registers.DB << 16;
+	S9xUpdateBlockSpeed();
+	S9xSetPCBase(Registers.PBPC);
+	S9xUnpackStatus();
+	S9xFixCycles();
+
+	CPU.InDMA = CPU.InHDMA = FALSE;
+	CPU.InDMAorHDMA = CPU.InWRAMDMAorHDMA = FALSE;
+	CPU.HDMARanInDMA = 0;
+
+	S9xFixColourBrightness();
+	S9xBuildDirectColourMaps();
+	IPPU.BrightnessChanged = FALSE;
+
+	// IPPU.Interlace decides the length of the frame, so it has to follow
+	// $2133 back even when no frame gets rendered before the next one.
+	GFX.DoInterlace = 0;
+	S9xGraphicsScreenResize();
+
+	S9xControlPostLoadState(&ctl_snap);
+
+	if (Settings.SA1)
+	{
+		SA1.Flags |= sa1_old_flags & TRACE_FLAG;
+		S9xSA1PostLoadState();
+	}
+
+	if (Settings.SDD1)
+		S9xSDD1PostLoadState();
+
+	if (Settings.SPC7110)
+		S9xSPC7110PostLoadState(SNAPSHOT_VERSION);
+
+	if (Settings.SRTC)
+		S9xSRTCPostLoadState(SNAPSHOT_VERSION);
+
+	if (Settings.BS)
+		S9xBSXPostLoadState();
+
+	if (Settings.MSU1)
+		S9xMSU1PostHotLoadState(old_msu1);
+
+	return (SUCCESS);
+}
+
+int S9xHotUnfreezeGame (const uint8 *buf, uint32 bufSize)
+{
+	return (HotUnfreeze(buf, bufSize, 0));
+}
+
+// buf must hold the state saved at checkpoint 'since'. Only the pages written
+// or loaded after it are restored.
+int S9xHotUnfreezeGameDirty (const uint8 *buf, uint32 bufSize, uint32 since)
+{
+	return (HotUnfreeze(buf, bufSize, since));
+}
+
 void S9xMessageFromResult(int result, const char* base)
 {
     switch(result)
@@ -1105,6 +1707,9 @@ bool8 S9xUnfreezeGame (const char *filename)
 	auto path = splitpath(filename);
 	S9xResetSaveTimer(path.ext_is(".oops") || path.ext_is(".oop"));
 
+	// It may have just been saved.
+	S9xWaitForFileWrites();
+
 	if (S9xOpenSnapshotFile(filename, TRUE, &stream))
 	{
 		int	result;
@@ -1193,7 +1798,7 @@ void S9xFreezeToStream (STREAM stream)
 
 	FreezeBlock (stream, "RAM", Memory.RAM, sizeof(Memory.RAM));
 
-	FreezeBlock (stream, "SRA", Memory.SRAM, Memory.SRAM_SIZE);
+	FreezeBlock (stream, "SRA", Memory.SRAM, Memory.SRAMInUse());
 
 	FreezeBlock (stream, "FIL", Memory.FillRAM, 0x8000);
 
@@ -1399,9 +2004,9 @@ int S9xUnfreezeFromStream (STREAM stream)
 			break;
 
 		if (fast)
-			result = UnfreezeBlock(stream, "SRA", Memory.SRAM, Memory.SRAM_SIZE);
+			result = UnfreezeBlock(stream, "SRA", Memory.SRAM, Memory.SRAMInUse());
 		else
-			result = UnfreezeBlockCopy (stream, "SRA", &local_sram, Memory.SRAM_SIZE);
+			result = UnfreezeBlockCopy (stream, "SRA", &local_sram, Memory.SRAMInUse());
 		if (result != SUCCESS)
 			break;
 
@@ -1547,7 +2152,7 @@ int S9xUnfreezeFromStream (STREAM stream)
 
 		if (fast)
 		{
-			S9xResetPPUFast();
+			S9xResetPPUFast(TRUE);
 		}
 		else
 		{
@@ -1555,6 +2160,8 @@ int S9xUnfreezeFromStream (STREAM stream)
 			S9xReset();
 		}
 
+		S9xMarkAllDirty();
+
 		UnfreezeStructFromCopy(&CPU, SnapCPU, COUNT(SnapCPU), local_cpu, version);
 
 		UnfreezeStructFromCopy(&Registers, SnapRegisters, COUNT(SnapRegisters), local_registers, version);
@@ -1571,7 +2178,7 @@ int S9xUnfreezeFromStream (STREAM stream)
 			memcpy(Memory.RAM, local_ram, 0x20000);
 
 		if (local_sram)
-			memcpy(Memory.SRAM, local_sram, Memory.SRAM_SIZE);
+			memcpy(Memory.SRAM, local_sram, Memory.SRAMInUse());
 
 		if (local_fillram)
 			memcpy(Memory.FillRAM, local_fillram, 0x8000);
@@ -1697,6 +2304,7 @@ int S9xUnfreezeFromStream (STREAM stream)
 		CPU.Flags |= old_flags & (DEBUG_MODE_FLAG | TRACE_FLAG | SINGLE_STEP_FLAG | FRAME_ADVANCE_FLAG);
 		ICPU.ShiftedPB = Registers.PB << 16;
 		ICPU.ShiftedDB = Registers.DB << 16;
+		S9xUpdateBlockSpeed();
 		S9xSetPCBase(Registers.PBPC);
 		S9xUnpackStatus();
 		if(version < SNAPSHOT_VERSION_IRQ_2018)
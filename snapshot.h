@@ -7,6 +7,7 @@
 #ifndef _SNAPSHOT_H_
 #define _SNAPSHOT_H_
 
+#include <vector>
 #include "snes9x.h"
 
 #define SNAPSHOT_MAGIC			"#!s9xsnp"
@@ -15,6 +16,9 @@
 #define SNAPSHOT_VERSION_IRQ_2018	11		// irq changes were introduced earlier, since this we store NextIRQTimer directly
 #define SNAPSHOT_VERSION			12
 
+#define HOTSTATE_MAGIC			0x53485339	// "9SHS"
+#define HOTSTATE_VERSION		4
+
 #define SUCCESS					1
 #define WRONG_FORMAT			(-1)
 #define WRONG_VERSION			(-2)
@@ -23,12 +27,26 @@
 #define NOT_A_MOVIE_SNAPSHOT	(-5)
 #define SNAPSHOT_INCONSISTENT	(-6)
 
+struct SHotStateRange
+{
+	uint32	Offset;
+	uint32	Size;
+};
+
 void S9xResetSaveTimer (bool8);
 bool8 S9xFreezeGame (const char *);
 uint32 S9xFreezeSize (void);
 bool8 S9xFreezeGameMem (uint8 *,uint32);
 bool8 S9xUnfreezeGame (const char *);
+bool8 S9xQueueFileWrite (const char *, std::vector<uint8> &, bool8, const char *);
+void S9xWaitForFileWrites (void);
+void S9xReportFileWrites (void);
 int S9xUnfreezeGameMem (const uint8 *,uint32);
+uint32 S9xHotFreezeSize (void);
+bool8 S9xHotFreezeGame (uint8 *, uint32);
+int S9xHotUnfreezeGame (const uint8 *, uint32);
+bool8 S9xHotFreezeGameDirty (uint8 *, uint32, uint32, std::vector<struct SHotStateRange> &);
+int S9xHotUnfreezeGameDirty (const uint8 *, uint32, uint32);
 void S9xFreezeToStream (STREAM);
 int	 S9xUnfreezeFromStream (STREAM);
 bool8 S9xUnfreezeScreenshot(const char *filename, uint16 **image_buffer, int &width, int &height);
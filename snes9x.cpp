@@ -154,6 +154,16 @@ static bool try_load_config_file (const char *fname, ConfigFile &conf)
 	return (false);
 }
 
+uint8 S9xClampRunAhead (int frames)
+{
+	if (frames < 0)
+		return (0);
+	if (frames > MAX_RUNAHEAD_FRAMES)
+		return (MAX_RUNAHEAD_FRAMES);
+
+	return ((uint8) frames);
+}
+
 void S9xLoadConfigFiles (char **argv, int argc)
 {
 	static ConfigFile	conf; // static because some of its functions return pointers
@@ -232,6 +242,8 @@ void S9xLoadConfigFiles (char **argv, int argc)
 	Settings.DynamicRateControl         =  conf.GetBool("Sound::DynamicRateControl",           false);
 	Settings.DynamicRateLimit           =  conf.GetInt ("Sound::DynamicRateLimit",             5);
 	Settings.InterpolationMethod        =  conf.GetInt ("Sound::InterpolationMethod",          2);
+	Settings.ResamplerQuality           =  conf.GetInt ("Sound::ResamplerQuality",             0);
+	Settings.ParallelVoices             =  conf.GetBool("Sound::ParallelVoices",               false);
 
 	// Display
 
@@ -245,6 +257,7 @@ void S9xLoadConfigFiles (char **argv, int argc)
 	Settings.AutoDisplayMessages        =  conf.GetBool("Display::MessagesInImage",            true);
 	Settings.InitialInfoStringTimeout   =  conf.GetInt ("Display::MessageDisplayTime",         120);
 	Settings.BilinearFilter             =  conf.GetBool("Display::BilinearFilter",             false);
+	Settings.ThreadedRenderer           =  conf.GetBool("Display::ThreadedRenderer",           false);
 
 	// Settings
 
@@ -258,6 +271,8 @@ void S9xLoadConfigFiles (char **argv, int argc)
 	Settings.SnapshotScreenshots        =  conf.GetBool("Settings::SnapshotScreenshots",       true);
 	Settings.DontSaveOopsSnapshot       =  conf.GetBool("Settings::DontSaveOopsSnapshot",      false);
 	Settings.AutoSaveDelay              =  conf.GetUInt("Settings::AutoSaveDelay",             0);
+	Settings.RunAhead                   =  S9xClampRunAhead(conf.GetInt("Settings::RunAheadFrames", 0));
+	Settings.ShareROM                   =  conf.GetBool("Settings::ShareROM",                  false);
 
 	if (conf.Exists("Settings::FrameTime"))
 		Settings.FrameTimePAL = Settings.FrameTimeNTSC = conf.GetUInt("Settings::FrameTime", 16667);
@@ -349,6 +364,8 @@ void S9xUsage (void)
 	S9xMessage(S9X_INFO, S9X_USAGE, "-soundsync                      Synchronize sound as far as possible");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-playbackrate <Hz>              Set sound playback rate");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-inputrate <Hz>                 Set sound input rate");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-resampler <0-2>                Resampler: 0 cubic, 1 8-tap sinc, 2 16-tap sinc");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-parallelvoices                 Mix the 8 DSP voices in lockstep (same output)");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-reversestereo                  Reverse stereo sound output");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-nostereo                       Disable stereo sound output");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-eightbit                       Use 8bit sound instead of 16bit");
@@ -363,6 +380,7 @@ void S9xUsage (void)
 	S9xMessage(S9X_INFO, S9X_USAGE, "                                interlace modes");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-notransparency                 (Not recommended) Disable transparency effects");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-nowindows                      (Not recommended) Disable graphic window effects");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-threadedrenderer               Draw the screen on a separate thread");
 	S9xMessage(S9X_INFO, S9X_USAGE, "");
 
 	// CONTROLLER OPTIONS
@@ -428,6 +446,8 @@ void S9xUsage (void)
 	// OTHER OPTIONS
 	S9xMessage(S9X_INFO, S9X_USAGE, "-frameskip <num>                Screen update frame skip rate");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-frametime <num>                Milliseconds per frame for frameskip auto-adjust");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-runahead <num>                 Emulate <num> frames ahead to cut input lag (0-8)");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-sharerom                       Share the ROM image with other processes running it");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-upanddown                      Override protection from pressing left+right or");
 	S9xMessage(S9X_INFO, S9X_USAGE, "                                up+down together");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-conf <filename>                Use specified conf file (after standard files)");
@@ -513,6 +533,17 @@ char * S9xParseArgs (char **argv, int argc)
 					S9xUsage();
 			}
 			else
+			if (!strcasecmp(argv[i], "-resampler"))
+			{
+				if (i + 1 < argc)
+					Settings.ResamplerQuality = atoi(argv[++i]);
+				else
+					S9xUsage();
+			}
+			else
+			if (!strcasecmp(argv[i], "-parallelvoices"))
+				Settings.ParallelVoices = TRUE;
+			else
 			if (!strcasecmp(argv[i], "-reversestereo"))
 				Settings.ReverseStereo = TRUE;
 			else
@@ -543,6 +574,9 @@ char * S9xParseArgs (char **argv, int argc)
 			if (!strcasecmp(argv[i], "-nowindows"))
 				Settings.DisableGraphicWindows = TRUE;
 			else
+			if (!strcasecmp(argv[i], "-threadedrenderer"))
+				Settings.ThreadedRenderer = TRUE;
+			else
 
 			// CONTROLLER OPTIONS
 
@@ -724,6 +758,17 @@ char * S9xParseArgs (char **argv, int argc)
 					S9xUsage();
 			}
 			else
+			if (!strcasecmp(argv[i], "-runahead"))
+			{
+				if (i + 1 < argc)
+					Settings.RunAhead = S9xClampRunAhead(atoi(argv[++i]));
+				else
+					S9xUsage();
+			}
+			else
+			if (!strcasecmp(argv[i], "-sharerom"))
+				Settings.ShareROM = TRUE;
+			else
 			if (!strcasecmp(argv[i], "-upanddown"))
 				Settings.UpAndDown = TRUE;
 			else
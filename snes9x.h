@@ -65,6 +65,8 @@
 #define NTSC_INTERLACED_FRAME_RATE	59.94005994
 #define PAL_PROGRESSIVE_FRAME_RATE	50.006977968
 
+#define MAX_RUNAHEAD_FRAMES			8
+
 
 #define SNES_MAX_NTSC_VCOUNTER		262
 #define SNES_MAX_PAL_VCOUNTER		312
@@ -243,6 +245,8 @@ struct SSettings
 	bool8	DynamicRateControl;
 	int32	DynamicRateLimit; /* Multiplied by 1000 */
 	int32	InterpolationMethod;
+	int32	ResamplerQuality;
+	bool8	ParallelVoices;
 
 	bool8	Transparency;
 	uint8	BG_Forced;
@@ -260,6 +264,7 @@ struct SSettings
 	uint16	DisplayColor;
 	bool8	BilinearFilter;
 	bool	ShowOverscan;
+	bool8	ThreadedRenderer;
 
 	bool8	Multi;
 	char	CartAName[PATH_MAX + 1];
@@ -281,6 +286,8 @@ struct SSettings
 	uint32	HighSpeedSeek;
 	bool8	FrameAdvance;
 	bool8	Rewinding;
+	uint8	RunAhead;
+	bool8	ShareROM;
 
 	bool8	NetPlay;
 	bool8	NetPlayServer;
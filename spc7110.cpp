@@ -28,6 +28,7 @@
 #include "memmap.h"
 #include "srtc.h"
 #include "display.h"
+#include "profile.h"
 
 #define memory_cartrom_size()		Memory.CalculatedSize
 #define memory_cartrom_read(a)		Memory.ROM[(a)]
@@ -131,6 +132,8 @@ uint8 S9xGetSPC7110Byte (uint32 address)
 
 uint8 S9xGetSPC7110 (uint16 address)
 {
+	S9xProfileScope	profile(PROFILE_SPC7110);
+
 	if (!Settings.SPC7110RTC && address > 0x483f)
 		return (OpenBus);
 	
@@ -139,6 +142,8 @@ uint8 S9xGetSPC7110 (uint16 address)
 
 void S9xSetSPC7110 (uint8 byte, uint16 address)
 {
+	S9xProfileScope	profile(PROFILE_SPC7110);
+
 	if (!Settings.SPC7110RTC && address > 0x483f)
 		return;
 
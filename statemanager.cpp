@@ -1,5 +1,14 @@
 #include "statemanager.h"
 #include "snapshot.h"
+#include "dirty.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STATEMANAGER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define STATEMANAGER_NEON
+#include <arm_neon.h>
+#endif
 
 /*  State Manager Class that records snapshot data for rewinding
     mostly based on SSNES's rewind code by Themaister
@@ -33,6 +42,7 @@ static inline size_t nearest_pow2_size(size_t v)
 }
 
 void StateManager::deallocate() {
+    stop_thread();
     if(buffer) {
         delete [] buffer;
         buffer = NULL;
@@ -41,9 +51,18 @@ void StateManager::deallocate() {
         delete [] tmp_state;
         tmp_state = NULL;
     }
-    if(in_state) {
-        delete [] in_state;
-        in_state = NULL;
+    if(seek_state) {
+        delete [] seek_state;
+        seek_state = NULL;
+    }
+    deltas.clear();
+    keyframes.clear();
+    keyframe_bytes = 0;
+    for (int i = 0; i < STATEMANAGER_IN_BUFFERS; i++) {
+        if(in_state[i]) {
+            delete [] in_state[i];
+            in_state[i] = NULL;
+        }
     }
 }
 
@@ -51,21 +70,25 @@ StateManager::StateManager()
 {
     buffer = NULL;
     tmp_state = NULL;
-    in_state = NULL;
+    seek_state = NULL;
+    for (int i = 0; i < STATEMANAGER_IN_BUFFERS; i++)
+        in_state[i] = NULL;
     init_done = false;
+    thread_running = false;
+    job = -1;
 }
 
 StateManager::~StateManager() {
     deallocate();
 }
 
-bool StateManager::init(size_t buffer_size) {
+bool StateManager::init(size_t buffer_size, uint32_t keyframe_interval) {
 
     init_done = false;
 
     deallocate();
 
-    real_state_size = S9xFreezeSize();
+    real_state_size = S9xHotFreezeSize();
     state_size = real_state_size / sizeof(uint32_t); // Works in multiple of 4.
 
     // We need 4-byte aligned state_size to avoid having to enforce this with unneeded memcpy's!
@@ -75,35 +98,119 @@ bool StateManager::init(size_t buffer_size) {
         return false;
 
     top_ptr = 1;
+    bottom_ptr = 0;
 
-    
     buf_size = nearest_pow2_size(buffer_size) / sizeof(uint64_t); // Works in multiple of 8.
     buf_size_mask = buf_size - 1;
 
     if (!(buffer = new uint64_t[buf_size]))
         return false;
+    memset(buffer,0,buf_size * sizeof(uint64_t));
     if (!(tmp_state = new uint32_t[state_size]))
        return false;
-    if (!(in_state = new uint32_t[state_size]))
+    memset(tmp_state,0,state_size * sizeof(uint32_t));
+    if (!(seek_state = new uint32_t[state_size]))
        return false;
 
-    memset(tmp_state,0,state_size * sizeof(uint32_t));
-    memset(in_state,0,state_size * sizeof(uint32_t));
+    for (int i = 0; i < STATEMANAGER_IN_BUFFERS; i++) {
+        if (!(in_state[i] = new uint32_t[state_size]))
+           return false;
+        memset(in_state[i],0,state_size * sizeof(uint32_t));
+        dirty_since[i] = 0;
+    }
+
+    next_in = 0;
+
+    this->keyframe_interval = keyframe_interval;
+    keyframe_budget = buffer_size / 4;
+    head_frame = 0;
+    seeked = false;
+
+    start_thread();
 
     init_done = true;
 
     return true;
 }
 
+void StateManager::thread_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (;;)
+    {
+        while (job < 0 && !thread_quit)
+            cond.wait(lock);
+
+        if (thread_quit)
+            break;
+
+        int i = job;
+        lock.unlock();
+        generate_delta(in_state[i], ranges[i]);
+        lock.lock();
+
+        job = -1;
+        cond.notify_all();
+    }
+}
+
+void StateManager::start_thread()
+{
+    // On a single core the worker would only add wakeups to every push.
+    if (std::thread::hardware_concurrency() < 2)
+        return;
+
+    job = -1;
+    thread_quit = false;
+    thread = std::thread(&StateManager::thread_loop, this);
+    thread_running = true;
+}
+
+void StateManager::stop_thread()
+{
+    if (!thread_running)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        thread_quit = true;
+        cond.notify_all();
+    }
+
+    thread.join();
+    thread_running = false;
+    job = -1;
+}
+
+void StateManager::wait_for_delta()
+{
+    if (!thread_running)
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (job >= 0)
+        cond.wait(lock);
+}
+
 int StateManager::pop()
 { 
     if(!init_done)
         return 0;
 
+    wait_for_delta();
+
+    if (seeked)
+    {
+      // Carry on back from the state we seeked to.
+      truncate_to_seek();
+      first_pop = false;
+    }
+
     if (first_pop)
     {
       first_pop = false;
-      return S9xUnfreezeGameMem((uint8 *)tmp_state,real_state_size);
+      return S9xHotUnfreezeGame((uint8 *)tmp_state,real_state_size);
     }
 
     top_ptr = (top_ptr - 1) & buf_size_mask;
@@ -129,21 +236,58 @@ int StateManager::pop()
       top_ptr = (top_ptr + 1) & buf_size_mask; 
     }
 
-    return S9xUnfreezeGameMem((uint8 *)tmp_state,real_state_size);
+    if (!deltas.empty())
+      deltas.pop_back();
+    if (head_frame)
+      head_frame--;
+    while (!keyframes.empty() && keyframes.back().frame > head_frame)
+    {
+      keyframe_bytes -= keyframes.back().data.size();
+      keyframes.pop_back();
+    }
+
+    return S9xHotUnfreezeGame((uint8 *)tmp_state,real_state_size);
 }
 
 void StateManager::reassign_bottom()
 {
+   size_t old_bottom = bottom_ptr;
+
    bottom_ptr = (top_ptr + 1) & buf_size_mask;
    while (buffer[bottom_ptr]) // Skip ahead until we find the first 0 (boundary for state delta).
       bottom_ptr = (bottom_ptr + 1) & buf_size_mask;
+
+   // Forget the deltas that were overwritten.
+   size_t lost = (bottom_ptr - old_bottom) & buf_size_mask;
+   while (!deltas.empty() && ((deltas.front().pos - old_bottom) & buf_size_mask) < lost)
+      deltas.pop_front();
+}
+
+// True if the four words at a and b are equal.
+static inline bool words_equal4(const uint32_t *a, const uint32_t *b)
+{
+#if defined(STATEMANAGER_SSE2)
+   __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b));
+   return _mm_movemask_epi8(eq) == 0xffff;
+#elif defined(STATEMANAGER_NEON)
+   uint32x4_t ne = veorq_u32(vld1q_u32(a), vld1q_u32(b));
+   uint32x2_t n = vorr_u32(vget_low_u32(ne), vget_high_u32(ne));
+   return (vget_lane_u32(n, 0) | vget_lane_u32(n, 1)) == 0;
+#else
+   return ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3])) == 0;
+#endif
 }
 
-void StateManager::generate_delta(const void *data)
+// Only the ranges the last freeze reported can differ, so only those are
+// compared, four words at a time until something differs. tmp_state is
+// brought up to date as we go.
+void StateManager::generate_delta(const uint32_t *new_state, const std::vector<SHotStateRange> &ranges)
 {
    bool crossed = false;
-   const uint32_t *old_state = tmp_state;
-   const uint32_t *new_state = (const uint32_t*)data;
+   uint32_t *old_state = tmp_state;
+
+   DeltaRecord record = { head_frame, top_ptr };
+   deltas.push_back(record);
 
    buffer[top_ptr++] = 0; // For each separate delta, we have a 0 value sentinel in between.
    top_ptr &= buf_size_mask;
@@ -152,40 +296,233 @@ void StateManager::generate_delta(const void *data)
    if (top_ptr == bottom_ptr)
       crossed = true;
 
-   for (uint64_t i = 0; i < state_size; i++)
+   for (size_t r = 0; r < ranges.size(); r++)
    {
-      uint64_t xor_ = old_state[i] ^ new_state[i];
+      uint64_t i = ranges[r].Offset / sizeof(uint32_t);
+      uint64_t end = (ranges[r].Offset + ranges[r].Size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
 
-      // If the data differs (xor != 0), we push that xor on the stack with index and xor.
-      // This can be reversed by reapplying the xor.
-      // This, if states don't really differ much, we'll save lots of space :)
-      // Hopefully this will work really well with save states.
-      if (xor_)
+      while (i < end)
       {
-         buffer[top_ptr] = (i << 32) | xor_;
-         top_ptr = (top_ptr + 1) & buf_size_mask;
-
-         if (top_ptr == bottom_ptr)
-            crossed = true;
+         if (i + 4 <= end)
+         {
+            if (words_equal4(old_state + i, new_state + i))
+            {
+               i += 4;
+               continue;
+            }
+         }
+
+         uint64_t stop = (i + 4 <= end) ? i + 4 : end;
+
+         for (; i < stop; i++)
+         {
+            uint64_t xor_ = old_state[i] ^ new_state[i];
+
+            // If the data differs (xor != 0), we push that xor on the stack with index and xor.
+            // This can be reversed by reapplying the xor.
+            // This, if states don't really differ much, we'll save lots of space :)
+            // Hopefully this will work really well with save states.
+            if (xor_)
+            {
+               buffer[top_ptr] = (i << 32) | xor_;
+               top_ptr = (top_ptr + 1) & buf_size_mask;
+
+               if (top_ptr == bottom_ptr)
+                  crossed = true;
+
+               old_state[i] = new_state[i];
+            }
+         }
       }
    }
 
    if (crossed)
       reassign_bottom();
+
+   if (keyframe_interval && head_frame % keyframe_interval == 0)
+      add_keyframe();
 }
 
 bool StateManager::push()
 {
     if(!init_done)
         return false;
-    if(!S9xFreezeGameMem((uint8 *)in_state,real_state_size))
+
+    // The worker is at most one delta behind, and that one reads the other
+    // buffer, so the freeze below can run alongside it.
+    int i = next_in;
+
+    // in_state[i] still holds the state it was last frozen with, so only the
+    // memory pages written since then need to be saved again.
+    if(!S9xHotFreezeGameDirty((uint8 *)in_state[i],real_state_size,dirty_since[i],ranges[i]))
         return false;
-    generate_delta(in_state);
-    uint32 *tmp = tmp_state;
-    tmp_state = in_state;
-    in_state = tmp;
+    dirty_since[i] = S9xDirtyCheckpoint();
+
+    // The state we seeked to becomes the head, newer history is dropped.
+    wait_for_delta();
+    if (seeked)
+        truncate_to_seek();
+    head_frame++;
+
+    if (thread_running)
+    {
+        next_in = (next_in + 1) % STATEMANAGER_IN_BUFFERS;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        job = i;
+        cond.notify_one();
+    }
+    else
+        generate_delta(in_state[i], ranges[i]);
 
     first_pop = true;
 
     return true;
 }
+
+void StateManager::add_keyframe()
+{
+   Keyframe k;
+   k.frame = head_frame;
+
+#ifdef ZLIB
+   uLongf len = compressBound(real_state_size);
+   k.data.resize(len);
+   if (compress2(&k.data[0], &len, (const Bytef *)tmp_state, real_state_size, Z_BEST_SPEED) != Z_OK)
+      return;
+   k.data.resize(len);
+#else
+   k.data.assign((const uint8_t *)tmp_state, (const uint8_t *)tmp_state + real_state_size);
+#endif
+   k.data.shrink_to_fit();
+
+   keyframe_bytes += k.data.size();
+   keyframes.push_back(k);
+
+   while (keyframe_bytes > keyframe_budget && keyframes.size() > 1)
+   {
+      keyframe_bytes -= keyframes.front().data.size();
+      keyframes.pop_front();
+   }
+}
+
+bool StateManager::load_keyframe(const Keyframe &k, uint32_t *state)
+{
+#ifdef ZLIB
+   uLongf len = real_state_size;
+   return uncompress((Bytef *)state, &len, &k.data[0], k.data.size()) == Z_OK && len == real_state_size;
+#else
+   memcpy(state, &k.data[0], real_state_size);
+   return true;
+#endif
+}
+
+// Applies one delta forward through the ring, which turns the state of
+// d.frame into the one before it.
+void StateManager::apply_delta(const DeltaRecord &d, uint32_t *state)
+{
+   for (size_t p = (d.pos + 1) & buf_size_mask; p != top_ptr && buffer[p]; p = (p + 1) & buf_size_mask)
+      state[buffer[p] >> 32] ^= (uint32_t)buffer[p];
+}
+
+uint32_t StateManager::newest_frame()
+{
+   return head_frame;
+}
+
+uint32_t StateManager::oldest_frame()
+{
+   wait_for_delta();
+
+   uint32_t oldest = head_frame;
+
+   // Frame 0 is the empty state the first delta was taken against.
+   if (!deltas.empty() && deltas.front().frame > 1)
+      oldest = deltas.front().frame - 1;
+   else if (!deltas.empty())
+      oldest = 1;
+
+   if (!keyframes.empty() && keyframes.front().frame < oldest)
+      oldest = keyframes.front().frame;
+
+   return oldest;
+}
+
+// Restores the state of push number 'frame'. History is left alone until the
+// next push() or pop(), so the timeline can be scrubbed back and forth.
+int StateManager::seek(uint32_t frame)
+{
+   if (!init_done || frame == 0)
+      return 0;
+
+   wait_for_delta();
+
+   if (frame > head_frame)
+      return 0;
+
+   // Deltas can take us from any newer keyframe, or the head, back to
+   // frame as long as they reach that far.
+   bool reachable = frame == head_frame ||
+                    (!deltas.empty() && deltas.front().frame <= frame + 1);
+   const Keyframe *from = NULL;
+
+   for (size_t k = 0; k < keyframes.size(); k++)
+   {
+      if (keyframes[k].frame == frame || (reachable && keyframes[k].frame > frame))
+      {
+         from = &keyframes[k];
+         break;
+      }
+   }
+
+   uint32_t start;
+
+   if (from && from->frame < head_frame)
+   {
+      if (!load_keyframe(*from, seek_state))
+         return 0;
+      start = from->frame;
+   }
+   else if (reachable)
+   {
+      memcpy(seek_state, tmp_state, state_size * sizeof(uint32_t));
+      start = head_frame;
+   }
+   else
+      return 0;
+
+   for (uint32_t f = start; f > frame; f--)
+      apply_delta(deltas[f - deltas.front().frame], seek_state);
+
+   int result = S9xHotUnfreezeGame((uint8 *)seek_state, real_state_size);
+
+   if (result > 0)
+   {
+      seeked = frame != head_frame;
+      seek_frame = frame;
+   }
+
+   return result;
+}
+
+// Makes the state we seeked to the newest one. The next delta is written
+// over the first one newer than it.
+void StateManager::truncate_to_seek()
+{
+   seeked = false;
+
+   while (!deltas.empty() && deltas.back().frame > seek_frame)
+   {
+      top_ptr = deltas.back().pos;
+      deltas.pop_back();
+   }
+
+   while (!keyframes.empty() && keyframes.back().frame > seek_frame)
+   {
+      keyframe_bytes -= keyframes.back().data.size();
+      keyframes.pop_back();
+   }
+
+   memcpy(tmp_state, seek_state, state_size * sizeof(uint32_t));
+   head_frame = seek_frame;
+}
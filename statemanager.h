@@ -3,9 +3,26 @@
 
 /*  State Manager Class that records snapshot data for rewinding
     mostly based on SSNES's rewind code by Themaister
+
+    Every push is numbered. Besides the XOR deltas, every keyframe_interval
+    pushes a compressed copy of the state is kept as a keyframe, in a budget
+    of a quarter of the delta buffer. seek() restores any pushed state still
+    covered by the deltas by starting from the next newer keyframe, and
+    keyframes older than the deltas can still be seeked to on their own.
 */
 
+#include <deque>
+#include <vector>
 #include "snes9x.h"
+#include "snapshot.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// With more than one core, deltas are generated on a worker thread. Two freeze
+// buffers let the next push go ahead while the worker reads the previous one.
+#define STATEMANAGER_IN_BUFFERS 2
 
 class StateManager {
 private:
@@ -13,23 +30,63 @@ private:
     size_t buf_size;
     size_t buf_size_mask;
     uint32_t *tmp_state;
-    uint32_t *in_state;
+    uint32_t *in_state[STATEMANAGER_IN_BUFFERS];
     size_t top_ptr;
     size_t bottom_ptr;
     size_t state_size;
     size_t real_state_size;
     bool init_done;
     bool first_pop;
+    uint32_t dirty_since[STATEMANAGER_IN_BUFFERS];
+    std::vector<SHotStateRange> ranges[STATEMANAGER_IN_BUFFERS];
+    int next_in;
+
+    struct DeltaRecord {
+        uint32_t frame; // the delta turns this push's state into the one before
+        size_t pos;     // its sentinel in buffer
+    };
+    struct Keyframe {
+        uint32_t frame;
+        std::vector<uint8_t> data;
+    };
+    std::deque<DeltaRecord> deltas;
+    std::deque<Keyframe> keyframes;
+    size_t keyframe_bytes;
+    size_t keyframe_budget;
+    uint32_t keyframe_interval;
+    uint32_t head_frame; // number of the state in tmp_state
+    uint32_t *seek_state;
+    uint32_t seek_frame;
+    bool seeked;         // seek_state is loaded and newer history is pending removal
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool thread_running;
+    bool thread_quit;
+    int job; // in_state index waiting for or being delta'd, -1 if none
+
+    void thread_loop();
+    void start_thread();
+    void stop_thread();
+    void wait_for_delta();
     
     void reassign_bottom();
-    void generate_delta(const void *data);
+    void generate_delta(const uint32_t *new_state, const std::vector<SHotStateRange> &ranges);
+    void add_keyframe();
+    bool load_keyframe(const Keyframe &k, uint32_t *state);
+    void apply_delta(const DeltaRecord &d, uint32_t *state);
+    void truncate_to_seek();
     void deallocate();
 public:
     StateManager();
     ~StateManager();
-    bool init(size_t buffer_size);
+    bool init(size_t buffer_size, uint32_t keyframe_interval = 60);
     int pop();
     bool push();
+    int seek(uint32_t frame);
+    uint32_t oldest_frame();
+    uint32_t newest_frame();
 };
 
 #endif // STATEMANAGER_H
@@ -6,6 +6,14 @@
 
 #include "tileimpl.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TILE_CONVERT_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TILE_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
 using namespace TileImpl;
 
 namespace {
@@ -14,6 +22,148 @@ namespace {
 	uint8	hrbit_odd[256];
 	uint8	hrbit_even[256];
 
+#if defined(TILE_CONVERT_SSE2) || defined(TILE_CONVERT_NEON)
+	// Vector tile converters, selected by S9xSelectTileConverter().
+	// VRAM holds a tile as pairs of bitplanes, 16 bytes per pair with the two planes of each row interleaved.
+	// Each plane byte is broadcast across the 8 pixels of its row and tested against a per-pixel bit mask,
+	// which turns two rows at a time into chunky pixels. A tile is blank when all of its plane bytes are zero.
+
+	const uint8	pixmask[16] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+
+#ifdef TILE_CONVERT_SSE2
+	inline void AddPlane (__m128i *rows, __m128i planes, __m128i mask, uint8 bit)
+	{
+		// planes holds each row twice: r0 r0 r1 r1 ... r7 r7
+		__m128i	a   = _mm_unpacklo_epi16(planes, planes);
+		__m128i	b   = _mm_unpackhi_epi16(planes, planes);
+		__m128i	val = _mm_set1_epi8(bit);
+		__m128i	pix[4];
+
+		pix[0] = _mm_unpacklo_epi32(a, a);
+		pix[1] = _mm_unpackhi_epi32(a, a);
+		pix[2] = _mm_unpacklo_epi32(b, b);
+		pix[3] = _mm_unpackhi_epi32(b, b);
+
+		for (int j = 0; j < 4; j++)
+			rows[j] = _mm_or_si128(rows[j], _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(pix[j], mask), mask), val));
+	}
+
+	uint8 ConvertPlanes (uint8 *pCache, const uint8 *tp, int pairs)
+	{
+		const __m128i	mask    = _mm_loadu_si128((const __m128i *) pixmask);
+		const __m128i	lowbyte = _mm_set1_epi16(0x00ff);
+		__m128i			rows[4], any = _mm_setzero_si128();
+
+		for (int j = 0; j < 4; j++)
+			rows[j] = _mm_setzero_si128();
+
+		for (int k = 0; k < pairs; k++)
+		{
+			__m128i	v = _mm_loadu_si128((const __m128i *) (tp + 16 * k));
+			any = _mm_or_si128(any, v);
+
+			// Low half: even plane of rows 0-7. High half: odd plane.
+			__m128i	planes = _mm_packus_epi16(_mm_and_si128(v, lowbyte), _mm_srli_epi16(v, 8));
+
+			AddPlane(rows, _mm_unpacklo_epi8(planes, planes), mask, 1 << (2 * k));
+			AddPlane(rows, _mm_unpackhi_epi8(planes, planes), mask, 1 << (2 * k + 1));
+		}
+
+		for (int j = 0; j < 4; j++)
+			_mm_storeu_si128((__m128i *) (pCache + 16 * j), rows[j]);
+
+		return (_mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) != 0xffff ? TRUE : BLANK_TILE);
+	}
+#else
+	uint8 ConvertPlanes (uint8 *pCache, const uint8 *tp, int pairs)
+	{
+		const uint8x16_t	mask = vld1q_u8(pixmask);
+		uint8x16_t			rows[4], any = vdupq_n_u8(0);
+
+		for (int j = 0; j < 4; j++)
+			rows[j] = vdupq_n_u8(0);
+
+		for (int k = 0; k < pairs; k++)
+		{
+			// val[0]: even plane of rows 0-7, val[1]: odd plane.
+			uint8x8x2_t	v = vld2_u8(tp + 16 * k);
+			any = vorrq_u8(any, vcombine_u8(v.val[0], v.val[1]));
+
+			for (int p = 0; p < 2; p++)
+			{
+				uint8x16_t	val = vdupq_n_u8(1 << (2 * k + p));
+
+				for (int j = 0; j < 4; j++)
+				{
+					uint8x16_t	pix = vcombine_u8(vtbl1_u8(v.val[p], vdup_n_u8(2 * j)), vtbl1_u8(v.val[p], vdup_n_u8(2 * j + 1)));
+					rows[j] = vorrq_u8(rows[j], vandq_u8(vtstq_u8(pix, mask), val));
+				}
+			}
+		}
+
+		for (int j = 0; j < 4; j++)
+			vst1q_u8(pCache + 16 * j, rows[j]);
+
+		uint64x2_t	nz = vreinterpretq_u64_u8(any);
+
+		return ((vgetq_lane_u64(nz, 0) | vgetq_lane_u64(nz, 1)) ? TRUE : BLANK_TILE);
+	}
+#endif
+
+	// Hires tiles take the odd or even pixels of this tile and the next one.
+	// Packing both halves into one plane byte per row gives an ordinary tile.
+	inline uint8 ConvertPlanesHires (uint8 *pCache, uint32 TileAddr, uint32 Tile, int pairs, const uint8 *hrbit)
+	{
+		uint8	*tp1 = &Memory.VRAM[TileAddr], *tp2;
+		uint8	planes[32];
+
+		if (Tile == 0x3ff)
+			tp2 = tp1 - (0x3ff << (3 + pairs));
+		else
+			tp2 = tp1 + (1 << (3 + pairs));
+
+		for (int i = 0; i < 16 * pairs; i++)
+			planes[i] = (hrbit[tp1[i]] << 4) | hrbit[tp2[i]];
+
+		return (ConvertPlanes(pCache, planes, pairs));
+	}
+
+	uint8 ConvertTile2 (uint8 *pCache, uint32 TileAddr, uint32)
+	{
+		return (ConvertPlanes(pCache, &Memory.VRAM[TileAddr], 1));
+	}
+
+	uint8 ConvertTile4 (uint8 *pCache, uint32 TileAddr, uint32)
+	{
+		return (ConvertPlanes(pCache, &Memory.VRAM[TileAddr], 2));
+	}
+
+	uint8 ConvertTile8 (uint8 *pCache, uint32 TileAddr, uint32)
+	{
+		return (ConvertPlanes(pCache, &Memory.VRAM[TileAddr], 4));
+	}
+
+	uint8 ConvertTile2h_odd (uint8 *pCache, uint32 TileAddr, uint32 Tile)
+	{
+		return (ConvertPlanesHires(pCache, TileAddr, Tile, 1, hrbit_odd));
+	}
+
+	uint8 ConvertTile4h_odd (uint8 *pCache, uint32 TileAddr, uint32 Tile)
+	{
+		return (ConvertPlanesHires(pCache, TileAddr, Tile, 2, hrbit_odd));
+	}
+
+	uint8 ConvertTile2h_even (uint8 *pCache, uint32 TileAddr, uint32 Tile)
+	{
+		return (ConvertPlanesHires(pCache, TileAddr, Tile, 1, hrbit_even));
+	}
+
+	uint8 ConvertTile4h_even (uint8 *pCache, uint32 TileAddr, uint32 Tile)
+	{
+		return (ConvertPlanesHires(pCache, TileAddr, Tile, 2, hrbit_even));
+	}
+#else
+
 	// Here are the tile converters, selected by S9xSelectTileConverter().
 	// Really, except for the definition of DOBIT and the number of times it is called, they're all the same.
 
@@ -234,6 +384,7 @@ namespace {
 	}
 
 	#undef DOBIT
+#endif
 
 } // anonymous namespace
 
@@ -340,11 +491,11 @@ void S9xSelectTileRenderers (int BGMode, bool8 sub, bool8 obj)
 	void	(**DM7BG2)	(uint32, uint32, int);
 	bool8	M7M1, M7M2;
 
-	M7M1 = PPU.BGMosaic[0] && PPU.Mosaic > 1;
-	M7M2 = PPU.BGMosaic[1] && PPU.Mosaic > 1;
+	M7M1 = RPPU.BGMosaic[0] && RPPU.Mosaic > 1;
+	M7M2 = RPPU.BGMosaic[1] && RPPU.Mosaic > 1;
 
-	bool8 interlace = obj ? FALSE : IPPU.Interlace;
-	bool8 hires = !sub && (BGMode == 5 || BGMode == 6 || IPPU.PseudoHires);
+	bool8 interlace = obj ? FALSE : RPPU.Interlace;
+	bool8 hires = !sub && (BGMode == 5 || BGMode == 6 || RPPU.PseudoHires);
 
 	if (!IPPU.DoubleWidthPixels)	// normal width
 	{
@@ -416,11 +567,11 @@ void S9xSelectTileRenderers (int BGMode, bool8 sub, bool8 obj)
 		i = 0;
 	else
 	{
-		i = (Memory.FillRAM[0x2131] & 0x80) ? 4 : 1;
-		if (Memory.FillRAM[0x2131] & 0x40)
+		i = (RPPU.Regs[0x31] & 0x80) ? 4 : 1;
+		if (RPPU.Regs[0x31] & 0x40)
 		{
 			i++;
-			if (Memory.FillRAM[0x2130] & 2)
+			if (RPPU.Regs[0x30] & 2)
 				i++;
 		}
 		if (IPPU.MaxBrightness != 0xf)
@@ -449,10 +600,12 @@ void S9xSelectTileConverter (int depth, bool8 hires, bool8 sub, bool8 mosaic)
 			BG.ConvertTile      = BG.ConvertTileFlip = ConvertTile8;
 			BG.Buffer           = BG.BufferFlip      = IPPU.TileCache[TILE_8BIT];
 			BG.Buffered         = BG.BufferedFlip    = IPPU.TileCached[TILE_8BIT];
+			BG.BufferedGen      = BG.BufferedGenFlip = IPPU.TileCachedGen[TILE_8BIT];
+			BG.CacheLines       = 4;
 			BG.TileShift        = 6;
 			BG.PaletteShift     = 0;
 			BG.PaletteMask      = 0;
-			BG.DirectColourMode = Memory.FillRAM[0x2130] & 1;
+			BG.DirectColourMode = RPPU.Regs[0x30] & 1;
 
 			break;
 
@@ -464,18 +617,22 @@ void S9xSelectTileConverter (int depth, bool8 hires, bool8 sub, bool8 mosaic)
 					BG.ConvertTile     = ConvertTile4h_even;
 					BG.Buffer          = IPPU.TileCache[TILE_4BIT_EVEN];
 					BG.Buffered        = IPPU.TileCached[TILE_4BIT_EVEN];
+					BG.BufferedGen     = IPPU.TileCachedGen[TILE_4BIT_EVEN];
 					BG.ConvertTileFlip = ConvertTile4h_odd;
 					BG.BufferFlip      = IPPU.TileCache[TILE_4BIT_ODD];
 					BG.BufferedFlip    = IPPU.TileCached[TILE_4BIT_ODD];
+					BG.BufferedGenFlip = IPPU.TileCachedGen[TILE_4BIT_ODD];
 				}
 				else
 				{
 					BG.ConvertTile     = ConvertTile4h_odd;
 					BG.Buffer          = IPPU.TileCache[TILE_4BIT_ODD];
 					BG.Buffered        = IPPU.TileCached[TILE_4BIT_ODD];
+					BG.BufferedGen     = IPPU.TileCachedGen[TILE_4BIT_ODD];
 					BG.ConvertTileFlip = ConvertTile4h_even;
 					BG.BufferFlip      = IPPU.TileCache[TILE_4BIT_EVEN];
 					BG.BufferedFlip    = IPPU.TileCached[TILE_4BIT_EVEN];
+					BG.BufferedGenFlip = IPPU.TileCachedGen[TILE_4BIT_EVEN];
 				}
 			}
 			else
@@ -483,8 +640,10 @@ void S9xSelectTileConverter (int depth, bool8 hires, bool8 sub, bool8 mosaic)
 				BG.ConvertTile = BG.ConvertTileFlip = ConvertTile4;
 				BG.Buffer      = BG.BufferFlip      = IPPU.TileCache[TILE_4BIT];
 				BG.Buffered    = BG.BufferedFlip    = IPPU.TileCached[TILE_4BIT];
+				BG.BufferedGen = BG.BufferedGenFlip = IPPU.TileCachedGen[TILE_4BIT];
 			}
 
+			BG.CacheLines       = hires ? 4 : 2;
 			BG.TileShift        = 5;
 			BG.PaletteShift     = 10 - 4;
 			BG.PaletteMask      = 7 << 4;
@@ -500,18 +659,22 @@ void S9xSelectTileConverter (int depth, bool8 hires, bool8 sub, bool8 mosaic)
 					BG.ConvertTile     = ConvertTile2h_even;
 					BG.Buffer          = IPPU.TileCache[TILE_2BIT_EVEN];
 					BG.Buffered        = IPPU.TileCached[TILE_2BIT_EVEN];
+					BG.BufferedGen     = IPPU.TileCachedGen[TILE_2BIT_EVEN];
 					BG.ConvertTileFlip = ConvertTile2h_odd;
 					BG.BufferFlip      = IPPU.TileCache[TILE_2BIT_ODD];
 					BG.BufferedFlip    = IPPU.TileCached[TILE_2BIT_ODD];
+					BG.BufferedGenFlip = IPPU.TileCachedGen[TILE_2BIT_ODD];
 				}
 				else
 				{
 					BG.ConvertTile     = ConvertTile2h_odd;
 					BG.Buffer          = IPPU.TileCache[TILE_2BIT_ODD];
 					BG.Buffered        = IPPU.TileCached[TILE_2BIT_ODD];
+					BG.BufferedGen     = IPPU.TileCachedGen[TILE_2BIT_ODD];
 					BG.ConvertTileFlip = ConvertTile2h_even;
 					BG.BufferFlip      = IPPU.TileCache[TILE_2BIT_EVEN];
 					BG.BufferedFlip    = IPPU.TileCached[TILE_2BIT_EVEN];
+					BG.BufferedGenFlip = IPPU.TileCachedGen[TILE_2BIT_EVEN];
 				}
 			}
 			else
@@ -519,8 +682,10 @@ void S9xSelectTileConverter (int depth, bool8 hires, bool8 sub, bool8 mosaic)
 				BG.ConvertTile = BG.ConvertTileFlip = ConvertTile2;
 				BG.Buffer      = BG.BufferFlip      = IPPU.TileCache[TILE_2BIT];
 				BG.Buffered    = BG.BufferedFlip    = IPPU.TileCached[TILE_2BIT];
+				BG.BufferedGen = BG.BufferedGenFlip = IPPU.TileCachedGen[TILE_2BIT];
 			}
 
+			BG.CacheLines       = hires ? 2 : 1;
 			BG.TileShift        = 4;
 			BG.PaletteShift     = 10 - 2;
 			BG.PaletteMask      = 7 << 2;
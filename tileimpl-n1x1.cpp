@@ -20,6 +20,37 @@ namespace TileImpl {
 		}
 	}
 
+#ifdef TILEIMPL_SSE2
+	template<class MATH, class BPSTART>
+	void Normal1x1Base<MATH, BPSTART>::DrawSpan8(uint32 Offset, const uint8 *Pix, bool8 SkipZero, uint8 Z1, uint8 Z2)
+	{
+		// Depth test as a byte mask: Z1 > DB, unsigned.
+		const __m128i	bias = _mm_set1_epi8((char) 0x80);
+		__m128i			db   = _mm_loadl_epi64((__m128i *) (GFX.DB + Offset));
+		__m128i			mask = _mm_cmpgt_epi8(_mm_set1_epi8((char) (Z1 ^ 0x80)), _mm_xor_si128(db, bias));
+
+		if (SkipZero)
+			mask = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadl_epi64((__m128i *) Pix), _mm_setzero_si128()), mask);
+
+		if (!(_mm_movemask_epi8(mask) & 0xff))
+			return;
+
+		uint16	main[8];
+
+		for (int x = 0; x < 8; x++)
+			main[x] = GFX.ScreenColors[Pix[x]];
+
+		__m128i	sd      = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *) (GFX.SubZBuffer + Offset)), _mm_setzero_si128());
+		__m128i	submask = _mm_cmpeq_epi16(_mm_and_si128(sd, _mm_set1_epi16(0x20)), _mm_set1_epi16(0x20));
+		__m128i	colour  = MATH::Calc8(_mm_loadu_si128((__m128i *) main), _mm_loadu_si128((__m128i *) (GFX.SubScreen + Offset)), submask);
+		__m128i	mask16  = _mm_unpacklo_epi8(mask, mask);
+		__m128i	*s      = (__m128i *) (GFX.S + Offset);
+
+		_mm_storeu_si128(s, SelectColour(mask16, colour, _mm_loadu_si128(s)));
+		_mm_storel_epi64((__m128i *) (GFX.DB + Offset), SelectColour(mask, _mm_set1_epi8((char) Z2), db));
+	}
+#endif
+
 
 	// normal width
 	template struct Renderers<DrawTile16, Normal1x1>;
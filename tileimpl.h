@@ -11,6 +11,11 @@
 #include "ppu.h"
 #include "tile.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TILEIMPL_SSE2
+#include <emmintrin.h>
+#endif
+
 extern struct SLineMatrixData	LineMatrixData[240];
 
 
@@ -39,6 +44,9 @@ namespace TileImpl {
 		typedef BPSTART bpstart_t;
 
 		static void Draw(int N, int M, uint32 Offset, uint32 OffsetInLine, uint8 Pix, uint8 Z1, uint8 Z2);
+	#ifdef TILEIMPL_SSE2
+		static void DrawSpan8(uint32 Offset, const uint8 *Pix, bool8 SkipZero, uint8 Z1, uint8 Z2);
+	#endif
 	};
 
 	template<class MATH>
@@ -99,15 +107,45 @@ namespace TileImpl {
 			if (Tile & H_FLIP)
 			{
 				pCache = &BG.BufferFlip[TileNumber << 6];
-				if (!BG.BufferedFlip[TileNumber])
+				if (IsStale(BG.BufferedGenFlip[TileNumber]))
+				{
 					BG.BufferedFlip[TileNumber] = BG.ConvertTileFlip(pCache, TileAddr, Tile & 0x3ff);
+					Stamp(BG.BufferedGenFlip[TileNumber]);
+				}
 			}
 			else
 			{
 				pCache = &BG.Buffer[TileNumber << 6];
-				if (!BG.Buffered[TileNumber])
+				if (IsStale(BG.BufferedGen[TileNumber]))
+				{
 					BG.Buffered[TileNumber] = BG.ConvertTile(pCache, TileAddr, Tile & 0x3ff);
+					Stamp(BG.BufferedGen[TileNumber]);
+				}
+			}
+		}
+
+		// A converted tile is good until the cache is flushed or one of the
+		// 16-byte VRAM lines it was built from is written after it.
+		alwaysinline bool IsStale(uint32 built) const
+		{
+			if (built < IPPU.TileFlushGen)
+				return (true);
+
+			uint32 line = TileAddr >> 4;
+			for (uint32 l = 0; l < BG.CacheLines; l++)
+			{
+				if (built < IPPU.VRAMLineGen[(line + l) & 0xfff])
+					return (true);
 			}
+
+			return (false);
+		}
+
+		alwaysinline void Stamp(uint32 &built) const
+		{
+			built = IPPU.TileGen;
+			if (++IPPU.TileGen == 0xffffffff)
+				S9xFlushTileCache();
 		}
 
 		alwaysinline bool IsBlankTile() const
@@ -122,7 +160,7 @@ namespace TileImpl {
 				GFX.RealScreenColors = DirectColourMaps[(Tile >> 10) & 7];
 			}
 			else
-				GFX.RealScreenColors = &IPPU.ScreenColors[((Tile >> BG.PaletteShift) & BG.PaletteMask) + BG.StartPalette];
+				GFX.RealScreenColors = &RPPU.ScreenColors[((Tile >> BG.PaletteShift) & BG.PaletteMask) + BG.StartPalette];
 			GFX.ScreenColors = GFX.ClipColors ? BlackColourMap : GFX.RealScreenColors;
 		}
 
@@ -139,12 +177,124 @@ namespace TileImpl {
 	};
 
 
+#ifdef TILEIMPL_SSE2
+	// Colour math on 8 pixels at once, giving the same results as the COLOR_* functions in gfx.h.
+	// Red, green and blue are split into 16-bit lanes so that saturation is a plain min or subs.
+
+	static alwaysinline __m128i SelectColour(__m128i Mask, __m128i A, __m128i B)
+	{
+		return _mm_or_si128(_mm_and_si128(Mask, A), _mm_andnot_si128(Mask, B));
+	}
+
+	static alwaysinline __m128i AddColours(__m128i C1, __m128i C2, int Cap)
+	{
+		const __m128i	mask = _mm_set1_epi16(0x1f);
+		const __m128i	cap  = _mm_set1_epi16(Cap);
+
+		__m128i	r = _mm_min_epi16(_mm_add_epi16(_mm_and_si128(_mm_srli_epi16(C1, RED_SHIFT_BITS), mask), _mm_and_si128(_mm_srli_epi16(C2, RED_SHIFT_BITS), mask)), cap);
+		__m128i	g = _mm_min_epi16(_mm_add_epi16(_mm_and_si128(_mm_srli_epi16(C1, GREEN_SHIFT_BITS), mask), _mm_and_si128(_mm_srli_epi16(C2, GREEN_SHIFT_BITS), mask)), cap);
+		__m128i	b = _mm_min_epi16(_mm_add_epi16(_mm_and_si128(C1, mask), _mm_and_si128(C2, mask)), cap);
+		__m128i	rgb = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, RED_SHIFT_BITS), _mm_slli_epi16(g, GREEN_SHIFT_BITS)), b);
+	#if GREEN_SHIFT_BITS == 6
+		rgb = _mm_or_si128(rgb, _mm_slli_epi16(_mm_and_si128(g, _mm_set1_epi16(0x10)), 1));
+	#endif
+		return rgb;
+	}
+
+	static alwaysinline __m128i AddColoursHalf(__m128i C1, __m128i C2)
+	{
+		// The low bits are masked off, so the rounding in avg never kicks in.
+		const __m128i	hi  = _mm_set1_epi16((short) RGB_REMOVE_LOW_BITS_MASK);
+		const __m128i	low = _mm_set1_epi16((short) RGB_LOW_BITS_MASK);
+
+		__m128i	avg = _mm_avg_epu16(_mm_and_si128(C1, hi), _mm_and_si128(C2, hi));
+		return _mm_or_si128(_mm_add_epi16(avg, _mm_and_si128(_mm_and_si128(C1, C2), low)), _mm_set1_epi16((short) ALPHA_BITS_MASK));
+	}
+
+	static alwaysinline __m128i SubColours(__m128i C1, __m128i C2)
+	{
+		const __m128i	mask  = _mm_set1_epi16(0x1f);
+		const __m128i	green = _mm_set1_epi16((short) SECOND_COLOR_MASK);
+
+		__m128i	r = _mm_subs_epu16(_mm_and_si128(_mm_srli_epi16(C1, RED_SHIFT_BITS), mask), _mm_and_si128(_mm_srli_epi16(C2, RED_SHIFT_BITS), mask));
+		__m128i	g = _mm_subs_epu16(_mm_srli_epi16(_mm_and_si128(C1, green), 5), _mm_srli_epi16(_mm_and_si128(C2, green), 5));
+		__m128i	b = _mm_subs_epu16(_mm_and_si128(C1, mask), _mm_and_si128(C2, mask));
+		__m128i	rgb = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, RED_SHIFT_BITS), _mm_and_si128(_mm_slli_epi16(g, 5), green)), b);
+	#if GREEN_SHIFT_BITS == 6
+		rgb = _mm_or_si128(_mm_andnot_si128(_mm_set1_epi16(0x20), rgb), _mm_srli_epi16(_mm_and_si128(rgb, _mm_set1_epi16(0x400)), 5));
+	#endif
+		return rgb;
+	}
+
+	// Lane-by-lane fallback for ops that have no vector form.
+	template<class Op>
+	struct SCALARMATH
+	{
+		static alwaysinline __m128i fn(__m128i C1, __m128i C2)
+		{
+			uint16	a[8], b[8];
+
+			_mm_storeu_si128((__m128i *) a, C1);
+			_mm_storeu_si128((__m128i *) b, C2);
+			for (int i = 0; i < 8; i++)
+				a[i] = Op::fn(a[i], b[i]);
+
+			return _mm_loadu_si128((__m128i *) a);
+		}
+
+		static alwaysinline __m128i fn1_2(__m128i C1, __m128i C2)
+		{
+			uint16	a[8], b[8];
+
+			_mm_storeu_si128((__m128i *) a, C1);
+			_mm_storeu_si128((__m128i *) b, C2);
+			for (int i = 0; i < 8; i++)
+				a[i] = Op::fn1_2(a[i], b[i]);
+
+			return _mm_loadu_si128((__m128i *) a);
+		}
+	};
+
+	template<class Op>
+	struct VECMATH;
+
+	template<>
+	struct VECMATH<COLOR_ADD>
+	{
+		static alwaysinline __m128i fn(__m128i C1, __m128i C2) { return AddColours(C1, C2, 0x1f); }
+		static alwaysinline __m128i fn1_2(__m128i C1, __m128i C2) { return AddColoursHalf(C1, C2); }
+	};
+
+	template<>
+	struct VECMATH<COLOR_ADD_BRIGHTNESS>
+	{
+		// brightness_cap[] is min(i, IPPU.XB[0x1f]), so its last entry is the cap itself.
+		static alwaysinline __m128i fn(__m128i C1, __m128i C2) { return AddColours(C1, C2, brightness_cap[63]); }
+		static alwaysinline __m128i fn1_2(__m128i C1, __m128i C2) { return AddColoursHalf(C1, C2); }
+	};
+
+	template<>
+	struct VECMATH<COLOR_SUB>
+	{
+		// The half subtraction goes through the GFX.ZERO table, so that one stays scalar.
+		static alwaysinline __m128i fn(__m128i C1, __m128i C2) { return SubColours(C1, C2); }
+		static alwaysinline __m128i fn1_2(__m128i C1, __m128i C2) { return SCALARMATH<COLOR_SUB>::fn1_2(C1, C2); }
+	};
+#endif
+
 	struct NOMATH
 	{
 		static alwaysinline uint16 Calc(uint16 Main, uint16 Sub, uint8 SD)
 		{
 			return Main;
 		}
+
+	#ifdef TILEIMPL_SSE2
+		static alwaysinline __m128i Calc8(__m128i Main, __m128i Sub, __m128i SubMask)
+		{
+			return Main;
+		}
+	#endif
 	};
 	typedef NOMATH Blend_None;
 
@@ -155,6 +305,13 @@ namespace TileImpl {
 		{
 			return Op::fn(Main, (SD & 0x20) ? Sub : GFX.FixedColour);
 		}
+
+	#ifdef TILEIMPL_SSE2
+		static alwaysinline __m128i Calc8(__m128i Main, __m128i Sub, __m128i SubMask)
+		{
+			return VECMATH<Op>::fn(Main, SelectColour(SubMask, Sub, _mm_set1_epi16(GFX.FixedColour)));
+		}
+	#endif
 	};
 	typedef REGMATH<COLOR_ADD> Blend_Add;
 	typedef REGMATH<COLOR_SUB> Blend_Sub;
@@ -167,6 +324,14 @@ namespace TileImpl {
 		{
 			return GFX.ClipColors ? Op::fn(Main, GFX.FixedColour) : Op::fn1_2(Main, GFX.FixedColour);
 		}
+
+	#ifdef TILEIMPL_SSE2
+		static alwaysinline __m128i Calc8(__m128i Main, __m128i Sub, __m128i SubMask)
+		{
+			__m128i	fixed = _mm_set1_epi16(GFX.FixedColour);
+			return GFX.ClipColors ? VECMATH<Op>::fn(Main, fixed) : VECMATH<Op>::fn1_2(Main, fixed);
+		}
+	#endif
 	};
 	typedef MATHF1_2<COLOR_ADD> Blend_AddF1_2;
 	typedef MATHF1_2<COLOR_SUB> Blend_SubF1_2;
@@ -178,6 +343,16 @@ namespace TileImpl {
 		{
 			return GFX.ClipColors ? REGMATH<Op>::Calc(Main, Sub, SD) : (SD & 0x20) ? Op::fn1_2(Main, Sub) : Op::fn(Main, GFX.FixedColour);
 		}
+
+	#ifdef TILEIMPL_SSE2
+		static alwaysinline __m128i Calc8(__m128i Main, __m128i Sub, __m128i SubMask)
+		{
+			if (GFX.ClipColors)
+				return REGMATH<Op>::Calc8(Main, Sub, SubMask);
+
+			return SelectColour(SubMask, VECMATH<Op>::fn1_2(Main, Sub), VECMATH<Op>::fn(Main, _mm_set1_epi16(GFX.FixedColour)));
+		}
+	#endif
 	};
 	typedef MATHS1_2<COLOR_ADD> Blend_AddS1_2;
 	typedef MATHS1_2<COLOR_SUB> Blend_SubS1_2;
@@ -214,6 +389,42 @@ namespace TileImpl {
 	};
 	#endif
 
+	// Draws 8 consecutive pixels from Pix[0..7], or Pix[7..0] if Flip is set.
+	// Colour 0 is skipped if SkipZero is set, as for tiles; the backdrop draws it.
+	// Plotters that can do a whole span at once specialise this.
+	template<class PIXEL>
+	struct Span8
+	{
+		static alwaysinline void Draw(int N, uint32 Offset, uint32 OffsetInLine, const uint8 *Pix, bool8 Flip, bool8 SkipZero, uint8 Z1, uint8 Z2)
+		{
+			for (int x = 0; x < 8; x++)
+			{
+				uint8	p = Pix[Flip ? 7 - x : x];
+				PIXEL::Draw(N + x, SkipZero ? p : 1, Offset, OffsetInLine, p, Z1, Z2);
+			}
+		}
+	};
+
+	#ifdef TILEIMPL_SSE2
+	template<class MATH>
+	struct Span8< Normal1x1<MATH> >
+	{
+		static alwaysinline void Draw(int N, uint32 Offset, uint32 OffsetInLine, const uint8 *Pix, bool8 Flip, bool8 SkipZero, uint8 Z1, uint8 Z2)
+		{
+			if (Flip)
+			{
+				uint8	rev[8];
+
+				for (int x = 0; x < 8; x++)
+					rev[x] = Pix[7 - x];
+				Normal1x1<MATH>::DrawSpan8(Offset + N, rev, SkipZero, Z1, Z2);
+			}
+			else
+				Normal1x1<MATH>::DrawSpan8(Offset + N, Pix, SkipZero, Z1, Z2);
+		}
+	};
+	#endif
+
 	// Basic routine to render an unclipped tile.
 	// Input parameters:
 	//     bpstart_t = either StartLine or (StartLine * 2 + BG.InterlaceLine),
@@ -243,7 +454,7 @@ namespace TileImpl {
 		{
 			CachedTile cache(Tile);
 			int32	l;
-			uint8	*bp, Pix;
+			uint8	*bp;
 
 			cache.GetCachedTile();
 			if (cache.IsBlankTile())
@@ -256,9 +467,7 @@ namespace TileImpl {
 				OFFSET_IN_LINE;
 				for (l = LineCount; l > 0; l--, bp += 8 * Pitch, Offset += GFX.PPL)
 				{
-					for (int x = 0; x < 8; x++) {
-						Pix = bp[x]; DRAW_PIXEL(x, Pix);
-					}
+					Span8<PIXEL>::Draw(0, Offset, OffsetInLine, bp, FALSE, TRUE, Z1, Z2);
 				}
 			}
 			else
@@ -268,9 +477,7 @@ namespace TileImpl {
 				OFFSET_IN_LINE;
 				for (l = LineCount; l > 0; l--, bp += 8 * Pitch, Offset += GFX.PPL)
 				{
-					for (int x = 0; x < 8; x++) {
-						Pix = bp[7 - x]; DRAW_PIXEL(x, Pix);
-					}
+					Span8<PIXEL>::Draw(0, Offset, OffsetInLine, bp, TRUE, TRUE, Z1, Z2);
 				}
 			}
 			else
@@ -280,9 +487,7 @@ namespace TileImpl {
 				OFFSET_IN_LINE;
 				for (l = LineCount; l > 0; l--, bp -= 8 * Pitch, Offset += GFX.PPL)
 				{
-					for (int x = 0; x < 8; x++) {
-						Pix = bp[x]; DRAW_PIXEL(x, Pix);
-					}
+					Span8<PIXEL>::Draw(0, Offset, OffsetInLine, bp, FALSE, TRUE, Z1, Z2);
 				}
 			}
 			else
@@ -291,9 +496,7 @@ namespace TileImpl {
 				OFFSET_IN_LINE;
 				for (l = LineCount; l > 0; l--, bp -= 8 * Pitch, Offset += GFX.PPL)
 				{
-					for (int x = 0; x < 8; x++) {
-						Pix = bp[7 - x]; DRAW_PIXEL(x, Pix);
-					}
+					Span8<PIXEL>::Draw(0, Offset, OffsetInLine, bp, TRUE, TRUE, Z1, Z2);
 				}
 			}
 		}
@@ -479,15 +682,19 @@ namespace TileImpl {
 		{
 			uint32	l, x;
 
-			GFX.RealScreenColors = IPPU.ScreenColors;
+			GFX.RealScreenColors = RPPU.ScreenColors;
 			GFX.ScreenColors = GFX.ClipColors ? BlackColourMap : GFX.RealScreenColors;
 			if (Settings.ForcedBackdrop)
 				GFX.ScreenColors = &Settings.ForcedBackdrop;
 
+			static const uint8	Backdrop[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
 			OFFSET_IN_LINE;
 			for (l = GFX.StartY; l <= GFX.EndY; l++, Offset += GFX.PPL)
 			{
-				for (x = Left; x < Right; x++)
+				for (x = Left; x + 8 <= Right; x += 8)
+					Span8<PIXEL>::Draw(x, Offset, OffsetInLine, Backdrop, FALSE, FALSE, Z1, Z2);
+				for (; x < Right; x++)
 					DRAW_PIXEL(x, 1);
 			}
 		}
@@ -518,7 +725,7 @@ namespace TileImpl {
 		};
 		static uint8 Z1(int D, uint8 b) { return D + 7; }
 		static uint8 Z2(int D, uint8 b) { return D + 7; }
-		static uint8 DCMODE() { return Memory.FillRAM[0x2130] & 1; }
+		static uint8 DCMODE() { return RPPU.Regs[0x30] & 1; }
 	};
 	struct DrawMode7BG2_OP
 	{
@@ -545,7 +752,7 @@ namespace TileImpl {
 				GFX.RealScreenColors = DirectColourMaps[0];
 			}
 			else
-				GFX.RealScreenColors = IPPU.ScreenColors;
+				GFX.RealScreenColors = RPPU.ScreenColors;
 
 			GFX.ScreenColors = GFX.ClipColors ? BlackColourMap : GFX.RealScreenColors;
 
@@ -566,7 +773,7 @@ namespace TileImpl {
 				int32	CentreX = ((int32) l->CentreX << 19) >> 19;
 				int32	CentreY = ((int32) l->CentreY << 19) >> 19;
 
-				if (PPU.Mode7VFlip)
+				if (RPPU.Mode7VFlip)
 					starty = 255 - (int) (Line + 1);
 				else
 					starty = Line + 1;
@@ -576,7 +783,7 @@ namespace TileImpl {
 				int	BB = ((l->MatrixB * starty) & ~63) + ((l->MatrixB * yy) & ~63) + (CentreX << 8);
 				int	DD = ((l->MatrixD * starty) & ~63) + ((l->MatrixD * yy) & ~63) + (CentreY << 8);
 
-				if (PPU.Mode7HFlip)
+				if (RPPU.Mode7HFlip)
 				{
 					startx = Right - 1;
 					aa = -l->MatrixA;
@@ -595,7 +802,7 @@ namespace TileImpl {
 
 				uint8	Pix;
 
-				if (!PPU.Mode7Repeat)
+				if (!RPPU.Mode7Repeat)
 				{
 					for (uint32 x = Left; x < Right; x++, AA += aa, CC += cc)
 					{
@@ -623,7 +830,7 @@ namespace TileImpl {
 							b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1));
 						}
 						else
-						if (PPU.Mode7Repeat == 3)
+						if (RPPU.Mode7Repeat == 3)
 							b = *(VRAM1    + ((Y & 7) << 4) + ((X & 7) << 1));
 						else
 							continue;
@@ -654,7 +861,7 @@ namespace TileImpl {
 				GFX.RealScreenColors = DirectColourMaps[0];
 			}
 			else
-				GFX.RealScreenColors = IPPU.ScreenColors;
+				GFX.RealScreenColors = RPPU.ScreenColors;
 
 			GFX.ScreenColors = GFX.ClipColors ? BlackColourMap : GFX.RealScreenColors;
 
@@ -664,16 +871,16 @@ namespace TileImpl {
 			int		HMosaic = 1, VMosaic = 1, MosaicStart = 0;
 			int32	MLeft = Left, MRight = Right;
 
-			if (PPU.BGMosaic[0])
+			if (RPPU.BGMosaic[0])
 			{
-				VMosaic = PPU.Mosaic;
-				MosaicStart = ((uint32) GFX.StartY - PPU.MosaicStart) % VMosaic;
+				VMosaic = RPPU.Mosaic;
+				MosaicStart = ((uint32) GFX.StartY - RPPU.MosaicStart) % VMosaic;
 				StartY -= MosaicStart;
 			}
 
-			if (PPU.BGMosaic[OP::BG])
+			if (RPPU.BGMosaic[OP::BG])
 			{
-				HMosaic = PPU.Mosaic;
+				HMosaic = RPPU.Mosaic;
 				MLeft  -= MLeft  % HMosaic;
 				MRight += HMosaic - 1;
 				MRight -= MRight % HMosaic;
@@ -696,7 +903,7 @@ namespace TileImpl {
 				int32	CentreX = ((int32) l->CentreX << 19) >> 19;
 				int32	CentreY = ((int32) l->CentreY << 19) >> 19;
 
-				if (PPU.Mode7VFlip)
+				if (RPPU.Mode7VFlip)
 					starty = 255 - (int) (Line + 1);
 				else
 					starty = Line + 1;
@@ -706,7 +913,7 @@ namespace TileImpl {
 				int	BB = ((l->MatrixB * starty) & ~63) + ((l->MatrixB * yy) & ~63) + (CentreX << 8);
 				int	DD = ((l->MatrixD * starty) & ~63) + ((l->MatrixD * yy) & ~63) + (CentreY << 8);
 
-				if (PPU.Mode7HFlip)
+				if (RPPU.Mode7HFlip)
 				{
 					startx = MRight - 1;
 					aa = -l->MatrixA;
@@ -726,7 +933,7 @@ namespace TileImpl {
 				uint8	Pix;
 				uint8	ctr = 1;
 
-				if (!PPU.Mode7Repeat)
+				if (!RPPU.Mode7Repeat)
 				{
 					for (int32 x = MLeft; x < MRight; x++, AA += aa, CC += cc)
 					{
@@ -769,7 +976,7 @@ namespace TileImpl {
 							b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1));
 						}
 						else
-						if (PPU.Mode7Repeat == 3)
+						if (RPPU.Mode7Repeat == 3)
 							b = *(VRAM1    + ((Y & 7) << 4) + ((X & 7) << 1));
 						else
 							continue;
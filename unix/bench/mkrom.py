@@ -0,0 +1,305 @@
+#!/usr/bin/env python3
+# Builds synthetic.sfc, the freely redistributable benchmark workload listed in
+# ../benchmark.txt. It is a 32 KB LoROM image that switches between BG modes 1,
+# 5 and 7 with colour math, sprites, DMA and HDMA. Its NMI handler reacts to the
+# joypad and rewrites VRAM every frame, and it uploads an SPC700 program that
+# plays BRR voices through pitch modulation and echo. The output is
+# deterministic, so rerunning this script reproduces the committed image:
+#
+#   python3 mkrom.py synthetic.sfc
+import random, struct, sys
+
+random.seed(1234)
+
+class Asm:
+    def __init__(self, base):
+        self.base = base
+        self.code = bytearray()
+        self.labels = {}
+        self.fix = []
+    def pc(self):
+        return self.base + len(self.code)
+    def L(self, name):
+        self.labels[name] = self.pc()
+    def b(self, *bs):
+        for x in bs:
+            self.code.append(x & 0xff)
+    def w(self, v):
+        self.b(v, v >> 8)
+    def rel(self, op, label):
+        self.b(op)
+        self.fix.append(('rel', len(self.code), label))
+        self.b(0)
+    def abs_(self, op, label):
+        self.b(op)
+        self.fix.append(('abs', len(self.code), label))
+        self.b(0, 0)
+    def resolve(self):
+        for kind, off, label in self.fix:
+            t = self.labels[label]
+            if kind == 'rel':
+                d = t - (self.base + off + 1)
+                assert -128 <= d < 128, label
+                self.code[off] = d & 0xff
+            else:
+                self.code[off] = t & 0xff
+                self.code[off + 1] = (t >> 8) & 0xff
+
+# ---------------- SPC700 program ----------------
+spc = Asm(0x0400)
+def dsp(reg, val):
+    spc.b(0x8F, reg, 0xF2)
+    spc.b(0x8F, val, 0xF3)
+dsp(0x6C, 0x20)          # FLG: echo write off while setting up
+dsp(0x5D, 0x02)          # DIR = $0200
+for v, (vol, pitch) in enumerate([(0x50, 0x10), (0x30, 0x08), (0x28, 0x18)]):
+    r = v << 4
+    dsp(r + 0, vol); dsp(r + 1, vol)
+    dsp(r + 2, 0x00); dsp(r + 3, pitch)
+    dsp(r + 4, v % 2)
+    dsp(r + 5, 0x8E + v); dsp(r + 6, 0xE0 - v * 0x20)
+dsp(0x0C, 0x7F); dsp(0x1C, 0x7F)
+dsp(0x2C, 0x30); dsp(0x3C, 0x30)
+dsp(0x0D, 0x40)
+for i, c in enumerate([0x7F, 0x10, 0xF0, 0x08, 0x00, 0x00, 0x00, 0x00]):
+    dsp(0x0F + i * 0x10, c)
+dsp(0x2D, 0x02)          # PMON voice 1
+dsp(0x3D, 0x00)
+dsp(0x4D, 0x03)          # EON
+dsp(0x6D, 0x60)          # ESA
+dsp(0x7D, 0x02)          # EDL
+dsp(0x6C, 0x00)          # FLG: echo on, unmute
+dsp(0x4C, 0x07)          # KON
+spc.L('loop')
+spc.b(0xE4, 0xF4)        # mov a,$f4
+spc.b(0x8F, 0x03, 0xF2)  # mov $f2,#$03
+spc.b(0xC4, 0xF3)        # mov $f3,a
+spc.b(0xC4, 0xF5)        # mov $f5,a
+spc.b(0x68, 0x80)        # cmp a,#$80
+spc.rel(0xD0, 'loop')    # bne loop
+dsp(0x4C, 0x04)          # re-key voice 2
+spc.rel(0x2F, 'loop')
+spc.resolve()
+
+# directory at $0200 and BRR samples at $0300
+spcdata = []
+dirtab = bytes([0x00, 0x03, 0x00, 0x03, 0x12, 0x03, 0x1B, 0x03])
+spcdata.append((0x0200, dirtab))
+brr = bytearray()
+brr += bytes([0xB0] + [0x77] * 4 + [0x99] * 4)
+brr += bytes([0xB7] + [0x17, 0x71, 0x99, 0x11, 0xF1, 0x1F, 0x88, 0x07])
+brr += bytes([0xA8] + [random.randrange(256) for _ in range(8)])
+brr += bytes([0x94] + [random.randrange(256) for _ in range(8)])
+brr += bytes([0xCF] + [random.randrange(256) for _ in range(8)])
+spcdata.append((0x0300, bytes(brr)))
+spcdata.append((0x0400, bytes(spc.code)))
+
+# ---------------- 65816 program ----------------
+cpu = Asm(0x8000)
+def lda_imm(v): cpu.b(0xA9, v)
+def sta(a): cpu.b(0x8D, a & 0xff, a >> 8)
+def stz(a): cpu.b(0x9C, a & 0xff, a >> 8)
+def w8(a, v): lda_imm(v); sta(a)
+
+cpu.L('reset')
+cpu.b(0x78, 0x18, 0xFB)            # sei clc xce
+cpu.b(0xC2, 0x30)                  # rep #$30
+cpu.b(0xA2); cpu.w(0x1FFF); cpu.b(0x9A)   # ldx #$1fff txs
+cpu.b(0xA9); cpu.w(0x0000); cpu.b(0x5B)   # lda #0 tcd
+cpu.b(0xE2, 0x30)                  # sep #$30
+w8(0x2100, 0x80)
+stz(0x4200)
+w8(0x2105, 0x01)
+w8(0x2107, 0x20)                   # BG1 map at word $2000
+w8(0x2108, 0x24)
+w8(0x210B, 0x00)
+w8(0x2101, 0x62)                   # OBJ chr base
+w8(0x212C, 0x13)
+w8(0x212D, 0x02)
+w8(0x2130, 0x02)
+w8(0x2131, 0x41)
+w8(0x211A, 0x00)
+for r, v in [(0x211B, 0x00), (0x211B, 0x01), (0x211E, 0x00), (0x211E, 0x01)]:
+    w8(r, v)
+
+def dma(src_label, size, dest, mode, vaddr=None, cgaddr=None):
+    if vaddr is not None:
+        w8(0x2115, 0x80)
+        w8(0x2116, vaddr & 0xff); w8(0x2117, vaddr >> 8)
+    if cgaddr is not None:
+        w8(0x2121, cgaddr)
+    w8(0x4300, mode); w8(0x4301, dest)
+    cpu.b(0xC2, 0x20)
+    cpu.abs_(0xA9, src_label)      # lda #src (16-bit)
+    cpu.b(0x8D, 0x02, 0x43)
+    cpu.b(0xA9); cpu.w(size)
+    cpu.b(0x8D, 0x05, 0x43)
+    cpu.b(0xE2, 0x20)
+    w8(0x4304, 0x00)
+    w8(0x420B, 0x01)
+
+dma('tiles', 0x4000, 0x18, 0x01, vaddr=0x0000)
+dma('tiles', 0x4000, 0x18, 0x01, vaddr=0x6000)
+dma('tmap', 0x1000, 0x18, 0x01, vaddr=0x2000)
+dma('pal', 0x200, 0x22, 0x00, cgaddr=0)
+w8(0x2102, 0); w8(0x2103, 0)
+dma('oam', 0x220, 0x04, 0x00)
+
+# APU upload through the IPL protocol
+cpu.L('ipl_wait')
+cpu.b(0xAD, 0x40, 0x21, 0xC9, 0xAA); cpu.rel(0xD0, 'ipl_wait')
+cpu.b(0xAD, 0x41, 0x21, 0xC9, 0xBB); cpu.rel(0xD0, 'ipl_wait')
+first = True
+for addr, blob in spcdata:
+    w8(0x2142, addr & 0xff); w8(0x2143, addr >> 8)
+    w8(0x2141, 0x01)
+    if first:
+        w8(0x2140, 0xCC)
+        kick = 0xCC
+        first = False
+    else:
+        # kick = previous counter + 2 (non-zero)
+        cpu.b(0xA5, 0x20, 0x18, 0x69, 0x02)   # lda $20 clc adc #2
+        cpu.rel(0xD0, 'nz%04x' % addr)
+        cpu.b(0x1A)                           # inc a
+        cpu.L('nz%04x' % addr)
+        cpu.b(0x8D, 0x40, 0x21, 0x85, 0x21)   # sta $2140 sta $21
+        kick = None
+    lbl = 'k%04x' % addr
+    cpu.L(lbl)
+    if kick is not None:
+        cpu.b(0xAD, 0x40, 0x21, 0xC9, 0xCC)
+    else:
+        cpu.b(0xAD, 0x40, 0x21, 0xC5, 0x21)
+    cpu.rel(0xD0, lbl)
+    # byte loop: x = index (16-bit)
+    cpu.b(0xC2, 0x10)
+    cpu.b(0xA2); cpu.w(0)
+    cpu.L('bl%04x' % addr)
+    cpu.abs_(0xBD, 'spc%04x' % addr)          # lda blob,x
+    cpu.b(0x8D, 0x41, 0x21)
+    cpu.b(0x8A, 0x8D, 0x40, 0x21)             # txa sta $2140
+    cpu.L('bw%04x' % addr)
+    cpu.b(0xCD, 0x40, 0x21)                   # cmp $2140
+    cpu.rel(0xD0, 'bw%04x' % addr)
+    cpu.b(0x85, 0x20)                         # sta $20 (last counter)
+    cpu.b(0xE8, 0xE0); cpu.w(len(blob))
+    cpu.rel(0xD0, 'bl%04x' % addr)
+    cpu.b(0xE2, 0x10)
+w8(0x2142, 0x00); w8(0x2143, 0x04)
+stz(0x2141)
+cpu.b(0xA5, 0x20, 0x18, 0x69, 0x02)
+cpu.rel(0xD0, 'startnz'); cpu.b(0x1A); cpu.L('startnz')
+cpu.b(0x8D, 0x40, 0x21)
+
+# HDMA channel 1: per-line BG1 HOFS from a table
+w8(0x4310, 0x02); w8(0x4311, 0x0D)
+cpu.b(0xC2, 0x20); cpu.abs_(0xA9, 'hdma'); cpu.b(0x8D, 0x12, 0x43, 0xE2, 0x20)
+w8(0x4314, 0x00)
+w8(0x420C, 0x02)
+
+w8(0x2100, 0x0F)
+w8(0x4200, 0x81)
+cpu.b(0x58)                                   # cli
+
+# main: busy loop over WRAM so the CPU core stays hot
+cpu.L('main')
+cpu.b(0xC2, 0x30)
+cpu.b(0xA2); cpu.w(0)
+cpu.L('ml')
+cpu.b(0xBF, 0x00, 0x20, 0x7E)                 # lda $7e2000,x
+cpu.b(0x18, 0x65, 0x30)                       # clc adc $30
+cpu.b(0x4A)                                   # lsr
+cpu.b(0x9F, 0x00, 0x20, 0x7E)                 # sta $7e2000,x
+cpu.b(0x85, 0x30)                             # sta $30
+cpu.b(0xE8, 0xE8, 0xE0); cpu.w(0x0800)
+cpu.rel(0xD0, 'ml')
+cpu.b(0xE2, 0x30)
+cpu.abs_(0x4C, 'main')
+
+cpu.L('nmi')
+cpu.b(0xC2, 0x30, 0x48, 0xDA, 0x5A)           # rep #$30 pha phx phy
+cpu.b(0xE2, 0x30)
+cpu.b(0xAD, 0x10, 0x42)                       # lda $4210 (ack)
+cpu.b(0xE6, 0x10)                             # inc $10
+cpu.b(0xA5, 0x10, 0x8D, 0x0D, 0x21, 0x9C, 0x0D, 0x21)
+cpu.b(0xA5, 0x10, 0x4A, 0x8D, 0x0E, 0x21, 0x9C, 0x0E, 0x21)
+cpu.b(0xAD, 0x19, 0x42)                       # joypad high byte
+cpu.b(0x45, 0x10, 0x29, 0x1F, 0x09, 0x20, 0x8D, 0x32, 0x21)  # fixed colour R
+cpu.b(0xAD, 0x18, 0x42, 0x09, 0x80, 0x8D, 0x32, 0x21)        # joypad low -> fixed blue
+# palette entry 1 animates
+cpu.b(0xA9, 0x01, 0x8D, 0x21, 0x21)
+cpu.b(0xA5, 0x10, 0x8D, 0x22, 0x21, 0x4A, 0x8D, 0x22, 0x21)
+# rewrite a VRAM word each frame (tile cache invalidation)
+cpu.b(0xA9, 0x80, 0x8D, 0x15, 0x21)
+cpu.b(0xA5, 0x10, 0x8D, 0x16, 0x21, 0x9C, 0x17, 0x21)
+cpu.b(0xA5, 0x10, 0x8D, 0x18, 0x21, 0x8D, 0x19, 0x21)
+# mode select: frames 64..127 of every 128 use mode 7 (mode 5 when B held)
+cpu.b(0xA5, 0x10, 0x29, 0x40)
+cpu.rel(0xF0, 'm1')
+cpu.b(0xAD, 0x19, 0x42, 0x29, 0x80)
+cpu.rel(0xD0, 'm5')
+cpu.b(0xA9, 0x07, 0x8D, 0x05, 0x21)
+cpu.b(0xA5, 0x10, 0x8D, 0x1C, 0x21, 0x9C, 0x1C, 0x21)  # M7B
+cpu.rel(0x80, 'mdone')
+cpu.L('m5')
+cpu.b(0xA9, 0x05, 0x8D, 0x05, 0x21, 0xA9, 0x09, 0x8D, 0x33, 0x21)
+cpu.rel(0x80, 'mdone')
+cpu.L('m1')
+cpu.b(0xA9, 0x01, 0x8D, 0x05, 0x21, 0x9C, 0x33, 0x21)
+cpu.L('mdone')
+# APU port: pitch from frame counter; read back port 1
+cpu.b(0xA5, 0x10, 0x4A, 0x4A, 0x09, 0x04, 0x8D, 0x40, 0x21)
+cpu.b(0xAD, 0x41, 0x21, 0x85, 0x12)
+# re-arm HDMA
+w8(0x420C, 0x02)
+cpu.b(0xC2, 0x30, 0x7A, 0xFA, 0x68, 0x40)     # rep; ply plx pla rti
+
+cpu.L('irq')
+cpu.b(0x40)
+
+# data
+cpu.L('hdma')
+for i in range(28):
+    cpu.b(8, random.randrange(256), 0)
+cpu.b(0)
+for addr, blob in spcdata:
+    cpu.L('spc%04x' % addr)
+    cpu.b(*blob)
+cpu.L('pal')
+cpu.b(*[random.randrange(256) for _ in range(0x200)])
+cpu.L('oam')
+oam = bytearray()
+for i in range(128):
+    oam += bytes([random.randrange(256), random.randrange(224), random.randrange(256), random.randrange(256) & 0x3F | 0x30])
+oam += bytes(random.randrange(256) & 0xAA for _ in range(32))
+cpu.b(*oam)
+cpu.L('tmap')
+cpu.b(*[random.randrange(256) for _ in range(0x1000)])
+
+cpu.labels['tiles'] = 0x8000 + 0x3000
+cpu.resolve()
+code = cpu.code
+assert len(code) < 0x3000, hex(len(code))
+rom = bytearray(0x8000)
+rom[0:len(code)] = code
+rom[0x3000:0x7000] = bytes(random.randrange(256) for _ in range(0x4000))
+hdr = 0x7FC0
+rom[hdr:hdr + 21] = b'S9X SYNTHETIC TEST   '
+rom[hdr + 0x15] = 0x20
+rom[hdr + 0x16] = 0x00
+rom[hdr + 0x17] = 0x05
+rom[hdr + 0x18] = 0x00
+rom[hdr + 0x19] = 0x01
+rom[hdr + 0x1A] = 0x33
+rom[hdr + 0x1B] = 0x00
+def vec(off, label):
+    a = cpu.labels[label]
+    rom[off] = a & 0xff; rom[off + 1] = a >> 8
+vec(0x7FEA, 'nmi'); vec(0x7FEE, 'irq')
+vec(0x7FFC, 'reset'); vec(0x7FFA, 'nmi'); vec(0x7FFE, 'irq')
+rom[hdr + 0x1C:hdr + 0x20] = bytes([0xff, 0xff, 0, 0])
+cs = sum(rom) & 0xffff
+rom[hdr + 0x1C] = (cs ^ 0xffff) & 0xff; rom[hdr + 0x1D] = (cs ^ 0xffff) >> 8
+rom[hdr + 0x1E] = cs & 0xff; rom[hdr + 0x1F] = cs >> 8
+open(sys.argv[1] if len(sys.argv) > 1 else 'synthetic.sfc', 'wb').write(rom)
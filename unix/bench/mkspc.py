@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+# Builds the synthetic SPC files listed in ../spccorpus.txt, the corpus that
+# 'snes9x-headless -comparedsp' plays through the serial and the voice-parallel
+# DSP paths. Each file holds BRR samples, a timer-driven SPC700 program and a
+# table of register writes it replays forever: key on/off, pitch, pitch
+# modulation, noise, ADSR and every GAIN mode, echo with varied FIR
+# coefficients, and writes to sample data that is being played. The output is
+# deterministic, so rerunning this script reproduces the committed files:
+#
+#   python3 mkspc.py .
+import math, os, random, struct, sys
+
+class Asm:
+    def __init__(self, base):
+        self.base = base
+        self.code = bytearray()
+        self.labels = {}
+        self.fix = []
+    def pc(self):
+        return self.base + len(self.code)
+    def L(self, name):
+        self.labels[name] = self.pc()
+    def b(self, *bs):
+        for x in bs:
+            self.code.append(x & 0xff)
+    def rel(self, op, label):
+        self.b(op)
+        self.fix.append(('rel', len(self.code), label))
+        self.b(0)
+    def resolve(self):
+        for kind, off, label in self.fix:
+            t = self.labels[label]
+            d = t - (self.base + off + 1)
+            assert -128 <= d < 128, label
+            self.code[off] = d & 0xff
+
+PROGRAM = 0x0200
+DIR     = 0x1000
+SAMPLES = 0x1100
+TABLE   = 0x2000
+ECHO    = 0xA0          # ESA page; EDL stays below 8 so echo ends before $E000
+TIMER   = 0x20          # timer 0 target: 250 ticks per second
+
+# ---------------- SPC700 program ----------------
+# Each table entry is '<ticks + 1> <register> <value>'. Registers from $80 up
+# write the value to sample data at SAMPLES + register - $80 instead. A zero
+# tick count restarts the table.
+spc = Asm(PROGRAM)
+spc.L('start')
+spc.b(0x8F, TABLE & 0xff, 0x00)     # mov $00,#<table
+spc.b(0x8F, TABLE >> 8, 0x01)       # mov $01,#>table
+spc.L('next')
+spc.b(0x8D, 0x00)                   # mov y,#0
+spc.b(0xF7, 0x00)                   # mov a,[$00]+y
+spc.rel(0xF0, 'start')              # beq start
+spc.b(0x5D)                         # mov x,a
+spc.L('wait')
+spc.b(0x1D)                         # dec x
+spc.rel(0xF0, 'go')                 # beq go
+spc.L('tick')
+spc.b(0xE4, 0xFD)                   # mov a,$fd
+spc.rel(0xF0, 'tick')               # beq tick
+spc.rel(0x2F, 'wait')               # bra wait
+spc.L('go')
+spc.b(0xFC)                         # inc y
+spc.b(0xF7, 0x00)                   # mov a,[$00]+y
+spc.rel(0x30, 'ram')                # bmi ram
+spc.b(0xC4, 0xF2)                   # mov $f2,a
+spc.b(0xFC)                         # inc y
+spc.b(0xF7, 0x00)                   # mov a,[$00]+y
+spc.b(0xC4, 0xF3)                   # mov $f3,a
+spc.rel(0x2F, 'advance')            # bra advance
+spc.L('ram')
+spc.b(0x5D)                         # mov x,a
+spc.b(0xFC)                         # inc y
+spc.b(0xF7, 0x00)                   # mov a,[$00]+y
+spc.b(0xD5, (SAMPLES - 0x80) & 0xff, (SAMPLES - 0x80) >> 8)   # mov !samples-$80+x,a
+spc.L('advance')
+spc.b(0x3A, 0x00, 0x3A, 0x00, 0x3A, 0x00)                       # incw $00 (x3)
+spc.rel(0x2F, 'next')               # bra next
+spc.resolve()
+
+# ---------------- BRR samples ----------------
+def brr_random(rnd, blocks, loop):
+    out = bytearray()
+    for i in range(blocks):
+        shift = rnd.choice([0, 4, 8, 10, 11, 12, 12, 13, 15])
+        header = shift << 4 | rnd.randrange(4) << 2
+        out += bytes([header] + [rnd.randrange(256) for _ in range(8)])
+    out[-9] |= 3 if loop else 1
+    return out
+
+def brr_tone(rnd, blocks, period, loop):
+    out = bytearray()
+    n = 0
+    for i in range(blocks):
+        shift = rnd.choice([9, 10, 11])
+        nibbles = []
+        for j in range(16):
+            v = int(round(7.4 * math.sin(2 * math.pi * n / period)))
+            nibbles.append(v & 15)
+            n += 1
+        out += bytes([shift << 4] + [nibbles[k] << 4 | nibbles[k + 1] for k in range(0, 16, 2)])
+    out[-9] |= 3 if loop else 1
+    return out
+
+def build(name, seed, weights, events):
+    rnd = random.Random(seed)
+    ram = bytearray(0x10000)
+    ram[PROGRAM:PROGRAM + len(spc.code)] = spc.code
+
+    # The first sample is the one the table rewrites while it plays.
+    samples = [brr_random(rnd, 16, True)]
+    samples += [brr_tone(rnd, 8, p, True) for p in (16, 32, 48)]
+    samples += [brr_random(rnd, rnd.randrange(2, 24), rnd.random() < 0.6) for _ in range(4)]
+    addr = SAMPLES
+    for i, s in enumerate(samples):
+        loop = addr + 9 * rnd.randrange(len(s) // 9)
+        ram[DIR + i * 4:DIR + i * 4 + 4] = struct.pack('<HH', addr, loop)
+        ram[addr:addr + len(s)] = s
+        addr += len(s)
+    assert addr <= TABLE
+
+    # Registers and their generators, picked by weight.
+    gens = {
+        'vol':   lambda: (rnd.randrange(8) << 4 | rnd.randrange(2), rnd.randrange(256)),
+        'pitch': lambda: (rnd.randrange(8) << 4 | rnd.choice([2, 3, 3]),
+                          rnd.choice([rnd.randrange(256), rnd.randrange(0x40), rnd.randrange(8)])),
+        'srcn':  lambda: (rnd.randrange(8) << 4 | 4, rnd.randrange(len(samples))),
+        'adsr':  lambda: (rnd.randrange(8) << 4 | rnd.choice([5, 6]), rnd.randrange(256)),
+        'gain':  lambda: (rnd.randrange(8) << 4 | rnd.choice([5, 7, 7]),
+                          rnd.choice([rnd.randrange(0x80), 0x80 | rnd.randrange(0x80),
+                                      rnd.choice([0x80, 0xA0, 0xC0, 0xE0]) | rnd.randrange(0x20)])),
+        'kon':   lambda: (0x4C, rnd.randrange(1, 256)),
+        'koff':  lambda: (0x5C, rnd.choice([0, rnd.randrange(256)])),
+        'mvol':  lambda: (rnd.choice([0x0C, 0x1C]), rnd.randrange(0x40, 0x80)),
+        'evol':  lambda: (rnd.choice([0x2C, 0x3C]), rnd.randrange(256)),
+        'efb':   lambda: (0x0D, rnd.randrange(256)),
+        'fir':   lambda: (rnd.randrange(8) << 4 | 0x0F,
+                          rnd.choice([rnd.randrange(256), 0x7F, 0x80, 0x00, rnd.randrange(0xF0, 0x110) & 0xff])),
+        'eon':   lambda: (0x4D, rnd.randrange(256)),
+        'edl':   lambda: (0x7D, rnd.randrange(8)),
+        'pmon':  lambda: (0x2D, rnd.randrange(256) & 0xFE),
+        'non':   lambda: (0x3D, rnd.choice([0, rnd.randrange(256)])),
+        'flg':   lambda: (0x6C, rnd.choice([0x00, 0x20, 0x40]) | rnd.randrange(0x20)),
+        'endx':  lambda: (0x7C, 0),
+        'ram':   lambda: (0x80 + rnd.randrange(0x80), rnd.randrange(256)),
+    }
+    names = sorted(weights)
+    total = sum(weights[n] for n in names)
+
+    table = bytearray()
+    def write(ticks, reg, val):
+        table.extend([ticks + 1, reg, val])
+    # Start from a known mix: all voices on, echo enabled, timer running.
+    for v in range(8):
+        write(0, v << 4 | 0, 0x40)
+        write(0, v << 4 | 1, 0x40)
+        write(0, v << 4 | 2, rnd.randrange(256))
+        write(0, v << 4 | 3, rnd.randrange(1, 0x20))
+        write(0, v << 4 | 4, v % len(samples))
+        write(0, v << 4 | 5, 0x80 | rnd.randrange(128))
+        write(0, v << 4 | 6, rnd.randrange(256))
+    for r, val in ((0x0C, 0x7F), (0x1C, 0x7F), (0x2C, 0x40), (0x3C, 0xC0),
+                   (0x0D, 0x50), (0x4D, 0xFF), (0x5D, DIR >> 8), (0x6D, ECHO),
+                   (0x7D, 0x03), (0x6C, 0x00), (0x4C, 0xFF)):
+        write(0, r, val)
+    for i in range(events):
+        k = rnd.randrange(total)
+        for n in names:
+            k -= weights[n]
+            if k < 0:
+                break
+        reg, val = gens[n]()
+        write(rnd.choice([0, 0, 1, 2, 3, 5, 8, 13, 21, 40]), reg, val)
+    table.append(0)
+    assert TABLE + len(table) <= ECHO << 8
+    ram[TABLE:TABLE + len(table)] = table
+
+    ram[0xF1] = 0x01            # timer 0 on, IPL ROM off
+    ram[0xFA] = TIMER
+
+    spcfile = bytearray(0x10200)
+    spcfile[0:33] = b'SNES-SPC700 Sound File Data v0.30'
+    spcfile[33:37] = bytes([26, 26, 26, 30])
+    spcfile[0x25:0x2C] = bytes([PROGRAM & 0xff, PROGRAM >> 8, 0, 0, 0, 0x02, 0xEF])
+    spcfile[0x2E:0x2E + len(name)] = name.encode()
+    spcfile[0x4E:0x4E + 14] = b'Snes9x corpus\0'
+    spcfile[0x100:0x10100] = ram
+    dsp = bytearray(128)
+    dsp[0x6C] = 0xE0            # held in reset until the table starts
+    dsp[0x5D] = DIR >> 8
+    dsp[0x6D] = ECHO
+    spcfile[0x10100:0x10180] = dsp
+    return bytes(spcfile)
+
+CORPUS = [
+    # name      seed  weights                                                     events
+    ('voices',  1,    dict(vol=3, pitch=6, srcn=3, adsr=4, kon=4, koff=3),         1500),
+    ('gain',    2,    dict(gain=10, adsr=3, kon=3, koff=2, pitch=2, srcn=1),       1500),
+    ('pmon',    3,    dict(pmon=5, non=4, flg=3, pitch=6, kon=3, koff=2, vol=2),   1500),
+    ('echo',    4,    dict(fir=8, efb=4, evol=3, eon=3, edl=2, kon=2, mvol=1),     1500),
+    ('samples', 5,    dict(ram=10, srcn=3, kon=4, koff=2, endx=1, pitch=3),        1500),
+    ('mixed',   6,    dict(vol=2, pitch=4, srcn=2, adsr=3, gain=4, kon=4, koff=3, mvol=1, evol=2,
+                           efb=2, fir=4, eon=2, edl=1, pmon=3, non=2, flg=2, endx=1, ram=3), 2500),
+]
+
+out = sys.argv[1] if len(sys.argv) > 1 else '.'
+for name, seed, weights, events in CORPUS:
+    open(os.path.join(out, name + '.spc'), 'wb').write(build(name, seed, weights, events))
@@ -0,0 +1,1063 @@
+/*****************************************************************************\
+     Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+                This file is licensed under the Snes9x License.
+   For further information, consult the LICENSE file in the root directory.
+\*****************************************************************************/
+
+// Headless batch runner. Emulates a fixed number of frames as fast as the host
+// allows, with no video or audio sink, for regression and throughput testing.
+// Several instances can run side by side; nothing is written to disk unless
+// explicitly requested on the command line.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_STRINGS_H
+#include <strings.h>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#ifdef NETPLAY_SUPPORT
+#include <unistd.h>
+#ifdef USE_THREADS
+#include <pthread.h>
+#endif
+#endif
+
+#include "snes9x.h"
+#include "memmap.h"
+#include "apu/apu.h"
+#include "gfx.h"
+#include "snapshot.h"
+#include "controls.h"
+#include "cheats.h"
+#include "movie.h"
+#include "display.h"
+#include "conffile.h"
+#include "fscompat.h"
+#include "profile.h"
+#ifdef NETPLAY_SUPPORT
+#include "netplay.h"
+#endif
+
+#define HASH_OFFSET_BASIS	0xcbf29ce484222325ULL
+#define HASH_PRIME			0x100000001b3ULL
+
+struct SHeadlessSettings
+{
+	uint32		Frames;
+	const char	*MovieFilename;
+	const char	*InputFilename;
+	const char	*LoadStateFilename;
+	const char	*SaveStateFilename;
+	const char	*HashFilename;
+	const char	*BenchFilename;
+	const char	*CompareDSPFilename;
+	const char	*ProfileFilename;
+	bool8		Quiet;
+	uint32		NetPlayers;
+	uint32		NetLatency;
+};
+
+struct SInputEvent
+{
+	uint32	Frame;
+	uint16	Pads[8];
+};
+
+static struct SHeadlessSettings	headlessSettings;
+
+static std::vector<SInputEvent>	input_script;
+static std::vector<uint8>		sound_buffer;
+
+static bool8	write_failed = FALSE;
+
+static uint64	video_hash;
+static uint64	audio_hash;
+static uint32	audio_samples;
+
+static inline uint64 HashBytes (uint64 hash, const uint8 *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= HASH_PRIME;
+	}
+
+	return (hash);
+}
+
+void S9xExtraUsage (void)
+{
+	/*                               12345678901234567890123456789012345678901234567890123456789012345678901234567890 */
+
+	S9xMessage(S9X_INFO, S9X_USAGE, "-frames <num>                   Number of frames to emulate (default: 3600, or");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                the movie length with -playmovie)");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-playmovie <filename>           Play the specified movie file");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-input <filename>               Read joypad input from a script; each line is");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                '<frame> <pad1> [<pad2> ... <pad8>]' in hex,");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                held until the next line");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-loadstate <filename>           Load a snapshot before emulating");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-savestate <filename>           Save a snapshot after the last frame");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-hash <filename>                Write per-frame hashes of the screen and the");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                sound output to file ('-' for stdout)");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-profile <filename>             Write a JSON report of the time spent in each");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                subsystem to file ('-' for stdout)");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-bench <filename>               Run each workload in the list and write a JSON");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                report to the -profile file; each line is");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                '<name> <rom> <frames> [<input script>]'");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-comparedsp <filename>          Play each SPC file in the list with the serial");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                and the voice-parallel DSP and check the output");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                matches; each line is '<spc> <seconds>'");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-quiet                          Suppress emulator messages");
+#ifdef NETPLAY_SUPPORT
+#ifdef USE_THREADS
+	S9xMessage(S9X_INFO, S9X_USAGE, "-netserver                      Host a rollback netplay game on -port and");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                join it as player 1");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-netlatency <ms>                Hold back inputs relayed by the server");
+#endif
+	S9xMessage(S9X_INFO, S9X_USAGE, "-netplayers <num>               Wait for this many players before starting;");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                the input script drives the local joypad");
+#endif
+	S9xMessage(S9X_INFO, S9X_USAGE, "");
+}
+
+void S9xParseArg (char **argv, int &i, int argc)
+{
+	if (!strcasecmp(argv[i], "-frames"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.Frames = strtoul(argv[++i], NULL, 10);
+		else
+			S9xUsage();
+	}
+	else
+	if (!strcasecmp(argv[i], "-playmovie"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.MovieFilename = argv[++i];
+		else
+			S9xUsage();
+	}
+	else
+	if (!strcasecmp(argv[i], "-input"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.InputFilename = argv[++i];
+		else
+			S9xUsage();
+	}
+	else
+	if (!strcasecmp(argv[i], "-loadstate"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.LoadStateFilename = argv[++i];
+		else
+			S9xUsage();
+	}
+	else
+	if (!strcasecmp(argv[i], "-savestate"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.SaveStateFilename = argv[++i];
+		else
+			S9xUsage();
+	}
+	else
+	if (!strcasecmp(argv[i], "-hash"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.HashFilename = argv[++i];
+		else
+			S9xUsage();
+	}
+	else
+	if (!strcasecmp(argv[i], "-profile"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.ProfileFilename = argv[++i];
+		else
+			S9xUsage();
+	}
+	else
+	if (!strcasecmp(argv[i], "-bench"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.BenchFilename = argv[++i];
+		else
+			S9xUsage();
+	}
+	else
+	if (!strcasecmp(argv[i], "-comparedsp"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.CompareDSPFilename = argv[++i];
+		else
+			S9xUsage();
+	}
+	else
+	if (!strcasecmp(argv[i], "-quiet"))
+		headlessSettings.Quiet = TRUE;
+	else
+#ifdef NETPLAY_SUPPORT
+#ifdef USE_THREADS
+	if (!strcasecmp(argv[i], "-netserver"))
+	{
+		Settings.NetPlay = TRUE;
+		Settings.NetPlayServer = TRUE;
+	}
+	else
+	if (!strcasecmp(argv[i], "-netlatency"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.NetLatency = strtoul(argv[++i], NULL, 10);
+		else
+			S9xUsage();
+	}
+	else
+#endif
+	if (!strcasecmp(argv[i], "-netplayers"))
+	{
+		if (i + 1 < argc)
+			headlessSettings.NetPlayers = strtoul(argv[++i], NULL, 10);
+		else
+			S9xUsage();
+	}
+	else
+#endif
+		S9xUsage();
+}
+
+void S9xParsePortConfig (ConfigFile &conf, int pass)
+{
+	return;
+}
+
+std::string S9xGetDirectory (enum s9x_getdirtype dirtype)
+{
+	SplitPath	path = splitpath(Memory.ROMFilename);
+
+	if (path.dir.empty())
+		return (".");
+
+	return (makepath(path.drive, path.dir, "", ""));
+}
+
+std::string S9xGetFilenameInc (std::string ex, enum s9x_getdirtype dirtype)
+{
+	return (S9xGetFilename(ex, dirtype));
+}
+
+bool8 S9xOpenSnapshotFile (const char *filename, bool8 read_only, STREAM *file)
+{
+	if ((*file = OPEN_STREAM(filename, read_only ? "rb" : "wb")))
+		return (TRUE);
+
+	fprintf(stderr, "Couldn't open snapshot file:\n%s\n", filename);
+
+	return (FALSE);
+}
+
+void S9xCloseSnapshotFile (STREAM file)
+{
+	CLOSE_STREAM(file);
+}
+
+bool8 S9xInitUpdate (void)
+{
+	return (TRUE);
+}
+
+bool8 S9xDeinitUpdate (int width, int height)
+{
+	if (headlessSettings.HashFilename)
+	{
+		for (int y = 0; y < height; y++)
+			video_hash = HashBytes(video_hash, (const uint8 *) (GFX.Screen + y * GFX.RealPPL), width * sizeof(uint16));
+	}
+
+	return (TRUE);
+}
+
+bool8 S9xContinueUpdate (int width, int height)
+{
+	return (TRUE);
+}
+
+void S9xSyncSpeed (void)
+{
+	if (Settings.SkipFrames == AUTO_FRAMERATE)
+	{
+		IPPU.RenderThisFrame = TRUE;
+		return;
+	}
+
+	IPPU.RenderThisFrame = (++IPPU.SkippedFrames >= Settings.SkipFrames) ? TRUE : FALSE;
+	if (IPPU.RenderThisFrame)
+		IPPU.SkippedFrames = 0;
+}
+
+void S9xAutoSaveSRAM (void)
+{
+	return;
+}
+
+void S9xToggleSoundChannel (int c)
+{
+	return;
+}
+
+bool8 S9xOpenSoundDevice (void)
+{
+	return (TRUE);
+}
+
+static void S9xSamplesAvailable (void *data)
+{
+	int	samples = S9xGetSampleCount();
+
+	if (samples <= 0)
+		return;
+
+	if (sound_buffer.size() < (size_t) samples * 2)
+		sound_buffer.resize(samples * 2);
+
+	S9xMixSamples(sound_buffer.data(), samples);
+
+	if (headlessSettings.HashFilename)
+		audio_hash = HashBytes(audio_hash, sound_buffer.data(), samples * 2);
+
+	audio_samples += samples;
+}
+
+const char * S9xStringInput (const char *message)
+{
+	return (NULL);
+}
+
+void S9xHandlePortCommand (s9xcommand_t cmd, int16 data1, int16 data2)
+{
+	return;
+}
+
+bool S9xPollButton (uint32 id, bool *pressed)
+{
+	return (false);
+}
+
+bool S9xPollAxis (uint32 id, int16 *value)
+{
+	return (false);
+}
+
+bool S9xPollPointer (uint32 id, int16 *x, int16 *y)
+{
+	return (false);
+}
+
+void S9xMessage (int type, int number, const char *message)
+{
+	if (number == S9X_FILE_WRITE_FAILED)
+		write_failed = TRUE;
+
+	if (type == S9X_USAGE)
+	{
+		fprintf(stderr, "%s\n", message);
+		return;
+	}
+
+	if (headlessSettings.Quiet && type != S9X_ERROR && type != S9X_FATAL_ERROR)
+		return;
+
+	fprintf(stderr, "%s\n", message);
+}
+
+void S9xExit (void)
+{
+	S9xMovieShutdown();
+
+#ifdef NETPLAY_SUPPORT
+	if (Settings.NetPlay)
+		S9xNPDisconnect();
+#endif
+
+	Memory.Deinit();
+	S9xDeinitAPU();
+	S9xGraphicsDeinit();
+
+	exit(0);
+}
+
+static bool8 LoadInputScript (const char *filename)
+{
+	FILE	*fp = fopen(filename, "r");
+	char	line[512];
+
+	input_script.clear();
+
+	if (!fp)
+		return (FALSE);
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		SInputEvent	event;
+		char		*p = line, *end;
+
+		while (*p == ' ' || *p == '\t')
+			p++;
+		if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+			continue;
+
+		memset(&event, 0, sizeof(event));
+
+		event.Frame = strtoul(p, &end, 10);
+		if (end == p)
+		{
+			fclose(fp);
+			return (FALSE);
+		}
+
+		for (int i = 0; i < 8; i++)
+		{
+			p = end;
+			event.Pads[i] = (uint16) strtoul(p, &end, 16);
+			if (end == p)
+				break;
+		}
+
+		if (!input_script.empty() && input_script.back().Frame > event.Frame)
+		{
+			fclose(fp);
+			return (FALSE);
+		}
+
+		input_script.push_back(event);
+	}
+
+	fclose(fp);
+
+	return (TRUE);
+}
+
+#ifdef NETPLAY_SUPPORT
+extern SNPServer	NPServer;
+
+#ifdef USE_THREADS
+static void * NetPlayServerThread (void *)
+{
+	S9xNPStartServer(Settings.Port);
+
+	return (NULL);
+}
+#endif
+
+static uint32 CountPlayers (uint32 players)
+{
+	uint32	n = 0;
+
+	for (; players; players &= players - 1)
+		n++;
+
+	return (n);
+}
+
+// Joins the game, hosting it first with -netserver, and waits until every
+// player is there and the server has synchronised them.
+static bool8 StartNetPlay (void)
+{
+	if (Settings.Port < 0)
+		Settings.Port = -Settings.Port;
+	if (!Settings.Port)
+		Settings.Port = NP_DEFAULT_PORT;
+	if (!Settings.ServerName[0])
+		strcpy(Settings.ServerName, "127.0.0.1");
+
+#ifdef USE_THREADS
+	if (Settings.NetPlayServer)
+	{
+		pthread_t	thread;
+
+		NPServer.Rollback = TRUE;
+		NPServer.RelayDelay = headlessSettings.NetLatency;
+		strcpy(Settings.ServerName, "127.0.0.1");
+
+		if (pthread_create(&thread, NULL, NetPlayServerThread, NULL))
+			return (FALSE);
+		pthread_detach(thread);
+	}
+#endif
+
+	// The server may still be starting up.
+	for (int tries = 0; !S9xNPConnectToServer(Settings.ServerName, Settings.Port, Memory.ROMName); tries++)
+	{
+		if (tries == 50)
+		{
+			fprintf(stderr, "Failed to connect to server %s on port %d.\n", Settings.ServerName, Settings.Port);
+			return (FALSE);
+		}
+
+		usleep(20000);
+	}
+
+	if (!NetPlay.Rollback)
+	{
+		fprintf(stderr, "The server is not in rollback mode.\n");
+		return (FALSE);
+	}
+
+	while (NetPlay.Paused || CountPlayers(NetPlay.RollbackPlayers) < headlessSettings.NetPlayers)
+	{
+		if (!S9xNPRollbackPoll(10))
+		{
+			fprintf(stderr, "Lost connection to server.\n");
+			return (FALSE);
+		}
+	}
+
+	return (TRUE);
+}
+
+// Waits for the inputs still on their way, so that every player ends up in
+// the same state, and as host keeps relaying until the others have left.
+static bool8 StopNetPlay (void)
+{
+	while (!S9xNPRollbackSettle())
+	{
+		if (!NetPlay.Connected)
+		{
+			fprintf(stderr, "Lost connection to server.\n");
+			return (FALSE);
+		}
+	}
+
+	if (Settings.NetPlayServer)
+	{
+		while (NPServer.NumClients > 1)
+			S9xNPRollbackPoll(10);
+	}
+
+	fprintf(stderr, "Netplay: %u rollbacks, depth %u last, %u max; %u frames emulated again, %u in the last second; %u stalls\n",
+		NetPlay.Stats.Rollbacks, NetPlay.Stats.LastDepth, NetPlay.Stats.MaxDepth,
+		NetPlay.Stats.ResimulatedFrames, NetPlay.Stats.ResimulatedPerSecond, NetPlay.Stats.Stalls);
+
+	return (TRUE);
+}
+#endif
+
+static double RunFrames (uint32 frames, FILE *hash_file)
+{
+	size_t	next_event = 0;
+	uint16	pads[8];
+
+	memset(pads, 0, sizeof(pads));
+
+	S9xResetProfiler();
+	audio_samples = 0;
+
+	auto	start = std::chrono::steady_clock::now();
+
+	for (uint32 frame = 0; frame < frames; frame++)
+	{
+		if (!headlessSettings.MovieFilename)
+		{
+			while (next_event < input_script.size() && input_script[next_event].Frame <= frame)
+			{
+				memcpy(pads, input_script[next_event].Pads, sizeof(pads));
+				next_event++;
+			}
+
+		#ifdef NETPLAY_SUPPORT
+			if (Settings.NetPlay)
+			{
+				while (!S9xNPRollbackFrame(pads[0]))
+				{
+					if (!NetPlay.Connected)
+					{
+						fprintf(stderr, "Lost connection to server.\n");
+						exit(1);
+					}
+				}
+			}
+			else
+		#endif
+			for (int i = 0; i < 8; i++)
+				MovieSetJoypad(i, pads[i]);
+		}
+
+		video_hash = audio_hash = HASH_OFFSET_BASIS;
+
+		S9xMainLoop();
+
+		if (hash_file)
+			fprintf(hash_file, "%u %016llx %016llx\n", frame, (unsigned long long) video_hash, (unsigned long long) audio_hash);
+	}
+
+	auto	end = std::chrono::steady_clock::now();
+
+	return (std::chrono::duration<double>(end - start).count());
+}
+
+static void WriteJSONString (FILE *fp, const char *str)
+{
+	fputc('"', fp);
+
+	for (; *str; str++)
+	{
+		if (*str == '"' || *str == '\\')
+			fputc('\\', fp);
+		if ((uint8) *str >= 0x20)
+			fputc(*str, fp);
+	}
+
+	fputc('"', fp);
+}
+
+static void WriteProfile (FILE *fp, const char *name, const char *rom, uint32 frames, double seconds)
+{
+	uint64	children = 0;
+
+	fprintf(fp, "    {\n      \"name\": ");
+	WriteJSONString(fp, name);
+	fprintf(fp, ",\n      \"rom\": ");
+	WriteJSONString(fp, rom);
+	fprintf(fp, ",\n      \"sha256\": \"");
+	for (int i = 0; i < 32; i++)
+		fprintf(fp, "%02x", Memory.ROMSHA256[i]);
+	fprintf(fp, "\",\n      \"frames\": %u,\n      \"seconds\": %.6f,\n      \"fps\": %.3f,\n      \"sections\": {\n",
+		frames, seconds, seconds > 0.0 ? frames / seconds : 0.0);
+
+	for (int i = 0; i < PROFILE_NUM_SECTIONS; i++)
+	{
+		if (i != PROFILE_MAINLOOP)
+			children += Profiler.Nanoseconds[i];
+
+		fprintf(fp, "        \"%s\": { \"seconds\": %.6f, \"calls\": %llu },\n",
+			S9xProfileSectionName(i), Profiler.Nanoseconds[i] / 1e9, (unsigned long long) Profiler.Calls[i]);
+	}
+
+	// Everything in the main loop not covered by another section, mostly the 65c816 core.
+	uint64	self = Profiler.Nanoseconds[PROFILE_MAINLOOP] > children ? Profiler.Nanoseconds[PROFILE_MAINLOOP] - children : 0;
+
+	fprintf(fp, "        \"main_loop_self\": { \"seconds\": %.6f }\n      }\n    }", self / 1e9);
+}
+
+// Relative paths in a benchmark list are taken from the list's directory, so
+// the committed workloads run from anywhere.
+static std::string BenchmarkPath (const char *list, const char *path)
+{
+	const char	*slash = strrchr(list, SLASH_CHAR);
+
+	if (path[0] == SLASH_CHAR || !slash)
+		return (path);
+
+	return (std::string(list, slash + 1 - list) + path);
+}
+
+static bool8 RunBenchmark (const char *filename, FILE *report)
+{
+	FILE	*fp = fopen(filename, "r");
+	char	line[1024];
+	int		count = 0;
+
+	if (!fp)
+	{
+		fprintf(stderr, "Error opening the benchmark list %s.\n", filename);
+		return (FALSE);
+	}
+
+	Profiler.Enabled = TRUE;
+
+	fprintf(report, "{\n  \"workloads\": [\n");
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		char	name[256], rom[1024], input[1024];
+		uint32	frames;
+		int		fields;
+
+		name[0] = rom[0] = input[0] = 0;
+
+		fields = sscanf(line, " %255s %1023s %u %1023s", name, rom, &frames, input);
+		if (fields <= 0 || name[0] == '#')
+			continue;
+
+		if (fields < 3)
+		{
+			fprintf(stderr, "Malformed benchmark entry: %s", line);
+			fclose(fp);
+			return (FALSE);
+		}
+
+		std::string	rom_path = BenchmarkPath(filename, rom);
+
+		if (!Memory.LoadROM(rom_path.c_str()))
+		{
+			fprintf(stderr, "Error opening the ROM file %s.\n", rom_path.c_str());
+			fclose(fp);
+			return (FALSE);
+		}
+
+		input_script.clear();
+		if (fields > 3 && !LoadInputScript(BenchmarkPath(filename, input).c_str()))
+		{
+			fprintf(stderr, "Error reading the input script %s.\n", input);
+			fclose(fp);
+			return (FALSE);
+		}
+
+		double	seconds = RunFrames(frames, NULL);
+
+		if (count++)
+			fprintf(report, ",\n");
+		WriteProfile(report, name, rom, frames, seconds);
+
+		fprintf(stderr, "%s: %u frames in %.3f s: %.2f fps\n", name, frames, seconds, seconds > 0.0 ? frames / seconds : 0.0);
+	}
+
+	fprintf(report, "\n  ]\n}\n");
+
+	fclose(fp);
+
+	return (TRUE);
+}
+
+// Plays an SPC file for the given time in chunks of varying size, none a
+// multiple of the DSP's 32-clock sample period, so runs start and end partway
+// through a sample. Returns the output and the final APU state, and the time
+// taken.
+static double PlaySPC (const std::vector<uint8> &spc, uint32 seconds, std::vector<int16> &samples, std::vector<uint8> &state)
+{
+	uint32	seed = 1;
+	int64	clocks = (int64) seconds * 1024000;
+	uint8	buffer[4096 * 2];
+
+	S9xAPULoadSPC(spc.data(), spc.size());
+
+	samples.clear();
+
+	auto	start = std::chrono::steady_clock::now();
+
+	while (clocks > 0)
+	{
+		seed = seed * 1103515245 + 12345;
+
+		int	chunk = (seed >> 16) % 2048 + 1;
+		if (!(chunk & 31))
+			chunk++;
+		if (chunk > clocks)
+			chunk = clocks;
+
+		S9xAPURunSPC(chunk);
+		clocks -= chunk;
+
+		int	count = S9xGetSampleCount();
+		S9xMixSamples(buffer, count);
+		samples.insert(samples.end(), (int16 *) buffer, (int16 *) buffer + count);
+	}
+
+	auto	end = std::chrono::steady_clock::now();
+
+	state.resize(SPC_SAVE_STATE_BLOCK_SIZE);
+	S9xAPUSaveState(state.data());
+
+	return (std::chrono::duration<double>(end - start).count());
+}
+
+// Checks the voice-parallel DSP against the serial one on each SPC file in the
+// list, with every interpolation method. Both must produce the same samples and
+// leave the APU in the same state.
+static bool8 CompareDSP (const char *filename)
+{
+	FILE	*fp = fopen(filename, "r");
+	char	line[1024];
+	bool8	same = TRUE;
+
+	if (!fp)
+	{
+		fprintf(stderr, "Error opening the SPC list %s.\n", filename);
+		return (FALSE);
+	}
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		char	name[1024];
+		uint32	seconds;
+		int		fields;
+
+		name[0] = 0;
+
+		fields = sscanf(line, " %1023s %u", name, &seconds);
+		if (fields <= 0 || name[0] == '#')
+			continue;
+
+		if (fields < 2)
+		{
+			fprintf(stderr, "Malformed SPC list entry: %s", line);
+			fclose(fp);
+			return (FALSE);
+		}
+
+		std::string	path = BenchmarkPath(filename, name);
+		FILE		*spc_fp = fopen(path.c_str(), "rb");
+		std::vector<uint8>	spc(SPC_FILE_SIZE);
+
+		if (!spc_fp || fread(spc.data(), 1, SPC_FILE_SIZE, spc_fp) != SPC_FILE_SIZE)
+		{
+			fprintf(stderr, "Error reading the SPC file %s.\n", path.c_str());
+			if (spc_fp)
+				fclose(spc_fp);
+			fclose(fp);
+			return (FALSE);
+		}
+
+		fclose(spc_fp);
+
+		if (!S9xAPULoadSPC(spc.data(), spc.size()))
+		{
+			fprintf(stderr, "%s is not an SPC file.\n", path.c_str());
+			fclose(fp);
+			return (FALSE);
+		}
+
+		for (int method = 0; method <= 4; method++)
+		{
+			std::vector<int16>	samples[2];
+			std::vector<uint8>	state[2];
+			double				seconds_taken[2];
+
+			Settings.InterpolationMethod = method;
+
+			for (int parallel = 0; parallel < 2; parallel++)
+			{
+				Settings.ParallelVoices = parallel;
+				seconds_taken[parallel] = PlaySPC(spc, seconds, samples[parallel], state[parallel]);
+			}
+
+			size_t	count = std::min(samples[0].size(), samples[1].size());
+			size_t	i = 0;
+
+			while (i < count && samples[0][i] == samples[1][i])
+				i++;
+
+			if (i < count || samples[0].size() != samples[1].size())
+			{
+				fprintf(stderr, "%s, interpolation %d: sample %lu differs (%d, %d)\n", name, method, (unsigned long) i,
+					i < samples[0].size() ? samples[0][i] : 0, i < samples[1].size() ? samples[1][i] : 0);
+				same = FALSE;
+			}
+			else
+			if (state[0] != state[1])
+			{
+				fprintf(stderr, "%s, interpolation %d: APU state differs\n", name, method);
+				same = FALSE;
+			}
+			else
+				fprintf(stderr, "%s, interpolation %d: %lu samples identical, %.3f s serial, %.3f s parallel\n",
+					name, method, (unsigned long) count, seconds_taken[0], seconds_taken[1]);
+		}
+	}
+
+	fclose(fp);
+
+	return (same);
+}
+
+int main (int argc, char **argv)
+{
+	if (argc < 2)
+		S9xUsage();
+
+	memset(&headlessSettings, 0, sizeof(headlessSettings));
+
+	memset(&Settings, 0, sizeof(Settings));
+	Settings.MouseMaster = TRUE;
+	Settings.SuperScopeMaster = TRUE;
+	Settings.JustifierMaster = TRUE;
+	Settings.MultiPlayer5Master = TRUE;
+	Settings.MacsRifleMaster = TRUE;
+	Settings.FrameTimePAL = 20000;
+	Settings.FrameTimeNTSC = 16667;
+	Settings.SixteenBitSound = TRUE;
+	Settings.Stereo = TRUE;
+	Settings.SoundPlaybackRate = 32040;
+	Settings.SoundInputRate = 32040;
+	Settings.Transparency = TRUE;
+	Settings.AutoDisplayMessages = FALSE;
+	Settings.HDMATimingHack = 100;
+	Settings.BlockInvalidVRAMAccessMaster = TRUE;
+	Settings.WrongMovieStateProtection = TRUE;
+	Settings.DontSaveOopsSnapshot = TRUE;
+	Settings.SkipFrames = 1;
+	Settings.StopEmulation = TRUE;
+
+	CPU.Flags = 0;
+
+	S9xSetController(0, CTL_JOYPAD, 0, 0, 0, 0);
+	S9xSetController(1, CTL_JOYPAD, 1, 0, 0, 0);
+
+	const char	*rom_filename = S9xParseArgs(argv, argc);
+
+	if (!rom_filename && !headlessSettings.BenchFilename && !headlessSettings.CompareDSPFilename)
+		S9xUsage();
+
+	if (!Memory.Init() || !S9xInitAPU())
+	{
+		fprintf(stderr, "Snes9x: Memory allocation failure - not enough RAM/virtual memory available.\nExiting...\n");
+		Memory.Deinit();
+		S9xDeinitAPU();
+		exit(1);
+	}
+
+	S9xInitSound(0);
+	S9xSetSamplesAvailableCallback(S9xSamplesAvailable, NULL);
+
+	if (!S9xGraphicsInit())
+	{
+		fprintf(stderr, "Snes9x: Graphics initialization failure.\nExiting...\n");
+		S9xExit();
+	}
+
+	S9xDeleteCheats();
+
+	FILE	*profile_file = NULL;
+
+	if (headlessSettings.BenchFilename && !headlessSettings.ProfileFilename)
+		headlessSettings.ProfileFilename = "-";
+
+	if (headlessSettings.ProfileFilename)
+	{
+		if (!strcmp(headlessSettings.ProfileFilename, "-"))
+			profile_file = stdout;
+		else
+		if (!(profile_file = fopen(headlessSettings.ProfileFilename, "w")))
+		{
+			fprintf(stderr, "Error opening the profile file %s.\n", headlessSettings.ProfileFilename);
+			exit(1);
+		}
+	}
+
+	if (headlessSettings.CompareDSPFilename)
+	{
+		S9xSetSoundMute(FALSE);
+
+		if (!CompareDSP(headlessSettings.CompareDSPFilename))
+			exit(1);
+
+		S9xExit();
+	}
+
+	if (headlessSettings.BenchFilename)
+	{
+		Settings.StopEmulation = FALSE;
+		S9xSetSoundMute(FALSE);
+
+		if (!RunBenchmark(headlessSettings.BenchFilename, profile_file))
+			exit(1);
+
+		if (profile_file != stdout)
+			fclose(profile_file);
+
+		S9xExit();
+	}
+
+	if (!Memory.LoadROM(rom_filename))
+	{
+		fprintf(stderr, "Error opening the ROM file.\n");
+		exit(1);
+	}
+
+	S9xParseArgsForCheats(argv, argc);
+	S9xCheatsEnable();
+
+	if (headlessSettings.InputFilename && !LoadInputScript(headlessSettings.InputFilename))
+	{
+		fprintf(stderr, "Error reading the input script %s.\n", headlessSettings.InputFilename);
+		exit(1);
+	}
+
+	if (headlessSettings.MovieFilename)
+	{
+		if (S9xMovieOpen(headlessSettings.MovieFilename, TRUE) != SUCCESS)
+		{
+			fprintf(stderr, "Error opening the movie file %s.\n", headlessSettings.MovieFilename);
+			exit(1);
+		}
+
+		if (!headlessSettings.Frames)
+			headlessSettings.Frames = S9xMovieGetLength();
+	}
+	else
+	if (headlessSettings.LoadStateFilename)
+	{
+		if (!S9xUnfreezeGame(headlessSettings.LoadStateFilename))
+			exit(1);
+	}
+
+	if (!headlessSettings.Frames)
+		headlessSettings.Frames = 3600;
+
+	FILE	*hash_file = NULL;
+
+	if (headlessSettings.HashFilename)
+	{
+		if (!strcmp(headlessSettings.HashFilename, "-"))
+			hash_file = stdout;
+		else
+		if (!(hash_file = fopen(headlessSettings.HashFilename, "w")))
+		{
+			fprintf(stderr, "Error opening the hash file %s.\n", headlessSettings.HashFilename);
+			exit(1);
+		}
+	}
+
+	Settings.StopEmulation = FALSE;
+	S9xSetSoundMute(Settings.Mute);
+
+	Profiler.Enabled = profile_file ? TRUE : FALSE;
+
+#ifdef NETPLAY_SUPPORT
+	if (Settings.NetPlay && !StartNetPlay())
+		exit(1);
+#endif
+
+	double	seconds = RunFrames(headlessSettings.Frames, hash_file);
+
+#ifdef NETPLAY_SUPPORT
+	if (Settings.NetPlay && !StopNetPlay())
+		exit(1);
+#endif
+
+	if (hash_file && hash_file != stdout)
+		fclose(hash_file);
+
+	if (headlessSettings.SaveStateFilename)
+	{
+		// The snapshot is written in the background; see it through.
+		bool8	saved = S9xFreezeGame(headlessSettings.SaveStateFilename);
+
+		S9xWaitForFileWrites();
+		S9xReportFileWrites();
+
+		if (!saved || write_failed)
+			exit(1);
+	}
+
+	if (profile_file)
+	{
+		fprintf(profile_file, "{\n  \"workloads\": [\n");
+		WriteProfile(profile_file, Memory.ROMName, rom_filename, headlessSettings.Frames, seconds);
+		fprintf(profile_file, "\n  ]\n}\n");
+
+		if (profile_file != stdout)
+			fclose(profile_file);
+	}
+
+	fprintf(stderr, "%u frames in %.3f s: %.2f fps, %u sound samples\n",
+		headlessSettings.Frames, seconds, seconds > 0.0 ? headlessSettings.Frames / seconds : 0.0, audio_samples);
+
+	S9xExit();
+
+	return (0);
+}
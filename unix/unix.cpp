@@ -819,7 +819,7 @@ void S9xSyncSpeed (void)
 		return;
 
 #ifdef NETPLAY_SUPPORT
-	if (Settings.NetPlay && NetPlay.Connected)
+	if (Settings.NetPlay && NetPlay.Connected && !NetPlay.Rollback)
 	{
 	#if defined(NP_DEBUG) && NP_DEBUG == 2
 		printf("CLIENT: SyncSpeed @%d\n", S9xGetMilliTime());
@@ -1850,7 +1850,39 @@ int main (int argc, char **argv)
 
 	while (1)
 	{
+		// Rewinding and frame advance change the emulation state behind
+		// rollback netplay's back, so they are off while it runs.
+		bool8	rollback = FALSE;
+
 	#ifdef NETPLAY_SUPPORT
+		if (NP_Activated && NetPlay.Rollback)
+		{
+			if (!NetPlay.Connected)
+			{
+				fprintf(stderr, "Lost connection to server.\n");
+				S9xExit();
+			}
+
+			rollback = TRUE;
+			rewinding = FALSE;
+			frame_advance = 0;
+
+			for (int J = 0; J < 8; J++)
+				old_joypads[J] = MovieGetJoypad(J);
+
+			// A local pause has been sent to the server, which pauses the
+			// other players; no input goes out and no frame is run until
+			// it is lifted.
+			if (Settings.Paused)
+				S9xNPRollbackPoll();
+			else
+			if (!S9xNPRollbackFrame(old_joypads[0]))
+			{
+				S9xProcessEvents(FALSE);
+				continue;
+			}
+		}
+		else
 		if (NP_Activated)
 		{
 			if (NetPlay.PendingWait4Sync && !S9xNPWaitForHeartBeatDelay(100))
@@ -1899,7 +1931,7 @@ int main (int argc, char **argv)
 				for (int i = 0; i < 8; i++)
 					MovieSetJoypad (i, joypads[i]);
 			}
-			else if(IPPU.TotalEmulatedFrames % unixSettings.rewindGranularity == 0)
+			else if(!rollback && IPPU.TotalEmulatedFrames % unixSettings.rewindGranularity == 0)
 				stateMan.push();
 
 			S9xMainLoop();
@@ -668,6 +668,7 @@ void WinPostLoad(ConfigFile& conf)
 	if(GUI.MaxRecentGames < 1) GUI.MaxRecentGames = 1;
 	if(GUI.MaxRecentGames > MAX_RECENT_GAMES_LIST_SIZE) GUI.MaxRecentGames = MAX_RECENT_GAMES_LIST_SIZE;
     if(GUI.rewindGranularity==0) GUI.rewindGranularity = 1;
+	Settings.RunAhead = S9xClampRunAhead(Settings.RunAhead);
 	bool gap = false;
 	for(i=0;i<MAX_RECENT_GAMES_LIST_SIZE;i++) // remove gaps in recent games list
 	{
@@ -751,6 +752,7 @@ void WinRegisterConfigItems()
 #undef CATEGORY
 #define CATEGORY "Display"
 	AddBool2("Transparency", Settings.Transparency, true);
+	AddBoolC("ThreadedRenderer", Settings.ThreadedRenderer, false, "true to draw the SNES screen on a separate thread");
 	AddBoolC("MessagesInImage", Settings.AutoDisplayMessages, false, "true to draw text inside the SNES image (will get into AVIs, screenshots, and filters)");
 	AddBool2C("FrameRate", Settings.DisplayFrameRate, false, "on to display the framerate (will be inaccurate if AutoMaxSkipFrames is too small)");
 	AddBoolC("DisplayInput", Settings.DisplayPressedKeys, false, "true to show which buttons are pressed");
@@ -807,6 +809,7 @@ void WinRegisterConfigItems()
 	AddUIntC("AutoMaxSkipFramesAtOnce", Settings.AutoMaxSkipFrames, 0, "most frames to skip at once to maintain speed in automatic mode, don't set to more than 1 or 2 frames because the skipping algorithm isn't very smart");
 	AddUIntC("TurboFrameSkip", Settings.TurboSkipFrames, 15, "how many frames to skip when in fast-forward mode");
 	AddUInt("AutoSaveDelay", Settings.AutoSaveDelay, 30);
+	AddUIntC("RunAheadFrames", Settings.RunAhead, 0, "emulate this many frames ahead to hide the game's input lag, 0 to disable, at most 8");
 	AddBool("BlockInvalidVRAMAccess", Settings.BlockInvalidVRAMAccessMaster, true);
 	AddBool2C("SnapshotScreenshots", Settings.SnapshotScreenshots, true, "on to save the screenshot in each snapshot, for loading-when-paused display");
 	AddBoolC("MovieTruncateAtEnd", Settings.MovieTruncate, true, "true to truncate any leftover data in the movie file after the current frame when recording stops");